@@ -2,6 +2,9 @@
 
 #include "bps/ble_service/ble_service.hpp"
 #include "bps/sampler_service/sampler_service.hpp"
+#include "bps/storage/session_storage.hpp"
+#include "bps/storage/parameter_store.hpp"
+#include "bps/coro/executor.hpp"
 #include "bps/logger/logger.hpp"
 
 int main() {
@@ -9,6 +12,11 @@ int main() {
     sleep_ms(1000);
     BPS_LOG("Start BPS!\n");
 
+    auto& session_storage = bps::storage::SessionStorage::getInstance();
+    session_storage.initialize();
+    // Before the sampler, which restores the saved controller gains from it
+    bps::storage::ParameterStore::getInstance().initialize();
+
     auto& ble_service = bps::ble::BleService::getInstance();
     ble_service.initialize();
 
@@ -16,11 +24,30 @@ int main() {
     sampler_service.initialize();
 
     sampler_service.registerPulseValueQueue(ble_service.getPulseValueQueueRef());
+    sampler_service.registerPreviewQueue(ble_service.getPreviewQueueRef());
+    sampler_service.registerSummaryQueue(ble_service.getSummaryQueueRef());
+    sampler_service.registerAnalysisReportQueue(ble_service.getAnalysisReportQueueRef());
     sampler_service.registerMachineStatusQueue(ble_service.getMachineStatusQueueRef());
     ble_service.registerCommandQueue(sampler_service.getCommandQueueRef());
-
-    ble_service.createTask(2);
-    sampler_service.createTask(1);
+    ble_service.registerEmergencyStopCallback(
+        [](void* context) { static_cast<bps::sampler::SamplerService*>(context)->emergencyStop(); },
+        &sampler_service
+    );
+
+    // Without any of these the device would boot without sampling or pressure control and
+    // say nothing, stop here whether or not assertions are compiled in
+    auto const require = [](bool const ok, char const* what) {
+        if (!ok) {
+            BPS_LOG("Boot failed: %s\n", what);
+            panic("Boot failed: %s\n", what);
+        }
+    };
+    require(ble_service.createTask(2), "BLE task");
+    // The sampler and the pressure control loop share the executor task, their frames
+    // must fit the executor arena
+    require(sampler_service.spawn(), "sampler coroutines");
+    require(bps::coro::Executor::getInstance().createTask(1), "executor task");
+    require(session_storage.createTask(tskIDLE_PRIORITY), "storage task");
 
     vTaskStartScheduler();
 
@@ -0,0 +1,165 @@
+#include "beat_detector.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <numbers>
+#include <optional>
+
+namespace bps::analysis {
+
+namespace {
+
+constexpr std::uint64_t kUsPerMs = 1000;
+
+} // anonymous namespace
+
+void BeatDetector::configure(std::uint32_t const& sample_interval_us) noexcept {
+    std::uint32_t const interval_us = std::max<std::uint32_t>(sample_interval_us, 1);
+    this->slope_window = std::clamp<std::size_t>((kSlopeWindowMs * kUsPerMs + interval_us / 2) / interval_us, 1, kMaxSlopeWindow);
+    // One pole low-pass, matched at DC to the continuous one
+    this->smoothing = 1.0f - std::exp(-2.0f * std::numbers::pi_v<float> * kSmoothingHz * static_cast<std::float32_t>(interval_us) / 1.0e6f);
+    reset();
+}
+
+void BeatDetector::reset() noexcept {
+    std::size_t const window = this->slope_window;
+    std::float32_t const alpha = this->smoothing;
+    *this = BeatDetector{};
+    this->slope_window = window;
+    this->smoothing = alpha;
+}
+
+std::optional<BeatDetector::Beat> BeatDetector::process(
+    std::float32_t const& pressure,
+    std::uint64_t  const& timestamp,
+    std::uint32_t  const& sequence
+) noexcept {
+    if (!this->primed) {
+        this->smoothed       = pressure;
+        this->prev_timestamp = timestamp;
+        this->learning_start = timestamp;
+        this->primed         = true;
+        return std::nullopt;
+    }
+
+    std::float32_t const prev_smoothed = this->smoothed;
+    this->smoothed += this->smoothing * (pressure - this->smoothed);
+    std::int32_t const slope = std::max<std::int32_t>(
+        static_cast<std::int32_t>(std::lround((this->smoothed - prev_smoothed) * kSlopeUnitsPerPa)),
+        0
+    );
+    this->slope_sum += slope - this->slopes[this->slope_index];
+    this->slopes[this->slope_index] = slope;
+    this->slope_index = (this->slope_index + 1) % this->slope_window;
+
+    constexpr std::int32_t kMinLevel = static_cast<std::int32_t>(kMinLevelPa * kSlopeUnitsPerPa);
+    std::optional<Beat> beat{};
+    if (this->learning) {
+        this->level = std::max(this->level, this->slope_sum);
+        if (timestamp - this->learning_start >= kLearningMs * kUsPerMs) {
+            this->learning   = false;
+            this->level      = std::max(this->level, kMinLevel);
+            this->last_decay = timestamp;
+            // Don't report the upstroke the learning ends on
+            this->in_beat    = this->slope_sum >= threshold();
+            this->beat_peak  = this->slope_sum;
+        }
+    } else if (!this->in_beat) {
+        bool const refractory = this->has_last_beat && (timestamp - this->last_beat < kRefractoryMs * kUsPerMs);
+        if (!refractory && this->slope_sum >= threshold() && this->prev_slope_sum < threshold()) {
+            // Place the onset where the slope sum crossed the threshold between the two samples
+            std::float32_t const fraction =
+                static_cast<std::float32_t>(threshold() - this->prev_slope_sum) /
+                static_cast<std::float32_t>(this->slope_sum - this->prev_slope_sum);
+            std::uint64_t const onset = this->prev_timestamp +
+                static_cast<std::uint64_t>(fraction * static_cast<std::float32_t>(timestamp - this->prev_timestamp));
+            beat = makeBeat(onset, sequence);
+            this->in_beat    = true;
+            this->beat_peak  = this->slope_sum;
+            this->last_decay = timestamp;
+        } else if (timestamp - this->last_decay >= kMaxIntervalMs * kUsPerMs) {
+            // No beat for too long: the level was raised by an artifact, or the pulse got weaker
+            this->level      = std::max(this->level / 2, kMinLevel);
+            this->last_decay = timestamp;
+        }
+    } else {
+        this->beat_peak = std::max(this->beat_peak, this->slope_sum);
+        if (this->slope_sum < threshold()) {
+            this->in_beat = false;
+            this->level   = std::max(this->level + (this->beat_peak - this->level) / 4, kMinLevel);
+        }
+    }
+
+    this->prev_slope_sum = this->slope_sum;
+    this->prev_timestamp = timestamp;
+    return beat;
+}
+
+BeatDetector::Beat BeatDetector::makeBeat(std::uint64_t const& onset, std::uint32_t const& sequence) noexcept {
+    Beat beat{
+        .timestamp        = onset,
+        .sequence         = sequence,
+        .interval_ms      = 0,
+        .heart_rate       = 0,
+        .mean_interval_ms = 0,
+        .rmssd_ms         = 0,
+        .interval_count   = 0
+    };
+
+    if (this->has_last_beat && onset - this->last_beat <= kMaxIntervalMs * kUsPerMs) {
+        std::uint32_t const interval = static_cast<std::uint32_t>(onset - this->last_beat);
+        if (this->interval_count > 0) {
+            std::uint32_t const previous = this->intervals[(this->interval_index + kIntervalWindow - 1) % kIntervalWindow];
+            std::int64_t const difference = static_cast<std::int64_t>(interval) - previous;
+            if (this->difference_count == kIntervalWindow) {
+                this->squared_difference_sum -= this->squared_differences[this->difference_index];
+            } else {
+                ++this->difference_count;
+            }
+            this->squared_differences[this->difference_index] = static_cast<std::uint64_t>(difference * difference);
+            this->squared_difference_sum += this->squared_differences[this->difference_index];
+            this->difference_index = (this->difference_index + 1) % kIntervalWindow;
+        }
+        if (this->interval_count == kIntervalWindow) {
+            this->interval_sum -= this->intervals[this->interval_index];
+        } else {
+            ++this->interval_count;
+        }
+        this->intervals[this->interval_index] = interval;
+        this->interval_sum += interval;
+        this->interval_index = (this->interval_index + 1) % kIntervalWindow;
+
+        beat.interval_ms = static_cast<std::uint16_t>((interval + kUsPerMs / 2) / kUsPerMs);
+        beat.heart_rate  = static_cast<std::uint16_t>((600'000'000u + interval / 2) / interval);
+    } else {
+        // First beat, or a gap: the intervals around it are unknown
+        clearIntervals();
+    }
+
+    if (this->interval_count > 0) {
+        beat.mean_interval_ms = static_cast<std::uint16_t>((this->interval_sum / this->interval_count + kUsPerMs / 2) / kUsPerMs);
+    }
+    if (this->difference_count > 0) {
+        beat.rmssd_ms = static_cast<std::uint16_t>(std::lround(
+            std::sqrt(static_cast<double>(this->squared_difference_sum) / static_cast<double>(this->difference_count)) / kUsPerMs
+        ));
+    }
+    beat.interval_count = static_cast<std::uint8_t>(this->interval_count);
+
+    this->last_beat     = onset;
+    this->has_last_beat = true;
+    return beat;
+}
+
+void BeatDetector::clearIntervals() noexcept {
+    this->interval_index         = 0;
+    this->interval_count         = 0;
+    this->difference_index       = 0;
+    this->difference_count       = 0;
+    this->interval_sum           = 0;
+    this->squared_difference_sum = 0;
+}
+
+} // namespace bps::analysis
\ No newline at end of file
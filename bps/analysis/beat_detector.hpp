@@ -0,0 +1,92 @@
+#ifndef BPS_ANALYSIS_BEAT_DETECTOR_HPP
+#define BPS_ANALYSIS_BEAT_DETECTOR_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <stdfloat>
+#include <optional>
+
+#include "common.hpp"
+
+namespace bps::analysis {
+
+// Incremental beat detector of one position, constant work per sample.
+//
+// The pressure is smoothed, then the positive slopes over the last kSlopeWindowMs
+// are summed (slope sum function). A beat starts when the sum crosses half of the
+// expected upstroke level, which follows the peaks of the detected beats and
+// decays while no beat comes. The level is learnt over the first kLearningMs.
+class BeatDetector {
+    public:
+        using Beat = AnalysisReport::Content::Beat;
+
+        // About the duration of an upstroke
+        static constexpr std::uint32_t kSlopeWindowMs    = 128;
+        static constexpr std::size_t   kMaxSlopeWindow   = kSlopeWindowMs / AcquisitionConfig::kMinConversionWaitMs;
+        // Cutoff of the smoothing ahead of the slopes
+        static constexpr std::float32_t kSmoothingHz     = 16.0f;
+        static constexpr std::uint32_t kLearningMs       = 2000;
+        // 200 bpm, and 30 bpm
+        static constexpr std::uint32_t kRefractoryMs     = 300;
+        static constexpr std::uint32_t kMaxIntervalMs    = 2000;
+        // Lowest expected upstroke, keeps the sensor noise from being taken for beats
+        static constexpr std::float32_t kMinLevelPa      = 40.0f;
+        static constexpr std::size_t   kIntervalWindow   = 8;
+
+        // Take the measured interval between the samples, and learn the level again
+        void configure(std::uint32_t const& sample_interval_us) noexcept;
+        // Learn the level again, e.g. after a pressure step
+        void reset() noexcept;
+        std::optional<Beat> process(
+            std::float32_t const& pressure,
+            std::uint64_t  const& timestamp,
+            std::uint32_t  const& sequence
+        ) noexcept;
+
+    private:
+        // Slope sum in 1/64 Pa, integers keep the running sum exact
+        static constexpr std::float32_t kSlopeUnitsPerPa = 64.0f;
+
+        std::size_t    slope_window = 1;
+        std::float32_t smoothing = 1.0f;
+
+        // Slope sum function
+        std::array<std::int32_t, kMaxSlopeWindow> slopes{};
+        std::size_t    slope_index = 0;
+        std::int32_t   slope_sum = 0;
+        std::int32_t   prev_slope_sum = 0;
+        std::float32_t smoothed = 0.0f;
+        std::uint64_t  prev_timestamp = 0;
+        bool           primed = false;
+
+        // Adaptive threshold, the level is the expected slope sum peak of a beat
+        std::uint64_t  learning_start = 0;
+        bool           learning = true;
+        std::int32_t   level = 0;
+        std::int32_t   beat_peak = 0;
+        bool           in_beat = false;
+        std::uint64_t  last_beat = 0;
+        std::uint64_t  last_decay = 0;
+        bool           has_last_beat = false;
+
+        // Beat-to-beat intervals and their successive squared differences, in us
+        std::array<std::uint32_t, kIntervalWindow> intervals{};
+        std::array<std::uint64_t, kIntervalWindow> squared_differences{};
+        std::size_t    interval_index = 0;
+        std::size_t    interval_count = 0;
+        std::size_t    difference_index = 0;
+        std::size_t    difference_count = 0;
+        std::uint64_t  interval_sum = 0;
+        std::uint64_t  squared_difference_sum = 0;
+
+        std::int32_t threshold() const noexcept {
+            return this->level / 2;
+        }
+        Beat makeBeat(std::uint64_t const& onset, std::uint32_t const& sequence) noexcept;
+        void clearIntervals() noexcept;
+};
+
+} // namespace bps::analysis
+
+#endif // BPS_ANALYSIS_BEAT_DETECTOR_HPP
\ No newline at end of file
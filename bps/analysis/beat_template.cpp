@@ -0,0 +1,183 @@
+#include "beat_template.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <utility>
+
+namespace bps::analysis {
+
+namespace {
+
+constexpr std::uint64_t kUsPerMs = 1000;
+
+} // anonymous namespace
+
+void BeatTemplate::configure(std::uint8_t const& beats) noexcept {
+    this->beats_per_template = beats;
+    reset();
+}
+
+void BeatTemplate::reset() noexcept {
+    std::uint8_t const beats = this->beats_per_template;
+    std::uint16_t const id = this->template_id;
+    *this = BeatTemplate{};
+    this->beats_per_template = beats;
+    // Keep counting, so a client never mixes chunks of two templates
+    this->template_id = id;
+}
+
+void BeatTemplate::process(std::float32_t const& pressure, std::uint64_t const& timestamp) noexcept {
+    Sample const current{ .timestamp = timestamp, .pressure = pressure };
+    if (this->history_count > 0) {
+        Sample const& previous = this->history[(this->history_next + kHistoryLength - 1) % kHistoryLength];
+        for (auto& capture : this->captures) {
+            if (capture.active) {
+                fill(capture, previous, current);
+            }
+        }
+    }
+    this->history[this->history_next] = current;
+    this->history_next  = (this->history_next + 1) % kHistoryLength;
+    this->history_count = std::min(this->history_count + 1, kHistoryLength);
+}
+
+void BeatTemplate::startBeat(std::uint64_t const& onset) noexcept {
+    std::uint64_t constexpr kPreOnsetUs = kPreOnsetMs * kUsPerMs;
+    if (onset < kPreOnsetUs || this->history_count < 2) {
+        return;
+    }
+    std::size_t const oldest = (this->history_next + kHistoryLength - this->history_count) % kHistoryLength;
+    std::uint64_t const start = onset - kPreOnsetUs;
+    if (this->history[oldest].timestamp > start) {
+        // Not enough history yet, e.g. right after a reset
+        return;
+    }
+    auto const capture = std::find_if(
+        this->captures.begin(),
+        this->captures.end(),
+        [](Capture const& candidate) { return !candidate.active; }
+    );
+    if (capture == this->captures.end()) {
+        return;
+    }
+
+    *capture = Capture{ .active = true, .start = start };
+    for (std::size_t i = 1; i < this->history_count && capture->active; ++i) {
+        fill(
+            *capture,
+            this->history[(oldest + i - 1) % kHistoryLength],
+            this->history[(oldest + i) % kHistoryLength]
+        );
+    }
+}
+
+std::optional<std::float32_t> BeatTemplate::takeCorrelation() noexcept {
+    return std::exchange(this->correlation, std::nullopt);
+}
+
+std::optional<BeatTemplate::Chunk> BeatTemplate::nextChunk() noexcept {
+    if (this->ready_chunks_left == 0) {
+        return std::nullopt;
+    }
+    std::size_t const first_point = (kNumChunks - this->ready_chunks_left) * Chunk::kPoints;
+    --this->ready_chunks_left;
+
+    Chunk chunk{
+        .template_id = this->template_id,
+        .beat_count  = this->ready_beat_count,
+        .first_point = static_cast<std::uint8_t>(first_point),
+        .points      = {}
+    };
+    std::copy_n(this->ready.begin() + first_point, Chunk::kPoints, chunk.points.begin());
+    return chunk;
+}
+
+void BeatTemplate::fill(Capture& capture, Sample const& from, Sample const& to) noexcept {
+    std::uint64_t constexpr kResolutionUs = kResolutionMs * kUsPerMs;
+    while (capture.next_point < kTemplatePoints) {
+        std::uint64_t const point_time = capture.start + capture.next_point * kResolutionUs;
+        if (point_time > to.timestamp) {
+            break;
+        }
+        std::float32_t fraction = 0.0f;
+        if (point_time > from.timestamp && to.timestamp > from.timestamp) {
+            fraction = static_cast<std::float32_t>(point_time - from.timestamp) /
+                       static_cast<std::float32_t>(to.timestamp - from.timestamp);
+        }
+        capture.points[capture.next_point++] = from.pressure + fraction * (to.pressure - from.pressure);
+    }
+    if (capture.next_point == kTemplatePoints) {
+        complete(capture);
+    }
+}
+
+void BeatTemplate::complete(Capture& capture) noexcept {
+    capture.active = false;
+    std::array<std::float32_t, kTemplatePoints> beat{};
+    for (std::size_t i = 0; i < kTemplatePoints; ++i) {
+        beat[i] = capture.points[i] - capture.points[0];
+    }
+    correlate(beat);
+
+    if (this->beats_per_template == 0) {
+        return;
+    }
+    for (std::size_t i = 0; i < kTemplatePoints; ++i) {
+        this->sums[i] += beat[i];
+    }
+    if (++this->beat_count < this->beats_per_template) {
+        return;
+    }
+
+    std::float32_t const scale = kPointsPerPa / static_cast<std::float32_t>(this->beat_count);
+    for (std::size_t i = 0; i < kTemplatePoints; ++i) {
+        this->ready[i] = static_cast<std::int16_t>(std::clamp<long>(
+            std::lround(this->sums[i] * scale),
+            std::numeric_limits<std::int16_t>::min(),
+            std::numeric_limits<std::int16_t>::max()
+        ));
+    }
+    this->ready_beat_count  = this->beat_count;
+    this->ready_chunks_left = kNumChunks;
+    ++this->template_id;
+
+    this->sums.fill(0.0f);
+    this->beat_count = 0;
+}
+
+void BeatTemplate::correlate(std::array<std::float32_t, kTemplatePoints> const& beat) noexcept {
+    if (this->reference_beats > 0) {
+        // Pearson correlation, one pass
+        std::float32_t beat_sum = 0.0f;
+        std::float32_t reference_sum = 0.0f;
+        std::float32_t product_sum = 0.0f;
+        std::float32_t beat_square_sum = 0.0f;
+        std::float32_t reference_square_sum = 0.0f;
+        for (std::size_t i = 0; i < kTemplatePoints; ++i) {
+            beat_sum             += beat[i];
+            reference_sum        += this->reference[i];
+            product_sum          += beat[i] * this->reference[i];
+            beat_square_sum      += beat[i] * beat[i];
+            reference_square_sum += this->reference[i] * this->reference[i];
+        }
+        std::float32_t constexpr n = static_cast<std::float32_t>(kTemplatePoints);
+        std::float32_t const covariance   = product_sum - beat_sum * reference_sum / n;
+        std::float32_t const beat_var      = beat_square_sum - beat_sum * beat_sum / n;
+        std::float32_t const reference_var = reference_square_sum - reference_sum * reference_sum / n;
+        std::float32_t const denominator   = std::sqrt(beat_var * reference_var);
+        this->correlation = (denominator > 0.0f) ? std::clamp(covariance / denominator, -1.0f, 1.0f) : 0.0f;
+    }
+
+    // Cumulative average over the first beats, then a moving one
+    this->reference_beats = std::min(this->reference_beats + 1, kReferenceBeats);
+    std::float32_t const weight = 1.0f / static_cast<std::float32_t>(this->reference_beats);
+    for (std::size_t i = 0; i < kTemplatePoints; ++i) {
+        this->reference[i] += weight * (beat[i] - this->reference[i]);
+    }
+}
+
+} // namespace bps::analysis
\ No newline at end of file
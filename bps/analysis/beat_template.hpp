@@ -0,0 +1,97 @@
+#ifndef BPS_ANALYSIS_BEAT_TEMPLATE_HPP
+#define BPS_ANALYSIS_BEAT_TEMPLATE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <stdfloat>
+#include <optional>
+
+#include "common.hpp"
+
+namespace bps::analysis {
+
+// Ensemble average of the beats of one position, aligned on their detected onsets.
+//
+// Every beat is resampled by linear interpolation to kTemplatePoints points, kResolutionMs
+// apart and starting kPreOnsetMs before the onset, then taken relative to its first point.
+// Once enough beats are complete, their average is handed out chunk by chunk.
+//
+// Each complete beat is also correlated with a reference beat, the moving average of
+// the last kReferenceBeats beats, whether templates are averaged or not.
+class BeatTemplate {
+    public:
+        using Chunk = AnalysisReport::Content::TemplateChunk;
+
+        static constexpr std::size_t   kTemplatePoints = 80;
+        static constexpr std::uint32_t kResolutionMs   = 10;
+        static constexpr std::uint32_t kPreOnsetMs     = 100;
+        static constexpr std::size_t   kNumChunks      = kTemplatePoints / Chunk::kPoints;
+        // Beats overlapping one template span at 200 bpm
+        static constexpr std::size_t   kMaxCaptures    = 3;
+        // kPreOnsetMs and one more sample at the shortest sample period
+        static constexpr std::size_t   kHistoryLength  = 64;
+        static constexpr std::float32_t kPointsPerPa   = 8.0f;
+        static constexpr std::size_t   kReferenceBeats = 8;
+
+        static_assert(kTemplatePoints % Chunk::kPoints == 0);
+        static_assert(kHistoryLength * AcquisitionConfig::kMinConversionWaitMs > kPreOnsetMs);
+
+        // 0 turns the averaging off
+        void configure(std::uint8_t const& beats_per_template) noexcept;
+        // Drop the beats in progress, the averaged ones and the reference beat
+        void reset() noexcept;
+        // Feed every sample, before startBeat() for a beat detected on it
+        void process(std::float32_t const& pressure, std::uint64_t const& timestamp) noexcept;
+        void startBeat(std::uint64_t const& onset) noexcept;
+        // Next chunk of the last complete template, one per call
+        std::optional<Chunk> nextChunk() noexcept;
+        // Correlation with the reference of the beat completed since the last call
+        std::optional<std::float32_t> takeCorrelation() noexcept;
+
+    private:
+        struct Sample {
+            std::uint64_t  timestamp = 0;
+            std::float32_t pressure = 0.0f;
+        };
+        // One beat being resampled
+        struct Capture {
+            bool          active = false;
+            // Time of the first point
+            std::uint64_t start = 0;
+            std::size_t   next_point = 0;
+            std::array<std::float32_t, kTemplatePoints> points{};
+        };
+
+        std::uint8_t beats_per_template = 0;
+
+        std::array<Sample, kHistoryLength> history{};
+        std::size_t history_next = 0;
+        std::size_t history_count = 0;
+
+        std::array<Capture, kMaxCaptures> captures{};
+
+        // Beats of the template being averaged
+        std::array<std::float32_t, kTemplatePoints> sums{};
+        std::uint8_t beat_count = 0;
+
+        // Last complete template
+        std::array<std::int16_t, kTemplatePoints> ready{};
+        std::uint8_t  ready_beat_count = 0;
+        std::size_t   ready_chunks_left = 0;
+        std::uint16_t template_id = 0;
+
+        // Moving average of the last beats, relative to their first point
+        std::array<std::float32_t, kTemplatePoints> reference{};
+        std::size_t reference_beats = 0;
+        std::optional<std::float32_t> correlation{};
+
+        // Resample "capture" between two consecutive samples
+        void fill(Capture& capture, Sample const& from, Sample const& to) noexcept;
+        void complete(Capture& capture) noexcept;
+        void correlate(std::array<std::float32_t, kTemplatePoints> const& beat) noexcept;
+};
+
+} // namespace bps::analysis
+
+#endif // BPS_ANALYSIS_BEAT_TEMPLATE_HPP
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "oscillometric_envelope.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <optional>
+
+namespace bps::analysis {
+
+namespace {
+
+constexpr double kButterworthQ = 0.70710678118654752;
+
+std::int32_t toSample(std::float32_t const& pressure) noexcept {
+    return dsp::Biquad::saturate(std::llround(static_cast<double>(pressure) * dsp::kSamplesPerPa));
+}
+
+std::float32_t toPressure(std::int32_t const& sample) noexcept {
+    return static_cast<std::float32_t>(sample / dsp::kSamplesPerPa);
+}
+
+std::uint16_t toPoints(std::float32_t const& amplitude) noexcept {
+    return static_cast<std::uint16_t>(std::clamp<std::float32_t>(
+        std::round(amplitude * OscillometricEnvelope::kPointsPerPa), 0.0f, std::numeric_limits<std::uint16_t>::max()));
+}
+
+} // anonymous namespace
+
+void OscillometricEnvelope::start(
+    std::uint32_t  const& sample_interval_us,
+    std::float32_t const& top_pressure,
+    std::float32_t const& bottom_pressure
+) noexcept {
+    double const rate_hz = 1.0e6 / static_cast<double>(std::max<std::uint32_t>(sample_interval_us, 1));
+    this->high_pass = dsp::designBiquad(dsp::BiquadType::eHighPass, kHighPassHz, kButterworthQ, rate_hz);
+    this->low_pass  = dsp::designBiquad(dsp::BiquadType::eLowPass, kLowPassHz, kButterworthQ, rate_hz);
+    this->primed = false;
+    this->detector.configure(sample_interval_us);
+    this->in_beat = false;
+    this->beat_count = 0;
+    this->top    = top_pressure;
+    this->bottom = bottom_pressure;
+}
+
+void OscillometricEnvelope::process(std::float32_t const& pressure, std::uint64_t const& timestamp) noexcept {
+    std::int32_t const sample = toSample(pressure);
+    if (!this->primed) {
+        this->oscillation_high.prime(this->high_pass, sample);
+        this->oscillation_low.prime(this->low_pass, 0);
+        this->primed = true;
+    }
+    std::float32_t const oscillation = toPressure(
+        this->oscillation_low.process(this->low_pass, this->oscillation_high.process(this->high_pass, sample)));
+
+    if (auto const beat = this->detector.process(pressure, timestamp, 0)) {
+        // A beat after a gap doesn't close the previous one, which may span several beats
+        if (this->in_beat && beat.value().interval_ms > 0) {
+            closeBeat();
+        }
+        this->in_beat = true;
+        this->beat_min = oscillation;
+        this->beat_max = oscillation;
+        this->cuff_sum = 0.0f;
+        this->cuff_samples = 0;
+    }
+    if (this->in_beat) {
+        this->beat_min = std::min(this->beat_min, oscillation);
+        this->beat_max = std::max(this->beat_max, oscillation);
+        // Averaged over whole beats, the raw pressure gives the cuff pressure without lag
+        this->cuff_sum += pressure;
+        ++this->cuff_samples;
+    }
+}
+
+void OscillometricEnvelope::closeBeat() noexcept {
+    if (this->beat_count >= kMaxBeats || this->cuff_samples == 0) {
+        return;
+    }
+    this->beats[this->beat_count++] = Beat{
+        .cuff_pressure = this->cuff_sum / static_cast<std::float32_t>(this->cuff_samples),
+        .amplitude     = this->beat_max - this->beat_min
+    };
+}
+
+void OscillometricEnvelope::finish() noexcept {
+    // The last beat is still open, it is dropped
+    this->in_beat = false;
+    std::float32_t const spacing = (this->top - this->bottom) / static_cast<std::float32_t>(Envelope::kTotalPoints);
+
+    // A single artifact beat can't make the maximum
+    std::array<std::float32_t, Envelope::kTotalPoints> sums{};
+    std::array<std::uint16_t, Envelope::kTotalPoints> counts{};
+    for (std::size_t i = 0; i < this->beat_count; ++i) {
+        std::float32_t amplitude = this->beats[i].amplitude;
+        if (i > 0 && i + 1 < this->beat_count) {
+            std::float32_t const a = this->beats[i - 1].amplitude;
+            std::float32_t const b = this->beats[i + 1].amplitude;
+            amplitude = std::max(std::min(a, b), std::min(std::max(a, b), amplitude));
+        }
+        std::float32_t const position = (this->top - this->beats[i].cuff_pressure) / spacing;
+        if (spacing <= 0.0f || position < 0.0f || position >= static_cast<std::float32_t>(Envelope::kTotalPoints)) {
+            continue;
+        }
+        std::size_t const point = static_cast<std::size_t>(position);
+        sums[point] += amplitude;
+        ++counts[point];
+    }
+
+    std::optional<std::size_t> peak{};
+    std::array<std::float32_t, Envelope::kTotalPoints> means{};
+    for (std::size_t i = 0; i < Envelope::kTotalPoints; ++i) {
+        if (counts[i] > 0) {
+            means[i] = sums[i] / static_cast<std::float32_t>(counts[i]);
+            if (!peak || means[i] > means[peak.value()]) {
+                peak = i;
+            }
+        }
+        this->points[i] = toPoints(means[i]);
+    }
+
+    this->envelope = Envelope{
+        .measurement_id = ++this->measurement_id,
+        .first_point    = 0,
+        .beat_count     = static_cast<std::uint8_t>(this->beat_count),
+        .top_pressure   = this->top - spacing / 2.0f,
+        .point_spacing  = spacing,
+        .max_pressure   = 0.0f,
+        .max_amplitude  = 0,
+        .amplitudes     = {}
+    };
+    if (peak) {
+        std::size_t const k = peak.value();
+        std::float32_t offset = 0.0f;
+        std::float32_t maximum = means[k];
+        if (k > 0 && k + 1 < Envelope::kTotalPoints && counts[k - 1] > 0 && counts[k + 1] > 0) {
+            std::float32_t const curvature = means[k - 1] - 2.0f * means[k] + means[k + 1];
+            if (curvature < 0.0f) {
+                offset  = 0.5f * (means[k - 1] - means[k + 1]) / curvature;
+                maximum = means[k] - 0.25f * (means[k - 1] - means[k + 1]) * offset;
+            }
+        }
+        this->envelope.max_pressure  = this->envelope.top_pressure - (static_cast<std::float32_t>(k) + offset) * spacing;
+        this->envelope.max_amplitude = toPoints(maximum);
+    }
+    this->ready = true;
+    this->next_point = 0;
+}
+
+std::optional<OscillometricEnvelope::Envelope> OscillometricEnvelope::nextChunk() noexcept {
+    if (!this->ready) {
+        return std::nullopt;
+    }
+    Envelope chunk = this->envelope;
+    chunk.first_point = static_cast<std::uint8_t>(this->next_point);
+    std::copy_n(this->points.begin() + this->next_point, Envelope::kPoints, chunk.amplitudes.begin());
+    this->next_point += Envelope::kPoints;
+    if (this->next_point >= Envelope::kTotalPoints) {
+        this->ready = false;
+    }
+    return chunk;
+}
+
+} // namespace bps::analysis
\ No newline at end of file
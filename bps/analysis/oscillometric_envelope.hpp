@@ -0,0 +1,83 @@
+#ifndef BPS_ANALYSIS_OSCILLOMETRIC_ENVELOPE_HPP
+#define BPS_ANALYSIS_OSCILLOMETRIC_ENVELOPE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <stdfloat>
+#include <optional>
+
+#include "common.hpp"
+#include "biquad.hpp"
+#include "beat_detector.hpp"
+
+namespace bps::analysis {
+
+// Oscillation amplitude against cuff pressure of one channel, built while it deflates.
+//
+// A band-pass separates the oscillations from the cuff pressure. Every beat found by the
+// beat detector gives the peak to peak amplitude of the oscillation, and the mean pressure
+// over the beat gives the cuff pressure it was measured at. Once the deflation is over, the amplitudes are
+// cleaned by a 3-beat median, averaged into kTotalPoints bins of cuff pressure, and the
+// largest bin is refined by parabolic interpolation.
+class OscillometricEnvelope {
+    public:
+        using Envelope = AnalysisReport::Content::Envelope;
+
+        // Band of the oscillations
+        static constexpr double kHighPassHz = 0.5;
+        static constexpr double kLowPassHz  = 10.0;
+        static constexpr std::size_t kMaxBeats = 255;
+        static constexpr std::float32_t kPointsPerPa = 16.0f;
+
+        // Start a deflation from "top_pressure" down to "bottom_pressure", sampled every
+        // "sample_interval_us" as measured on the control samples
+        void start(
+            std::uint32_t  const& sample_interval_us,
+            std::float32_t const& top_pressure,
+            std::float32_t const& bottom_pressure
+        ) noexcept;
+        void process(std::float32_t const& pressure, std::uint64_t const& timestamp) noexcept;
+        // Build the envelope of the beats measured since start()
+        void finish() noexcept;
+        // Next chunk of the last envelope, one per call
+        std::optional<Envelope> nextChunk() noexcept;
+
+    private:
+        struct Beat {
+            std::float32_t cuff_pressure;
+            std::float32_t amplitude;
+        };
+
+        dsp::BiquadCoefficients high_pass = dsp::kBypassBiquad;
+        dsp::BiquadCoefficients low_pass = dsp::kBypassBiquad;
+        dsp::Biquad oscillation_high{};
+        dsp::Biquad oscillation_low{};
+        bool primed = false;
+        BeatDetector detector{};
+
+        // Beat being measured
+        bool           in_beat = false;
+        std::float32_t beat_min = 0.0f;
+        std::float32_t beat_max = 0.0f;
+        std::float32_t cuff_sum = 0.0f;
+        std::uint32_t  cuff_samples = 0;
+
+        std::array<Beat, kMaxBeats> beats{};
+        std::size_t beat_count = 0;
+        std::float32_t top = 0.0f;
+        std::float32_t bottom = 0.0f;
+
+        // Envelope handed out by nextChunk()
+        Envelope envelope{};
+        std::array<std::uint16_t, Envelope::kTotalPoints> points{};
+        bool ready = false;
+        std::size_t next_point = 0;
+        std::uint16_t measurement_id = 0;
+
+        void closeBeat() noexcept;
+};
+
+} // namespace bps::analysis
+
+#endif // BPS_ANALYSIS_OSCILLOMETRIC_ENVELOPE_HPP
\ No newline at end of file
@@ -0,0 +1,199 @@
+#include "pulse_analyzer.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <stdfloat>
+#include <optional>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <limits>
+
+namespace bps::analysis {
+
+namespace {
+
+constexpr std::uint64_t kUsPerMs = 1000;
+
+constexpr std::array<Position, PulseAnalyzer::kNumPositions> kPositions{
+    Position::eCun,
+    Position::eGuan,
+    Position::eChi
+};
+
+} // anonymous namespace
+
+void PulseAnalyzer::configure(AcquisitionConfig const& config) noexcept {
+    this->channel_mask   = config.channel_mask;
+    this->classify_beats = config.classify_beats;
+    this->transit_delay.configure(config.channel_mask);
+    setSampleInterval(static_cast<std::uint32_t>(config.conversion_wait_ms * kUsPerMs));
+    for (auto& beat_template : this->beat_templates) {
+        beat_template.configure(config.template_beats);
+    }
+    for (auto& features : this->spectral_features) {
+        features.configure(config.spectral_harmonics);
+    }
+    for (auto& classifier : this->pulse_classifiers) {
+        classifier.reset();
+    }
+}
+
+void PulseAnalyzer::setSampleInterval(std::uint32_t const& interval_us) noexcept {
+    // The detectors learn their level again on the new timing
+    for (auto& detector : this->beat_detectors) {
+        detector.configure(interval_us);
+    }
+    this->transit_delay.setSampleInterval(interval_us);
+}
+
+void PulseAnalyzer::setClock(Clock const& microseconds) noexcept {
+    this->clock = microseconds;
+}
+
+void PulseAnalyzer::reset() noexcept {
+    for (auto& detector : this->beat_detectors) {
+        detector.reset();
+    }
+    for (auto& beat_template : this->beat_templates) {
+        beat_template.reset();
+    }
+    // The open window is dropped unscored, the samples after a reset start a new one
+    for (auto& quality : this->signal_qualities) {
+        quality.reset();
+    }
+    for (auto& features : this->spectral_features) {
+        features.reset();
+    }
+    for (auto& classifier : this->pulse_classifiers) {
+        classifier.reset();
+    }
+    this->transit_delay.reset();
+    this->window_open = false;
+    this->closed_window_quality.reset();
+}
+
+std::optional<std::uint8_t> PulseAnalyzer::getClosedWindowQuality() const noexcept {
+    return this->closed_window_quality;
+}
+
+std::size_t PulseAnalyzer::closeWindow(Reports& reports, std::size_t count) noexcept {
+    std::uint8_t best = 0;
+    for (std::size_t i = 0; i < kNumPositions; ++i) {
+        if ((this->channel_mask & (1u << i)) == 0) {
+            continue;
+        }
+        auto const quality = this->signal_qualities[i].close(this->window_first_sequence, this->window_last_sequence);
+        best = std::max(best, quality.index);
+        reports[count++] = AnalysisReport{
+            .type     = AnalysisReport::Type::eQuality,
+            .position = kPositions[i],
+            .content  = { .quality = quality }
+        };
+    }
+    this->closed_window_quality = best;
+    this->window_open = false;
+    return count;
+}
+
+AnalysisReport::Content::Classification PulseAnalyzer::classify(
+    PulseClassifier::Features const& features,
+    std::uint32_t const& sequence
+) const noexcept {
+    std::uint32_t const start = this->clock ? this->clock() : 0;
+    auto const result = PulseClassifier::infer(features);
+    std::uint32_t const elapsed = this->clock ? this->clock() - start : 0;
+    return AnalysisReport::Content::Classification{
+        .sequence     = sequence,
+        .label        = std::to_underlying(result.label),
+        .confidence   = result.confidence,
+        .inference_us = static_cast<std::uint16_t>(std::min<std::uint32_t>(elapsed, std::numeric_limits<std::uint16_t>::max()))
+    };
+}
+
+std::size_t PulseAnalyzer::process(PulseValue const& value, Reports& reports) noexcept {
+    std::array<std::float32_t, kNumPositions> const pressures{ value.cun, value.guan, value.chi };
+    std::size_t count = 0;
+
+    this->closed_window_quality.reset();
+    if (this->window_open && value.timestamp - this->window_start >= kQualityWindowMs * kUsPerMs) {
+        count = closeWindow(reports, count);
+    }
+    if (!this->window_open) {
+        this->window_open  = true;
+        this->window_start = value.timestamp;
+        this->window_first_sequence = value.sequence;
+    }
+    this->window_last_sequence = value.sequence;
+
+    this->transit_delay.process(pressures, value.timestamp);
+    for (std::size_t i = 0; i < kNumPositions; ++i) {
+        // Disabled channels read 0 Pa, there is nothing to analyse
+        if ((this->channel_mask & (1u << i)) == 0) {
+            continue;
+        }
+        this->signal_qualities[i].process(pressures[i], value.timestamp);
+        this->beat_templates[i].process(pressures[i], value.timestamp);
+        if (auto const correlation = this->beat_templates[i].takeCorrelation()) {
+            this->signal_qualities[i].addBeat(correlation.value());
+        }
+        if (this->classify_beats) {
+            this->pulse_classifiers[i].process(pressures[i], value.timestamp);
+        }
+        auto const beat = this->beat_detectors[i].process(pressures[i], value.timestamp, value.sequence);
+        if (beat) {
+            this->beat_templates[i].startBeat(beat.value().timestamp);
+            if (i == this->transit_delay.getReferencePosition()) {
+                this->transit_delay.startBeat(beat.value().sequence);
+            }
+            reports[count++] = AnalysisReport{
+                .type     = AnalysisReport::Type::eBeat,
+                .position = kPositions[i],
+                .content  = { .beat = beat.value() }
+            };
+            if (this->classify_beats) {
+                if (auto const features = this->pulse_classifiers[i].onBeat(beat.value())) {
+                    reports[count++] = AnalysisReport{
+                        .type     = AnalysisReport::Type::eClass,
+                        .position = kPositions[i],
+                        .content  = { .classification = classify(features.value(), beat.value().sequence) }
+                    };
+                }
+            }
+        }
+        // Spread over the following samples, so a template never floods the report queue
+        if (auto const chunk = this->beat_templates[i].nextChunk()) {
+            reports[count++] = AnalysisReport{
+                .type     = AnalysisReport::Type::eTemplate,
+                .position = kPositions[i],
+                .content  = { .template_chunk = chunk.value() }
+            };
+        }
+        if (auto const spectrum = this->spectral_features[i].process(pressures[i], value.timestamp, value.sequence)) {
+            reports[count++] = AnalysisReport{
+                .type     = AnalysisReport::Type::eSpectrum,
+                .position = kPositions[i],
+                .content  = { .spectrum = spectrum.value() }
+            };
+        }
+    }
+
+    TransitDelay::Estimates estimates{};
+    std::size_t const estimate_count = this->transit_delay.takeEstimates(estimates);
+    for (std::size_t i = 0; i < estimate_count; ++i) {
+        auto const& estimate = estimates[i];
+        reports[count++] = AnalysisReport{
+            .type     = AnalysisReport::Type::eTransit,
+            .position = kPositions[estimate.to],
+            .content  = { .transit = {
+                .sequence    = estimate.sequence,
+                .from        = kPositions[estimate.from],
+                .delay_us    = static_cast<std::int16_t>(std::lround(std::clamp(estimate.delay_us, -32767.0f, 32767.0f))),
+                .correlation = static_cast<std::int8_t>(std::lround(estimate.correlation * 100.0f))
+            } }
+        };
+    }
+    return count;
+}
+
+} // namespace bps::analysis
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef BPS_ANALYSIS_PULSE_ANALYZER_HPP
+#define BPS_ANALYSIS_PULSE_ANALYZER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <optional>
+
+#include "common.hpp"
+#include "beat_detector.hpp"
+#include "beat_template.hpp"
+#include "signal_quality.hpp"
+#include "spectral_features.hpp"
+#include "transit_delay.hpp"
+#include "pulse_classifier.hpp"
+
+namespace bps::analysis {
+
+// Runs the analysis stages of every position on the streamed samples, and turns
+// their results into low-rate reports for the analysis characteristic.
+class PulseAnalyzer {
+    public:
+        static constexpr std::size_t kNumPositions = 3;
+        // At most one report of each type per position and per sample
+        static constexpr std::size_t kMaxReports   = 6 * kNumPositions;
+        // Length of the windows the signal quality is scored on
+        static constexpr std::uint32_t kQualityWindowMs = 1000;
+        static constexpr std::uint8_t  kMaxQualityIndex = 100;
+
+        using Reports = std::array<AnalysisReport, kMaxReports>;
+        // Free running microsecond counter, times the beat classification
+        using Clock = std::uint32_t (*)();
+
+        // Whether the analysis asked by "config" can run at its sample period
+        static constexpr bool supports(AcquisitionConfig const& config) noexcept {
+            // The samples must be at least as dense as the template points
+            return (config.template_beats == 0 || config.conversion_wait_ms <= BeatTemplate::kResolutionMs) &&
+                   config.quality_threshold <= kMaxQualityIndex &&
+                   // Several samples per spectral frame
+                   config.spectral_harmonics <= SpectralFeatures::Spectrum::kMaxHarmonics &&
+                   (config.spectral_harmonics == 0 || config.conversion_wait_ms <= SpectralFeatures::kFrameMs / 4);
+        }
+
+        // Take the channels and the analysis settings, timed on the conversion wait
+        void configure(AcquisitionConfig const& config) noexcept;
+        // Time the beat detection and the transit delays on the measured interval between the samples
+        void setSampleInterval(std::uint32_t const& interval_us) noexcept;
+        // Without a clock, the classification reports an inference time of 0
+        void setClock(Clock const& microseconds) noexcept;
+        // Forget the signal history, e.g. when the cuff pressure steps
+        void reset() noexcept;
+        // Feed one raw streamed sample, return the number of reports written to "reports"
+        std::size_t process(PulseValue const& value, Reports& reports) noexcept;
+        // Best index of the enabled positions, when the last process() call closed a quality
+        // window. That window ended with the sample before the one passed to process().
+        std::optional<std::uint8_t> getClosedWindowQuality() const noexcept;
+
+    private:
+        std::uint8_t channel_mask = AcquisitionConfig::kAllChannels;
+        bool         classify_beats = false;
+        Clock        clock = nullptr;
+        std::array<BeatDetector, kNumPositions>  beat_detectors{};
+        std::array<BeatTemplate, kNumPositions>  beat_templates{};
+        std::array<SignalQuality, kNumPositions> signal_qualities{};
+        std::array<SpectralFeatures, kNumPositions> spectral_features{};
+        std::array<PulseClassifier, kNumPositions> pulse_classifiers{};
+        TransitDelay transit_delay{};
+
+        // Current quality window
+        bool          window_open = false;
+        std::uint64_t window_start = 0;
+        std::uint32_t window_first_sequence = 0;
+        std::uint32_t window_last_sequence = 0;
+        std::optional<std::uint8_t> closed_window_quality{};
+
+        std::size_t closeWindow(Reports& reports, std::size_t count) noexcept;
+        AnalysisReport::Content::Classification classify(
+            PulseClassifier::Features const& features,
+            std::uint32_t const& sequence
+        ) const noexcept;
+};
+
+} // namespace bps::analysis
+
+#endif // BPS_ANALYSIS_PULSE_ANALYZER_HPP
\ No newline at end of file
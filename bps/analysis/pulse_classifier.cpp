@@ -0,0 +1,76 @@
+#include "pulse_classifier.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace bps::analysis {
+
+namespace {
+
+using pulse_model::Feature;
+using pulse_model::PulseClass;
+
+constexpr std::uint64_t kUsPerMs = 1000;
+constexpr std::float32_t kAmplitudeUnitsPerPa = 16.0f;
+
+constexpr PulseClassifier::Features makeFeatures(
+    std::int32_t const& heart_rate,
+    std::int32_t const& irregularity,
+    std::int32_t const& amplitude,
+    std::int32_t const& rise_time_ms
+) noexcept {
+    return { heart_rate, irregularity, amplitude, rise_time_ms };
+}
+
+// The tables are checked wherever this file compiles: 72 bpm, regular, 800 Pa, 120 ms upstroke
+static_assert(PulseClassifier::infer(makeFeatures(720, 30, 12800, 120)).label      == PulseClass::eModerate);
+static_assert(PulseClassifier::infer(makeFeatures(720, 30, 12800, 120)).confidence == 100);
+static_assert(PulseClassifier::infer(makeFeatures(450, 30, 12800, 120)).label      == PulseClass::eSlow);
+static_assert(PulseClassifier::infer(makeFeatures(1100, 30, 12800, 120)).label     == PulseClass::eRapid);
+static_assert(PulseClassifier::infer(makeFeatures(720, 200, 12800, 120)).label     == PulseClass::eIrregular);
+static_assert(PulseClassifier::infer(makeFeatures(720, 30, 1600, 120)).label       == PulseClass::eWeak);
+static_assert(PulseClassifier::infer(makeFeatures(720, 30, 40000, 60)).label       == PulseClass::eForceful);
+
+} // anonymous namespace
+
+void PulseClassifier::reset() noexcept {
+    this->started = false;
+}
+
+void PulseClassifier::process(std::float32_t const& pressure, std::uint64_t const& timestamp) noexcept {
+    if (!this->started) {
+        return;
+    }
+    this->low = std::min(this->low, pressure);
+    if (pressure > this->high) {
+        this->high = pressure;
+        this->peak_timestamp = timestamp;
+    }
+}
+
+std::optional<PulseClassifier::Features> PulseClassifier::onBeat(Beat const& beat) noexcept {
+    std::optional<Features> features{};
+    // The first beat after a gap has no interval, the one before it is no whole beat
+    if (this->started && beat.interval_ms > 0 && beat.interval_count >= kMinIntervals && beat.mean_interval_ms > 0) {
+        std::uint64_t const rise_us = this->peak_timestamp > this->onset ? this->peak_timestamp - this->onset : 0;
+        features = Features{};
+        features.value()[std::to_underlying(Feature::eHeartRate)]    = beat.heart_rate;
+        features.value()[std::to_underlying(Feature::eIrregularity)] =
+            static_cast<std::int32_t>(std::uint32_t{beat.rmssd_ms} * 1000 / beat.mean_interval_ms);
+        features.value()[std::to_underlying(Feature::eAmplitude)]    =
+            static_cast<std::int32_t>(std::lround((this->high - this->low) * kAmplitudeUnitsPerPa));
+        features.value()[std::to_underlying(Feature::eRiseTime)]     = static_cast<std::int32_t>(rise_us / kUsPerMs);
+    }
+    this->started        = true;
+    this->onset          = beat.timestamp;
+    this->low            = std::numeric_limits<std::float32_t>::max();
+    this->high           = std::numeric_limits<std::float32_t>::lowest();
+    this->peak_timestamp = beat.timestamp;
+    return features;
+}
+
+} // namespace bps::analysis
\ No newline at end of file
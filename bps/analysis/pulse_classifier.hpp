@@ -0,0 +1,78 @@
+#ifndef BPS_ANALYSIS_PULSE_CLASSIFIER_HPP
+#define BPS_ANALYSIS_PULSE_CLASSIFIER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <stdfloat>
+#include <optional>
+
+#include "common.hpp"
+#include "pulse_model.hpp"
+
+namespace bps::analysis {
+
+// Pulse character of each beat of one position, from the tree ensemble of pulse_model.
+//
+// The pressure between two detections holds the peak of the first beat and the foot
+// of the second, so its range is the amplitude of the first beat. When the next beat
+// is detected, the features of the beat that just ended are quantised and run
+// through the trees, in integers only.
+class PulseClassifier {
+    public:
+        using Features = pulse_model::Features;
+        using Beat     = AnalysisReport::Content::Beat;
+
+        // Intervals a rhythm needs before it is judged
+        static constexpr std::uint8_t kMinIntervals = 2;
+
+        struct Result {
+            pulse_model::PulseClass label;
+            // Share of the votes cast for "label", in percent
+            std::uint8_t confidence;
+        };
+
+        // The inference alone, usable at compile time and off the device
+        static constexpr Result infer(Features const& features) noexcept {
+            std::array<std::uint32_t, pulse_model::kClassCount> votes{};
+            std::uint32_t total = 0;
+            for (auto const& tree : pulse_model::kTrees) {
+                std::size_t node = 0;
+                while (tree[node].feature != pulse_model::Node::kLeaf) {
+                    node = (features[tree[node].feature] <= tree[node].threshold) ? tree[node].below : tree[node].above;
+                }
+                votes[static_cast<std::size_t>(tree[node].label)] += tree[node].weight;
+                total += tree[node].weight;
+            }
+            std::size_t best = 0;
+            for (std::size_t i = 1; i < votes.size(); ++i) {
+                if (votes[i] > votes[best]) {
+                    best = i;
+                }
+            }
+            return Result{
+                .label      = static_cast<pulse_model::PulseClass>(best),
+                .confidence = static_cast<std::uint8_t>(total > 0 ? votes[best] * 100 / total : 0)
+            };
+        }
+
+        // Forget the beat in progress
+        void reset() noexcept;
+        // Feed every sample of the position, before onBeat() for a beat detected on it
+        void process(std::float32_t const& pressure, std::uint64_t const& timestamp) noexcept;
+        // A beat was detected on the last processed sample, return the features of the
+        // previous beat once a whole one lies between the two
+        std::optional<Features> onBeat(Beat const& beat) noexcept;
+
+    private:
+        // Beat in progress, since its detection
+        bool           started = false;
+        std::uint64_t  onset = 0;
+        std::float32_t low = 0.0_pa;
+        std::float32_t high = 0.0_pa;
+        std::uint64_t  peak_timestamp = 0;
+};
+
+} // namespace bps::analysis
+
+#endif // BPS_ANALYSIS_PULSE_CLASSIFIER_HPP
\ No newline at end of file
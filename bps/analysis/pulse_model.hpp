@@ -0,0 +1,120 @@
+#ifndef BPS_ANALYSIS_PULSE_MODEL_HPP
+#define BPS_ANALYSIS_PULSE_MODEL_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+
+namespace bps::analysis::pulse_model {
+
+// Weights of the on-device pulse classifier, a small ensemble of decision trees.
+//
+// Everything is integer: the features are quantised to the units below, a split
+// compares one feature with an integer threshold, and every tree casts one vote
+// of its leaf weight, in 1/256, for the class of the leaf. A model trained off the
+// device is exported to these tables unchanged, as long as it keeps the features.
+
+// Feature vector of one beat, indices of Features
+enum class Feature : std::uint8_t {
+    // Instantaneous heart rate, in 0.1 bpm
+    eHeartRate    = 0,
+    // Root mean square of successive interval differences over the mean interval, in 1/1000
+    eIrregularity = 1,
+    // Peak to peak pressure of the beat, in 1/16 Pa
+    eAmplitude    = 2,
+    // From the start of the upstroke to the peak, in ms
+    eRiseTime     = 3
+};
+inline constexpr std::size_t kFeatureCount = 4;
+using Features = std::array<std::int32_t, kFeatureCount>;
+
+// Labels of the classes, streamed as is
+enum class PulseClass : std::uint8_t {
+    eModerate  = 0,
+    eSlow      = 1,
+    eRapid     = 2,
+    eIrregular = 3,
+    eWeak      = 4,
+    eForceful  = 5
+};
+inline constexpr std::size_t kClassCount = 6;
+
+struct Node {
+    static constexpr std::uint8_t kLeaf = 0xFF;
+
+    // Feature compared, kLeaf for a leaf
+    std::uint8_t  feature;
+    // A split goes to "below" when the feature is at most "threshold", to "above" otherwise
+    std::int32_t  threshold;
+    std::uint8_t  below;
+    std::uint8_t  above;
+    // Vote of a leaf
+    PulseClass    label;
+    std::uint8_t  weight;
+};
+
+inline constexpr std::size_t kMaxNodes = 8;
+inline constexpr std::size_t kTreeCount = 5;
+using Tree = std::array<Node, kMaxNodes>;
+
+constexpr Node split(Feature const& feature, std::int32_t const& threshold, std::uint8_t const& below, std::uint8_t const& above) noexcept {
+    return Node{ .feature = static_cast<std::uint8_t>(feature), .threshold = threshold, .below = below, .above = above,
+                 .label = PulseClass::eModerate, .weight = 0 };
+}
+
+constexpr Node leaf(PulseClass const& label, std::uint8_t const& weight) noexcept {
+    return Node{ .feature = Node::kLeaf, .threshold = 0, .below = 0, .above = 0, .label = label, .weight = weight };
+}
+
+// Rule-derived starting point: each tree looks at one side of the pulse, and its
+// moderate leaves vote low so a single abnormal side outweighs them
+inline constexpr std::array<Tree, kTreeCount> kTrees{{
+    // Rate, slow below 60 bpm and rapid above 90 bpm
+    {{
+        split(Feature::eHeartRate, 600, 1, 2),
+        leaf(PulseClass::eSlow, 224),
+        split(Feature::eHeartRate, 900, 3, 4),
+        leaf(PulseClass::eModerate, 64),
+        leaf(PulseClass::eRapid, 224)
+    }},
+    // Rhythm
+    {{
+        split(Feature::eIrregularity, 80, 1, 2),
+        leaf(PulseClass::eModerate, 32),
+        split(Feature::eIrregularity, 150, 3, 4),
+        leaf(PulseClass::eIrregular, 160),
+        leaf(PulseClass::eIrregular, 255)
+    }},
+    // Strength, weak below 200 Pa and forceful above 2000 Pa
+    {{
+        split(Feature::eAmplitude, 3200, 1, 2),
+        leaf(PulseClass::eWeak, 224),
+        split(Feature::eAmplitude, 32000, 3, 4),
+        leaf(PulseClass::eModerate, 64),
+        leaf(PulseClass::eForceful, 224)
+    }},
+    // Upstroke, a sharp and large one is forceful, a slow one weak
+    {{
+        split(Feature::eRiseTime, 80, 1, 4),
+        split(Feature::eAmplitude, 16000, 2, 3),
+        leaf(PulseClass::eModerate, 32),
+        leaf(PulseClass::eForceful, 192),
+        split(Feature::eRiseTime, 200, 5, 6),
+        leaf(PulseClass::eModerate, 32),
+        leaf(PulseClass::eWeak, 160)
+    }},
+    // Rate of a regular rhythm, an irregular one makes the rate meaningless
+    {{
+        split(Feature::eIrregularity, 150, 1, 4),
+        split(Feature::eHeartRate, 550, 2, 3),
+        leaf(PulseClass::eSlow, 160),
+        split(Feature::eHeartRate, 1000, 5, 6),
+        leaf(PulseClass::eIrregular, 192),
+        leaf(PulseClass::eModerate, 32),
+        leaf(PulseClass::eRapid, 160)
+    }}
+}};
+
+} // namespace bps::analysis::pulse_model
+
+#endif // BPS_ANALYSIS_PULSE_MODEL_HPP
\ No newline at end of file
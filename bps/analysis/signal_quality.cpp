@@ -0,0 +1,84 @@
+#include "signal_quality.hpp"
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+namespace bps::analysis {
+
+namespace {
+
+constexpr std::float32_t kUsPerMs = 1000.0f;
+
+std::uint8_t toPercent(std::uint32_t const& count, std::uint32_t const& total) noexcept {
+    return static_cast<std::uint8_t>((count * 100u + total / 2u) / total);
+}
+
+} // anonymous namespace
+
+void SignalQuality::reset() noexcept {
+    *this = SignalQuality{};
+}
+
+void SignalQuality::process(std::float32_t const& pressure, std::uint64_t const& timestamp) noexcept {
+    if (pressure <= kLowSaturationPa || pressure >= kHighSaturationPa) {
+        ++this->saturated_count;
+    }
+    if (this->sample_count == 0) {
+        this->minimum = pressure;
+        this->maximum = pressure;
+    } else {
+        this->minimum = std::min(this->minimum, pressure);
+        this->maximum = std::max(this->maximum, pressure);
+        std::float32_t const elapsed_ms = static_cast<std::float32_t>(timestamp - this->prev_timestamp) / kUsPerMs;
+        if (std::fabs(pressure - this->prev_pressure) > kMaxSlopePaPerMs * elapsed_ms) {
+            ++this->steep_count;
+        }
+    }
+    this->prev_pressure  = pressure;
+    this->prev_timestamp = timestamp;
+    ++this->sample_count;
+}
+
+void SignalQuality::addBeat(std::float32_t const& correlation) noexcept {
+    ++this->beat_count;
+    this->correlation_sum += correlation;
+}
+
+SignalQuality::Quality SignalQuality::close(
+    std::uint32_t const& first_sequence,
+    std::uint32_t const& last_sequence
+) noexcept {
+    Quality quality{
+        .first_sequence    = first_sequence,
+        .last_sequence     = last_sequence,
+        .index             = 0,
+        .saturated_percent = 0,
+        .steep_percent     = 0,
+        .flatline          = 0,
+        .correlation       = 0,
+        .beat_count        = static_cast<std::uint8_t>(std::min<std::uint32_t>(this->beat_count, std::numeric_limits<std::uint8_t>::max()))
+    };
+    if (this->sample_count > 0) {
+        quality.saturated_percent = toPercent(this->saturated_count, this->sample_count);
+        // One step less than samples
+        quality.steep_percent = (this->sample_count > 1) ? toPercent(this->steep_count, this->sample_count - 1) : 0;
+        quality.flatline = (this->maximum - this->minimum < kFlatlinePa) ? 1 : 0;
+    }
+    if (this->beat_count > 0) {
+        std::float32_t const correlation = this->correlation_sum / static_cast<std::float32_t>(this->beat_count);
+        quality.correlation = static_cast<std::int8_t>(std::lround(correlation * 100.0f));
+        if (quality.flatline == 0) {
+            std::float32_t const index = 100.0f
+                                       * (1.0f - quality.saturated_percent / 100.0f)
+                                       * (1.0f - quality.steep_percent / 100.0f)
+                                       * std::max(correlation, 0.0f);
+            quality.index = static_cast<std::uint8_t>(std::lround(index));
+        }
+    }
+    reset();
+    return quality;
+}
+
+} // namespace bps::analysis
\ No newline at end of file
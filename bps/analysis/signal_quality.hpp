@@ -0,0 +1,53 @@
+#ifndef BPS_ANALYSIS_SIGNAL_QUALITY_HPP
+#define BPS_ANALYSIS_SIGNAL_QUALITY_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <stdfloat>
+
+#include "common.hpp"
+
+namespace bps::analysis {
+
+// Signal quality index of one position over a window of samples, constant work per sample.
+//
+// The index starts from 100 and is scaled down by the share of saturated readings, by
+// the share of steps steeper than any pulse upstroke (motion, cuff knocks) and by the
+// mean correlation of the window beats with the reference beat. A flat window or a
+// window without beat scores 0.
+class SignalQuality {
+    public:
+        using Quality = AnalysisReport::Content::Quality;
+
+        // Readings clamp to the XGZP6857D range
+        static constexpr std::float32_t kLowSaturationPa  = 0.0f;
+        static constexpr std::float32_t kHighSaturationPa = 100000.0f;
+        // Peak to peak below which the window is taken for a disconnected sensor
+        static constexpr std::float32_t kFlatlinePa       = 2.0f;
+        // A pulse upstroke rises by a few Pa per ms at most
+        static constexpr std::float32_t kMaxSlopePaPerMs  = 20.0f;
+
+        // Start a new window
+        void reset() noexcept;
+        void process(std::float32_t const& pressure, std::uint64_t const& timestamp) noexcept;
+        // Correlation of a beat completed in the window, from -1 to 1
+        void addBeat(std::float32_t const& correlation) noexcept;
+        // Score the window and start a new one
+        Quality close(std::uint32_t const& first_sequence, std::uint32_t const& last_sequence) noexcept;
+
+    private:
+        std::uint32_t  sample_count = 0;
+        std::uint32_t  saturated_count = 0;
+        std::uint32_t  steep_count = 0;
+        std::float32_t minimum = 0.0f;
+        std::float32_t maximum = 0.0f;
+        std::float32_t prev_pressure = 0.0f;
+        std::uint64_t  prev_timestamp = 0;
+
+        std::uint32_t  beat_count = 0;
+        std::float32_t correlation_sum = 0.0f;
+};
+
+} // namespace bps::analysis
+
+#endif // BPS_ANALYSIS_SIGNAL_QUALITY_HPP
\ No newline at end of file
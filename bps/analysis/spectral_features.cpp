@@ -0,0 +1,209 @@
+#include "spectral_features.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <numbers>
+#include <optional>
+
+#include "real_fft.hpp"
+#include "trigonometry.hpp"
+
+namespace bps::analysis {
+
+namespace {
+
+using Fft = dsp::RealFft<SpectralFeatures::kWindowFrames>;
+
+constexpr std::uint64_t kUsPerMs   = 1000;
+constexpr std::size_t   kN         = SpectralFeatures::kWindowFrames;
+constexpr std::float32_t kBinHz    = 1000.0f / static_cast<std::float32_t>(SpectralFeatures::kFrameMs * kN);
+constexpr std::size_t   kMinBin    = static_cast<std::size_t>(SpectralFeatures::kMinFundamentalHz / kBinHz);
+constexpr std::size_t   kMaxBin    = static_cast<std::size_t>(SpectralFeatures::kMaxFundamentalHz / kBinHz) + 1;
+static_assert(kMinBin >= 1 && kMaxBin + 1 < kN / 2);
+
+constexpr std::float32_t kPi = std::numbers::pi_v<std::float32_t>;
+constexpr std::float32_t kPointsPerPa   = 16.0f;
+constexpr std::float32_t kPointsPerRad  = 10000.0f;
+
+// Symmetric Hann window, and its sum (twice the amplitude gain)
+constexpr std::array<std::float32_t, kN> kHann = [] {
+    std::array<std::float32_t, kN> window{};
+    for (std::size_t i = 0; i < kN; ++i) {
+        window[i] = static_cast<std::float32_t>(0.5 - 0.5 * dsp::cosine(2.0 * dsp::kPi * static_cast<double>(i) / static_cast<double>(kN - 1)));
+    }
+    return window;
+}();
+constexpr std::float32_t kHannSum = [] {
+    std::float32_t sum = 0.0f;
+    for (auto const& w : kHann) {
+        sum += w;
+    }
+    return sum;
+}();
+
+// Hann response to a tone "offset" bins off the bin centre, 1 at the centre
+std::float32_t hannResponse(std::float32_t const& offset) noexcept {
+    if (std::fabs(offset) < 1e-4f) {
+        return 1.0f;
+    }
+    std::float32_t const x = kPi * offset;
+    return (std::sin(x) / x) / (1.0f - offset * offset);
+}
+
+// Gain of the frame averaging at "frequency_hz"
+std::float32_t frameResponse(std::float32_t const& frequency_hz) noexcept {
+    std::float32_t const x = kPi * frequency_hz * static_cast<std::float32_t>(SpectralFeatures::kFrameMs) / 1000.0f;
+    return (x < 1e-4f) ? 1.0f : std::sin(x) / x;
+}
+
+std::float32_t wrapPhase(std::float32_t phase) noexcept {
+    phase = std::fmod(phase + kPi, 2.0f * kPi);
+    return (phase < 0.0f) ? (phase + kPi) : (phase - kPi);
+}
+
+std::float32_t magnitude(Fft::Buffer const& spectrum, std::size_t const& bin) noexcept {
+    return std::hypot(spectrum[2 * bin], spectrum[2 * bin + 1]);
+}
+
+} // anonymous namespace
+
+void SpectralFeatures::configure(std::uint8_t const& count) noexcept {
+    this->harmonics = std::min<std::uint8_t>(count, Spectrum::kMaxHarmonics);
+    reset();
+}
+
+void SpectralFeatures::reset() noexcept {
+    this->started = false;
+    this->frame_sum = 0.0f;
+    this->frame_samples = 0;
+    this->frame_next = 0;
+    this->frame_count = 0;
+    this->frames_since_window = 0;
+}
+
+std::optional<SpectralFeatures::Spectrum> SpectralFeatures::process(
+    std::float32_t const& pressure,
+    std::uint64_t  const& timestamp,
+    std::uint32_t  const& sequence
+) noexcept {
+    if (this->harmonics == 0) {
+        return std::nullopt;
+    }
+    if (this->started && timestamp >= this->frame_end + kMaxGapMs * kUsPerMs) {
+        reset();
+    }
+    if (!this->started) {
+        this->started   = true;
+        this->frame_end = timestamp + kFrameMs * kUsPerMs;
+    }
+
+    std::optional<Spectrum> spectrum{};
+    while (timestamp >= this->frame_end) {
+        // A frame without sample, after a failed read, repeats the previous one
+        std::float32_t const value = (this->frame_samples > 0)
+                                   ? this->frame_sum / static_cast<std::float32_t>(this->frame_samples)
+                                   : this->last_frame;
+        this->frame_sum     = 0.0f;
+        this->frame_samples = 0;
+        this->frame_end    += kFrameMs * kUsPerMs;
+        if (auto const result = pushFrame(value)) {
+            spectrum = result;
+        }
+    }
+    this->frame_sum += pressure;
+    ++this->frame_samples;
+    this->last_sequence = sequence;
+    return spectrum;
+}
+
+std::optional<SpectralFeatures::Spectrum> SpectralFeatures::pushFrame(std::float32_t const& value) noexcept {
+    this->last_frame = value;
+    this->frames[this->frame_next] = value;
+    this->frame_next = (this->frame_next + 1) % kWindowFrames;
+    this->frame_count = std::min(this->frame_count + 1, kWindowFrames);
+    ++this->frames_since_window;
+    if (this->frame_count < kWindowFrames || this->frames_since_window < kHopFrames) {
+        return std::nullopt;
+    }
+    this->frames_since_window = 0;
+    return analyse();
+}
+
+SpectralFeatures::Spectrum SpectralFeatures::analyse() noexcept {
+    Spectrum spectrum{
+        .last_sequence   = this->last_sequence,
+        .fundamental_mhz = 0,
+        .harmonic_count  = this->harmonics,
+        .amplitudes      = {},
+        .phases          = {}
+    };
+
+    // Oldest frame first, without the least squares line (the slow cuff pressure drift)
+    std::float32_t constexpr middle = static_cast<std::float32_t>(kN - 1) / 2.0f;
+    std::float32_t mean = 0.0f;
+    std::float32_t slope = 0.0f;
+    std::float32_t spread = 0.0f;
+    for (std::size_t i = 0; i < kN; ++i) {
+        this->work[i] = this->frames[(this->frame_next + i) % kWindowFrames];
+        mean += this->work[i];
+    }
+    mean /= static_cast<std::float32_t>(kN);
+    for (std::size_t i = 0; i < kN; ++i) {
+        std::float32_t const x = static_cast<std::float32_t>(i) - middle;
+        slope  += x * (this->work[i] - mean);
+        spread += x * x;
+    }
+    slope /= spread;
+    for (std::size_t i = 0; i < kN; ++i) {
+        std::float32_t const x = static_cast<std::float32_t>(i) - middle;
+        this->work[i] = (this->work[i] - mean - slope * x) * kHann[i];
+    }
+    Fft::transform(this->work);
+
+    std::size_t peak = kMinBin;
+    std::float32_t peak_magnitude = magnitude(this->work, peak);
+    for (std::size_t bin = kMinBin + 1; bin <= kMaxBin; ++bin) {
+        if (std::float32_t const value = magnitude(this->work, bin); value > peak_magnitude) {
+            peak = bin;
+            peak_magnitude = value;
+        }
+    }
+    std::float32_t const left  = magnitude(this->work, peak - 1);
+    std::float32_t const right = magnitude(this->work, peak + 1);
+    std::float32_t const curvature = left - 2.0f * peak_magnitude + right;
+    if (peak_magnitude <= 0.0f || curvature >= 0.0f) {
+        // Flat window, or the largest value sits on the edge of the search range
+        return spectrum;
+    }
+    std::float32_t const fundamental = static_cast<std::float32_t>(peak) + 0.5f * (left - right) / curvature;
+    spectrum.fundamental_mhz = static_cast<std::uint16_t>(std::lround(fundamental * kBinHz * 1000.0f));
+
+    std::float32_t fundamental_phase = 0.0f;
+    for (std::size_t rank = 1; rank <= this->harmonics; ++rank) {
+        std::float32_t const frequency = fundamental * static_cast<std::float32_t>(rank);
+        std::size_t const bin = static_cast<std::size_t>(std::lround(frequency));
+        if (bin >= kN / 2) {
+            // Above the frame rate Nyquist frequency, left at zero
+            break;
+        }
+        std::float32_t const offset = frequency - static_cast<std::float32_t>(bin);
+        std::float32_t const amplitude = 2.0f * magnitude(this->work, bin) /
+                                         (kHannSum * hannResponse(offset) * frameResponse(frequency * kBinHz));
+        // Phase at the window start, the symmetric window delays an off-centre tone
+        std::float32_t const phase = std::atan2(this->work[2 * bin + 1], this->work[2 * bin])
+                                   - kPi * offset * static_cast<std::float32_t>(kN - 1) / static_cast<std::float32_t>(kN);
+        if (rank == 1) {
+            fundamental_phase = phase;
+        }
+        std::float32_t const relative = wrapPhase(phase - static_cast<std::float32_t>(rank) * fundamental_phase);
+        spectrum.amplitudes[rank - 1] = static_cast<std::uint16_t>(std::min<std::float32_t>(
+            std::round(amplitude * kPointsPerPa), std::numeric_limits<std::uint16_t>::max()));
+        spectrum.phases[rank - 1] = static_cast<std::int16_t>(std::lround(relative * kPointsPerRad));
+    }
+    return spectrum;
+}
+
+} // namespace bps::analysis
\ No newline at end of file
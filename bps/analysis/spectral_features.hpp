@@ -0,0 +1,72 @@
+#ifndef BPS_ANALYSIS_SPECTRAL_FEATURES_HPP
+#define BPS_ANALYSIS_SPECTRAL_FEATURES_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <stdfloat>
+#include <optional>
+
+#include "common.hpp"
+
+namespace bps::analysis {
+
+// Fundamental and harmonics of one position, over overlapping windows of the pressure.
+//
+// The samples are averaged into kFrameMs frames, which holds whole cycles of 50 Hz
+// mains and takes the FFT size off the sample period. Every kHopFrames frames, the
+// last kWindowFrames ones are detrended, Hann windowed and transformed. The largest
+// peak between kMinFundamentalHz and kMaxFundamentalHz gives the fundamental, refined
+// by parabolic interpolation, and each harmonic is read at its rank times that frequency.
+class SpectralFeatures {
+    public:
+        using Spectrum = AnalysisReport::Content::Spectrum;
+
+        static constexpr std::uint32_t kFrameMs      = 40;
+        // 10.24 s windows with a 0.1 Hz resolution, one every 5.12 s
+        static constexpr std::size_t   kWindowFrames = 256;
+        static constexpr std::size_t   kHopFrames    = kWindowFrames / 2;
+        // 30 to 210 bpm
+        static constexpr std::float32_t kMinFundamentalHz = 0.5f;
+        static constexpr std::float32_t kMaxFundamentalHz = 3.5f;
+        // A longer gap in the samples starts the windows again
+        static constexpr std::uint32_t kMaxGapMs     = 1000;
+
+        // Number of harmonics to report, 0 turns the stage off
+        void configure(std::uint8_t const& harmonics) noexcept;
+        // Drop the frames, the next window starts from scratch
+        void reset() noexcept;
+        // Return the spectrum of the window completed by this sample, if any
+        std::optional<Spectrum> process(
+            std::float32_t const& pressure,
+            std::uint64_t  const& timestamp,
+            std::uint32_t  const& sequence
+        ) noexcept;
+
+    private:
+        std::uint8_t harmonics = 0;
+
+        // Frame being averaged
+        bool           started = false;
+        std::uint64_t  frame_end = 0;
+        std::float32_t frame_sum = 0.0f;
+        std::uint32_t  frame_samples = 0;
+        std::float32_t last_frame = 0.0f;
+        std::uint32_t  last_sequence = 0;
+
+        // Ring of the last frames
+        std::array<std::float32_t, kWindowFrames> frames{};
+        std::size_t frame_next = 0;
+        std::size_t frame_count = 0;
+        std::size_t frames_since_window = 0;
+
+        // FFT input and output, in place
+        std::array<std::float32_t, kWindowFrames> work{};
+
+        std::optional<Spectrum> pushFrame(std::float32_t const& value) noexcept;
+        Spectrum analyse() noexcept;
+};
+
+} // namespace bps::analysis
+
+#endif // BPS_ANALYSIS_SPECTRAL_FEATURES_HPP
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "summary_statistics.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <limits>
+
+namespace bps::analysis {
+
+namespace {
+
+constexpr std::uint64_t kUsPerMs = 1000;
+
+} // anonymous namespace
+
+void SummaryStatistics::configure(AcquisitionConfig const& config) noexcept {
+    this->window_us    = config.summary_window_ms * kUsPerMs;
+    this->channel_mask = config.channel_mask;
+    reset();
+}
+
+void SummaryStatistics::reset() noexcept {
+    this->count = 0;
+}
+
+std::optional<PulseSummary> SummaryStatistics::process(PulseValue const& value) noexcept {
+    if (this->window_us == 0) {
+        return std::nullopt;
+    }
+    std::optional<PulseSummary> summary{};
+    if (this->count > 0 &&
+        (value.timestamp - this->first_timestamp >= this->window_us || value.segment != this->segment)) {
+        summary = close();
+        this->count = 0;
+    }
+    if (this->count == 0) {
+        this->first_timestamp = value.timestamp;
+        this->first_sequence  = value.sequence;
+        this->segment         = value.segment;
+    }
+    add({ value.cun, value.guan, value.chi });
+    return summary;
+}
+
+void SummaryStatistics::add(std::array<std::float32_t, kNumPositions> const& pressures) noexcept {
+    ++this->count;
+    std::float32_t const weight = 1.0f / static_cast<std::float32_t>(this->count);
+    for (std::size_t i = 0; i < kNumPositions; ++i) {
+        auto& accumulator = this->accumulators[i];
+        std::float32_t const pressure = pressures[i];
+        if (this->count == 1) {
+            accumulator = Accumulator{ .min = pressure, .max = pressure, .mean = pressure, .m2 = 0.0f };
+            continue;
+        }
+        accumulator.min = std::min(accumulator.min, pressure);
+        accumulator.max = std::max(accumulator.max, pressure);
+        std::float32_t const deviation = pressure - accumulator.mean;
+        accumulator.mean += deviation * weight;
+        accumulator.m2   += deviation * (pressure - accumulator.mean);
+    }
+}
+
+PulseSummary SummaryStatistics::close() const noexcept {
+    PulseSummary summary{
+        .timestamp      = this->first_timestamp,
+        .first_sequence = this->first_sequence,
+        .sample_count   = static_cast<std::uint16_t>(std::min<std::uint32_t>(this->count, std::numeric_limits<std::uint16_t>::max())),
+        .segment        = this->segment,
+        .channel_mask   = this->channel_mask,
+        .channels       = {}
+    };
+    for (std::size_t i = 0; i < kNumPositions; ++i) {
+        if ((this->channel_mask & (1u << i)) == 0) {
+            continue;
+        }
+        auto const& accumulator = this->accumulators[i];
+        summary.channels[i] = PulseSummary::Channel{
+            .min      = accumulator.min,
+            .max      = accumulator.max,
+            .mean     = accumulator.mean,
+            .variance = accumulator.m2 / static_cast<std::float32_t>(this->count)
+        };
+    }
+    return summary;
+}
+
+} // namespace bps::analysis
\ No newline at end of file
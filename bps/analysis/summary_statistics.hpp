@@ -0,0 +1,65 @@
+#ifndef BPS_ANALYSIS_SUMMARY_STATISTICS_HPP
+#define BPS_ANALYSIS_SUMMARY_STATISTICS_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <stdfloat>
+#include <optional>
+
+#include "common.hpp"
+
+namespace bps::analysis {
+
+// Minimum, maximum, mean and variance of every enabled channel over fixed windows.
+//
+// One pass and constant work per sample: the mean and the sum of squared deviations
+// are updated with Welford's recurrence, which stays accurate in single precision
+// even though the pulse rides on a cuff pressure a thousand times larger.
+class SummaryStatistics {
+    public:
+        static constexpr std::size_t kNumPositions = 3;
+        static constexpr std::uint16_t kMinWindowMs = 100;
+        static constexpr std::uint16_t kMaxWindowMs = 60000;
+
+        // Whether the summaries asked by "config" can be computed
+        static constexpr bool supports(AcquisitionConfig const& config) noexcept {
+            return config.summary_window_ms == 0 ||
+                   (config.summary_window_ms >= kMinWindowMs &&
+                    config.summary_window_ms <= kMaxWindowMs &&
+                    config.summary_window_ms >= config.conversion_wait_ms);
+        }
+
+        void configure(AcquisitionConfig const& config) noexcept;
+        // Drop the open window
+        void reset() noexcept;
+        // Feed one streamed sample, return the window it closed. A window closes on the
+        // first sample past its length, or of another segment, which starts the next one.
+        std::optional<PulseSummary> process(PulseValue const& value) noexcept;
+
+    private:
+        struct Accumulator {
+            std::float32_t min;
+            std::float32_t max;
+            std::float32_t mean;
+            // Sum of the squared deviations from the mean
+            std::float32_t m2;
+        };
+
+        std::uint64_t window_us = 0;
+        std::uint8_t  channel_mask = AcquisitionConfig::kAllChannels;
+
+        // Open window
+        std::uint32_t count = 0;
+        std::uint64_t first_timestamp = 0;
+        std::uint32_t first_sequence = 0;
+        PressureType  segment = PressureType::eNull;
+        std::array<Accumulator, kNumPositions> accumulators{};
+
+        PulseSummary close() const noexcept;
+        void add(std::array<std::float32_t, kNumPositions> const& pressures) noexcept;
+};
+
+} // namespace bps::analysis
+
+#endif // BPS_ANALYSIS_SUMMARY_STATISTICS_HPP
\ No newline at end of file
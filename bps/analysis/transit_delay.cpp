@@ -0,0 +1,159 @@
+#include "transit_delay.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <numbers>
+
+namespace bps::analysis {
+
+namespace {
+
+constexpr std::uint32_t kUsPerMs = 1000;
+
+constexpr std::size_t ceilDivide(std::uint32_t const& value, std::uint32_t const& divisor) noexcept {
+    return (value + divisor - 1) / divisor;
+}
+
+} // anonymous namespace
+
+void TransitDelay::configure(std::uint8_t const& channel_mask) noexcept {
+    this->position_count = 0;
+    for (std::size_t i = 0; i < kNumPositions; ++i) {
+        if (channel_mask & (1u << i)) {
+            this->positions[this->position_count++] = i;
+        }
+    }
+    reset();
+}
+
+void TransitDelay::setSampleInterval(std::uint32_t const& sample_interval_us) noexcept {
+    // The history is sized for the shortest interval
+    std::uint32_t const interval_us = std::max<std::uint32_t>(sample_interval_us, kMinPeriodMs * kUsPerMs);
+    this->pre_samples  = ceilDivide(kPreDetectionMs * kUsPerMs, interval_us);
+    this->post_samples = ceilDivide(kPostDetectionMs * kUsPerMs, interval_us);
+    this->max_lag      = ceilDivide(kMaxLagMs * kUsPerMs, interval_us);
+    // One pole low-pass, matched at DC to the continuous one
+    this->smoothing = 1.0f - std::exp(-2.0f * std::numbers::pi_v<float> * kSmoothingHz * static_cast<std::float32_t>(interval_us) / 1.0e6f);
+    reset();
+}
+
+void TransitDelay::reset() noexcept {
+    this->sample_count = 0;
+    this->pending      = false;
+    this->ready_count  = 0;
+}
+
+std::size_t TransitDelay::getReferencePosition() const noexcept {
+    return this->position_count >= 2 ? this->positions[0] : kNumPositions;
+}
+
+void TransitDelay::process(
+    std::array<std::float32_t, kNumPositions> const& pressures,
+    std::uint64_t const& timestamp
+) noexcept {
+    std::size_t const index = this->sample_count % kHistoryLength;
+    for (std::size_t i = 0; i < kNumPositions; ++i) {
+        if (this->sample_count == 0) {
+            this->smoothed[i] = pressures[i];
+        }
+        std::float32_t const prev_smoothed = this->smoothed[i];
+        this->smoothed[i] += this->smoothing * (pressures[i] - this->smoothed[i]);
+        this->differences[i][index] = this->smoothed[i] - prev_smoothed;
+    }
+    this->timestamps[index] = timestamp;
+    ++this->sample_count;
+
+    if (this->pending && this->sample_count > this->beat_sample + this->post_samples + this->max_lag) {
+        this->pending = false;
+        estimate();
+    }
+}
+
+void TransitDelay::startBeat(std::uint32_t const& sequence) noexcept {
+    if (this->position_count < 2 || this->pending || this->sample_count == 0) {
+        return;
+    }
+    std::uint32_t const sample = this->sample_count - 1;
+    // The window must not reach before the reset
+    if (sample < this->pre_samples + this->max_lag) {
+        return;
+    }
+    this->pending       = true;
+    this->beat_sample   = sample;
+    this->beat_sequence = sequence;
+}
+
+std::size_t TransitDelay::takeEstimates(Estimates& estimates) noexcept {
+    std::size_t const count = this->ready_count;
+    std::copy_n(this->ready_estimates.begin(), count, estimates.begin());
+    this->ready_count = 0;
+    return count;
+}
+
+std::float32_t TransitDelay::correlate(
+    std::size_t const& from,
+    std::size_t const& to,
+    std::ptrdiff_t const& lag
+) const noexcept {
+    std::size_t const length = this->pre_samples + this->post_samples;
+    std::uint32_t const first = this->beat_sample - this->pre_samples;
+    float sum_a = 0.0f, sum_b = 0.0f, sum_aa = 0.0f, sum_bb = 0.0f, sum_ab = 0.0f;
+    for (std::size_t n = 0; n < length; ++n) {
+        float const a = this->differences[from][(first + n) % kHistoryLength];
+        float const b = this->differences[to][static_cast<std::uint32_t>(first + n + lag) % kHistoryLength];
+        sum_a  += a;
+        sum_b  += b;
+        sum_aa += a * a;
+        sum_bb += b * b;
+        sum_ab += a * b;
+    }
+    float const count = static_cast<float>(length);
+    float const variance_a = sum_aa - sum_a * sum_a / count;
+    float const variance_b = sum_bb - sum_b * sum_b / count;
+    if (variance_a <= 0.0f || variance_b <= 0.0f) {
+        return 0.0f;
+    }
+    return (sum_ab - sum_a * sum_b / count) / std::sqrt(variance_a * variance_b);
+}
+
+void TransitDelay::estimate() noexcept {
+    std::size_t const length = this->pre_samples + this->post_samples;
+    std::uint32_t const first = this->beat_sample - this->pre_samples;
+    // Measured over the window, the lags are in samples
+    float const period_us =
+        static_cast<float>(this->timestamps[(first + length - 1) % kHistoryLength] - this->timestamps[first % kHistoryLength]) /
+        static_cast<float>(length - 1);
+
+    this->ready_count = 0;
+    for (std::size_t pair = 0; pair + 1 < this->position_count; ++pair) {
+        std::size_t const from = this->positions[pair];
+        std::size_t const to   = this->positions[pair + 1];
+
+        std::array<float, kMaxLags> correlations{};
+        std::size_t const lag_count = 2 * this->max_lag + 1;
+        for (std::size_t i = 0; i < lag_count; ++i) {
+            correlations[i] = correlate(from, to, static_cast<std::ptrdiff_t>(i) - static_cast<std::ptrdiff_t>(this->max_lag));
+        }
+        std::size_t const peak = static_cast<std::size_t>(
+            std::max_element(correlations.begin(), correlations.begin() + lag_count) - correlations.begin()
+        );
+        // A peak on the edge of the lag range is no delay estimate
+        if (peak == 0 || peak == lag_count - 1) {
+            continue;
+        }
+        float const curvature = correlations[peak - 1] - 2.0f * correlations[peak] + correlations[peak + 1];
+        float const offset = (curvature < 0.0f) ? 0.5f * (correlations[peak - 1] - correlations[peak + 1]) / curvature : 0.0f;
+        float const lag = static_cast<float>(peak) - static_cast<float>(this->max_lag) + offset;
+        this->ready_estimates[this->ready_count++] = Estimate{
+            .from        = from,
+            .to          = to,
+            .sequence    = this->beat_sequence,
+            .delay_us    = lag * period_us,
+            .correlation = correlations[peak]
+        };
+    }
+}
+
+} // namespace bps::analysis
\ No newline at end of file
@@ -0,0 +1,100 @@
+#ifndef BPS_ANALYSIS_TRANSIT_DELAY_HPP
+#define BPS_ANALYSIS_TRANSIT_DELAY_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <stdfloat>
+
+#include "common.hpp"
+
+namespace bps::analysis {
+
+// Pulse transit delays between neighbouring enabled positions, one estimate per beat.
+//
+// The first difference of the smoothed pressure of every position is kept over the last
+// samples. When a beat is detected at the first enabled position, the upstroke window
+// around the detection is cross-correlated with the next enabled position for lags up
+// to kMaxLagMs, and so on down the positions. The correlation peak is refined with a parabola through its two
+// neighbours, so the delay resolves a fraction of the sample period.
+class TransitDelay {
+    public:
+        static constexpr std::size_t kNumPositions = 3;
+        static constexpr std::size_t kMaxPairs     = kNumPositions - 1;
+        // Window around the detection, the slope sum crosses its threshold during the upstroke
+        static constexpr std::uint32_t kPreDetectionMs  = 150;
+        static constexpr std::uint32_t kPostDetectionMs = 100;
+        // A few cm of radial artery take a few ms, the rest leaves room for the sensors
+        static constexpr std::uint32_t kMaxLagMs = 20;
+        // Cutoff of the smoothing ahead of the differences, the same on every position
+        static constexpr std::float32_t kSmoothingHz = 16.0f;
+        // A delay needs two channels, which take twice the bus time
+        static constexpr std::uint16_t kMinPeriodMs = AcquisitionConfig::kMinConversionWaitMs;
+        // The window and the lags on both sides, with rounding margin
+        static constexpr std::size_t kHistoryLength =
+            (kPreDetectionMs + kPostDetectionMs + 2 * kMaxLagMs) / kMinPeriodMs + 4;
+        static constexpr std::size_t kMaxLags = 2 * ((kMaxLagMs + kMinPeriodMs - 1) / kMinPeriodMs) + 1;
+
+        struct Estimate {
+            // Indices of the two positions, in the Cun, Guan, Chi order
+            std::size_t    from;
+            std::size_t    to;
+            // Streamed sample the beat was detected on
+            std::uint32_t  sequence;
+            // Arrival at "to" minus arrival at "from"
+            std::float32_t delay_us;
+            // Peak correlation, from -1 to 1
+            std::float32_t correlation;
+        };
+        using Estimates = std::array<Estimate, kMaxPairs>;
+
+        // Take the enabled positions, and reset
+        void configure(std::uint8_t const& channel_mask) noexcept;
+        // Size the window and the lags on the measured interval between the samples, and reset
+        void setSampleInterval(std::uint32_t const& sample_interval_us) noexcept;
+        // Forget the history and the beat in progress
+        void reset() noexcept;
+        // Feed every sample, before startBeat() for a beat detected on it
+        void process(std::array<std::float32_t, kNumPositions> const& pressures, std::uint64_t const& timestamp) noexcept;
+        // A beat was detected at the first enabled position on the last processed sample
+        void startBeat(std::uint32_t const& sequence) noexcept;
+        // Index of the position whose beats start the estimates, kNumPositions without any pair
+        std::size_t getReferencePosition() const noexcept;
+        // Estimates of the beat whose window completed on the last processed sample,
+        // return the number written to "estimates"
+        std::size_t takeEstimates(Estimates& estimates) noexcept;
+
+    private:
+        // Enabled positions in order, the pairs are neighbours in this list
+        std::array<std::size_t, kNumPositions> positions{};
+        std::size_t position_count = 0;
+
+        // Window and lags in samples
+        std::size_t pre_samples = 1;
+        std::size_t post_samples = 1;
+        std::size_t max_lag = 1;
+
+        std::array<std::array<std::float32_t, kHistoryLength>, kNumPositions> differences{};
+        std::array<std::uint64_t, kHistoryLength> timestamps{};
+        std::float32_t smoothing = 1.0f;
+        std::array<std::float32_t, kNumPositions> smoothed{};
+        // Samples since the reset, the history index is taken modulo kHistoryLength
+        std::uint32_t sample_count = 0;
+
+        // Beat waiting for its window to complete
+        bool          pending = false;
+        std::uint32_t beat_sample = 0;
+        std::uint32_t beat_sequence = 0;
+
+        // Estimates of the last complete window
+        Estimates   ready_estimates{};
+        std::size_t ready_count = 0;
+
+        void estimate() noexcept;
+        // Correlation of the window of "from" with "to" shifted by "lag" samples
+        std::float32_t correlate(std::size_t const& from, std::size_t const& to, std::ptrdiff_t const& lag) const noexcept;
+};
+
+} // namespace bps::analysis
+
+#endif // BPS_ANALYSIS_TRANSIT_DELAY_HPP
\ No newline at end of file
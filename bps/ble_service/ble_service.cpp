@@ -4,12 +4,17 @@
 #include <task.h>
 
 #include <array>
+#include <algorithm>
 #include <cstddef>
 #include <utility>
 #include <expected>
+#include <optional>
 
 #include "common.hpp"
 #include "queue.hpp"
+#include "utils.hpp"
+#include "recorder.hpp"
+#include "session_storage.hpp"
 #include "gatt_server/gatt_server.hpp"
 
 namespace bps::ble {
@@ -21,6 +26,12 @@ void BleService::initialize() noexcept {
     auto& gatt_server = gatt::GattServer::getInstance();
     gatt_server.initialize();
     gatt_server.on();
+
+    static auto record_chunk_callback = [](void* context, std::byte* buffer, std::size_t buffer_size) {
+        BleService* service = static_cast<BleService*>(context);
+        return service->fillRecordChunk(buffer, buffer_size);
+    };
+    gatt_server.registerRecordChunkCallback(record_chunk_callback, this);
 }
 
 bool BleService::createTask(UBaseType_t const& priority) noexcept {
@@ -47,32 +58,176 @@ QueueReference<PulseValue> BleService::getPulseValueQueueRef() const noexcept {
     return this->pulse_value_queue;
 }
 
+QueueReference<PulseValue> BleService::getPreviewQueueRef() const noexcept {
+    return this->preview_queue;
+}
+
+QueueReference<PulseSummary> BleService::getSummaryQueueRef() const noexcept {
+    return this->summary_queue;
+}
+
+QueueReference<AnalysisReport> BleService::getAnalysisReportQueueRef() const noexcept {
+    return this->analysis_report_queue;
+}
+
 void BleService::registerCommandQueue(QueueReference<Command> const& queue) noexcept {
     if (!queue.isValid()) return;
     this->output_command_queue_ref = queue;
     static auto command_callback = [](void* context, std::expected<Command, Error<std::byte>> command) {
-        auto send_queue = reinterpret_cast<QueueReference<Command>*>(context);
+        BleService* service = static_cast<BleService*>(context);
         if (command) {
+            switch (command.value().command_type) {
+            case CommandType::eDownloadRecord:
+                // Downloads are served by the BLE service itself, the sampler is not involved
+                service->startRecordDownload(command.value().content.record_range);
+                return;
+            case CommandType::eListSessions:
+                service->startSessionList();
+                return;
+            case CommandType::eReset:
+                service->record_download.active = false;
+                break;
+            default:
+                break;
+            }
             // This lambda will be called by the GattServer, so there shouldn't be any delay.
-            send_queue->sendFromIsr(command.value(), nullptr);
+            service->output_command_queue_ref.sendFromIsr(command.value(), nullptr);
         } else {
             /* Error Handling */
         }
     };
     gatt::GattServer::getInstance().registerCommandCallback(
         command_callback,
-        &this->output_command_queue_ref
+        this
     );
 }
 
+void BleService::registerEmergencyStopCallback(gatt::GattServer::emergencyStopCallback_t callback, void* context) noexcept {
+    gatt::GattServer::getInstance().registerEmergencyStopCallback(callback, context);
+}
+
+void BleService::startRecordDownload(Command::Content::RecordRange const& range) noexcept {
+    std::optional<recorder::SampleRecorder::Range> recorded_range{};
+    if (range.session_id == 0) {
+        recorded_range = recorder::SampleRecorder::getInstance().getRange();
+    } else {
+        std::array<storage::SessionStorage::SessionInfo, storage::SessionStorage::kMaxSessions> sessions{};
+        std::size_t const count = storage::SessionStorage::getInstance().getSessions(sessions);
+        auto const session = std::find_if(
+            sessions.begin(),
+            sessions.begin() + count,
+            [&range](auto const& info) { return info.id == range.session_id; }
+        );
+        if (session != sessions.begin() + count) {
+            recorded_range = recorder::SampleRecorder::Range{ session->first_sequence, session->last_sequence };
+        }
+    }
+
+    this->record_download = RecordDownload{
+        .active        = true,
+        .block_loaded  = false,
+        .listing       = false,
+        .session_id    = range.session_id,
+        .next_sequence = range.first_sequence,
+        // Samples recorded after the request are not part of this transfer
+        .last_sequence = recorded_range ? std::min(range.last_sequence, recorded_range.value().last) : 0,
+    };
+    if (!recorded_range) {
+        // Nothing recorded yet, only the end marker will be sent
+        this->record_download.next_sequence = 1;
+    }
+    gatt::GattServer::getInstance().requestRecordData();
+}
+
+void BleService::startSessionList() noexcept {
+    std::array<storage::SessionStorage::SessionInfo, storage::SessionStorage::kMaxSessions> sessions{};
+    std::size_t const count = storage::SessionStorage::getInstance().getSessions(sessions);
+    static_assert(sessions.size() * kSessionListEntrySize <= std::tuple_size_v<recorder::SampleRecorder::Block>);
+
+    this->record_download = RecordDownload{
+        .active        = true,
+        // An empty list is only the end marker
+        .block_loaded  = count > 0,
+        .listing       = true,
+        .block_ordinal = kSessionListOrdinal,
+        .block_offset  = 0,
+        .block_size    = count * kSessionListEntrySize,
+    };
+    for (std::size_t i = 0; i < count; ++i) {
+        std::byte* entry = &this->record_download.block[i * kSessionListEntrySize];
+        writeAsLittleEndian(sessions[i].id, &entry[0]);
+        writeAsLittleEndian(sessions[i].first_sequence, &entry[2]);
+        writeAsLittleEndian(sessions[i].last_sequence, &entry[6]);
+    }
+    gatt::GattServer::getInstance().requestRecordData();
+}
+
+std::optional<std::uint32_t> BleService::loadRecordBlock() noexcept {
+    RecordDownload& download = this->record_download;
+    if (download.listing || download.next_sequence > download.last_sequence) {
+        return std::nullopt;
+    }
+    if (download.session_id == 0) {
+        return recorder::SampleRecorder::getInstance().readBlock(download.next_sequence, download.block);
+    }
+    return storage::SessionStorage::getInstance().readBlock(download.session_id, download.next_sequence, download.block);
+}
+
+std::size_t BleService::fillRecordChunk(std::byte* buffer, std::size_t buffer_size) noexcept {
+    using recorder::SampleRecorder;
+    RecordDownload& download = this->record_download;
+    if (!download.active || buffer_size <= kRecordChunkHeaderSize) {
+        return 0;
+    }
+
+    if (!download.block_loaded) {
+        std::optional<std::uint32_t> const ordinal = loadRecordBlock();
+        if (!ordinal || SampleRecorder::getFirstSequence(download.block) > download.last_sequence) {
+            // Range exhausted, send the end marker
+            download.active = false;
+            writeAsLittleEndian(std::uint16_t{0}, &buffer[0]);
+            writeAsLittleEndian(kRecordEndOffset, &buffer[2]);
+            return kRecordChunkHeaderSize;
+        }
+        download.block_ordinal = ordinal.value();
+        download.block_offset  = 0;
+        download.block_size    = SampleRecorder::getUsedBytes(download.block);
+        download.block_loaded  = true;
+    }
+
+    std::size_t const size = std::min(buffer_size - kRecordChunkHeaderSize, download.block_size - download.block_offset);
+    writeAsLittleEndian(static_cast<std::uint16_t>(download.block_ordinal), &buffer[0]);
+    writeAsLittleEndian(static_cast<std::uint16_t>(download.block_offset), &buffer[2]);
+    std::copy_n(download.block.begin() + download.block_offset, size, buffer + kRecordChunkHeaderSize);
+
+    download.block_offset += size;
+    if (download.block_offset >= download.block_size) {
+        download.block_loaded = false;
+        if (!download.listing) {
+            download.next_sequence = SampleRecorder::getFirstSequence(download.block) +
+                                     SampleRecorder::getSampleCount(download.block);
+        }
+    }
+    return kRecordChunkHeaderSize + size;
+}
+
 void BleService::taskLoop() noexcept {
+    auto& gatt_server = gatt::GattServer::getInstance();
     while (true) {
+        // Wake up in time to flush a partial pulse value batch
+        TickType_t wait_tick = portMAX_DELAY;
+        if (gatt_server.getUnflushedPulseValueCount() > 0) {
+            TickType_t const deadline = pdMS_TO_TICKS(gatt_server.getAcquisitionConfig().flush_deadline_ms);
+            TickType_t const elapsed  = xTaskGetTickCount() - this->batch_start_tick;
+            wait_tick = (elapsed < deadline) ? (deadline - elapsed) : 0;
+        }
+
         static std::expected<QueueHandle_t, std::nullptr_t> selected_handle{};
-        if ((selected_handle = this->queue_set.selectFromSet(portMAX_DELAY))) {
+        if ((selected_handle = this->queue_set.selectFromSet(wait_tick))) {
             if (selected_handle == this->machine_status_queue.getFreeRTOSQueueHandle()) {
                 static MachineStatus status{};
                 if (this->machine_status_queue.receive(status, pdMS_TO_TICKS(1000))) {
-                    gatt::GattServer::getInstance().sendMachineStatus(status);
+                    gatt_server.sendMachineStatus(status);
                 } else {
                     /* Error Handling */
                 }
@@ -80,15 +235,44 @@ void BleService::taskLoop() noexcept {
             } else if (selected_handle == this->pulse_value_queue.getFreeRTOSQueueHandle()) {
                 static PulseValue value{};
                 if (this->pulse_value_queue.receive(value, pdMS_TO_TICKS(5))) {
-                    gatt::GattServer::getInstance().sendPulseValue(value);
+                    gatt_server.sendPulseValue(value);
+                    // The value opened a new batch
+                    if (gatt_server.getUnflushedPulseValueCount() == 1) {
+                        this->batch_start_tick = xTaskGetTickCount();
+                    }
+                } else {
+                    /* Error Handling */
+                }
+
+            } else if (selected_handle == this->analysis_report_queue.getFreeRTOSQueueHandle()) {
+                static AnalysisReport report{};
+                if (this->analysis_report_queue.receive(report, pdMS_TO_TICKS(5))) {
+                    gatt_server.sendAnalysisReport(report);
+                } else {
+                    /* Error Handling */
+                }
+
+            } else if (selected_handle == this->preview_queue.getFreeRTOSQueueHandle()) {
+                static PulseValue value{};
+                if (this->preview_queue.receive(value, pdMS_TO_TICKS(5))) {
+                    gatt_server.sendPreviewValue(value);
+                } else {
+                    /* Error Handling */
+                }
+
+            } else if (selected_handle == this->summary_queue.getFreeRTOSQueueHandle()) {
+                static PulseSummary summary{};
+                if (this->summary_queue.receive(summary, pdMS_TO_TICKS(5))) {
+                    gatt_server.sendSummary(summary);
                 } else {
                     /* Error Handling */
                 }
 
             }
 
-        } else {
-            /* TODO: Error Handling */
+        } else if (gatt_server.getUnflushedPulseValueCount() > 0) {
+            // Flush deadline reached
+            gatt_server.flushPulseValues();
         }
     }
     
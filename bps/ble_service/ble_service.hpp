@@ -4,9 +4,12 @@
 #include <btstack_run_loop.h>
 
 #include <cstdint>
+#include <cstddef>
+#include <optional>
 
 #include "common.hpp"
 #include "queue.hpp"
+#include "recorder.hpp"
 #include "gatt_server/gatt_server.hpp"
 
 namespace bps::ble {
@@ -35,25 +38,75 @@ class BleService {
         // Get the input queue (like setters reference)
         QueueReference<MachineStatus> getMachineStatusQueueRef() const noexcept;
         QueueReference<PulseValue> getPulseValueQueueRef() const noexcept;
+        QueueReference<PulseValue> getPreviewQueueRef() const noexcept;
+        QueueReference<PulseSummary> getSummaryQueueRef() const noexcept;
+        QueueReference<AnalysisReport> getAnalysisReportQueueRef() const noexcept;
 
         // Register command and pressure base value queue
         void registerCommandQueue(QueueReference<Command> const& queue) noexcept;
 
+        // Register the emergency stop, called from the BTstack context without any queue
+        void registerEmergencyStopCallback(gatt::GattServer::emergencyStopCallback_t callback, void* context) noexcept;
+
     private:
         BleService();
 
+        // Record data chunk header: u16 block ordinal, u16 byte offset inside the block
+        static constexpr std::size_t   kRecordChunkHeaderSize = 4;
+        // Byte offset value which marks the end of a record transfer
+        static constexpr std::uint16_t kRecordEndOffset = 0xFFFF;
+        // Block ordinal of the chunks which carry the session list
+        static constexpr std::uint16_t kSessionListOrdinal = 0xFFFF;
+        // Session list entry: u16 session id, u32 first sequence, u32 last sequence
+        static constexpr std::size_t   kSessionListEntrySize = 10;
+
         QueueReference<Command> output_command_queue_ref{};
         StaticQueue<MachineStatus, 3> machine_status_queue{};
         StaticQueue<PulseValue, 1024> pulse_value_queue{};
+        StaticQueue<AnalysisReport, 16> analysis_report_queue{};
+        // Only the freshest points matter, the sampler drops them when it is full
+        StaticQueue<PulseValue, 4> preview_queue{};
+        // At most a few per second
+        StaticQueue<PulseSummary, 4> summary_queue{};
 
         StaticQueueSet<
             decltype(machine_status_queue),
-            decltype(pulse_value_queue)
+            decltype(pulse_value_queue),
+            decltype(analysis_report_queue),
+            decltype(preview_queue),
+            decltype(summary_queue)
         > queue_set{
             machine_status_queue,
-            pulse_value_queue
+            pulse_value_queue,
+            analysis_report_queue,
+            preview_queue,
+            summary_queue
         };
 
+        // Record download state, only touched from the BTstack context
+        struct RecordDownload {
+            bool          active = false;
+            bool          block_loaded = false;
+            // The transfer carries the session list instead of record blocks
+            bool          listing = false;
+            // 0 for the RAM ring, a flash session id otherwise
+            std::uint16_t session_id = 0;
+            std::uint32_t next_sequence = 0;
+            std::uint32_t last_sequence = 0;
+            std::uint32_t block_ordinal = 0;
+            std::size_t   block_offset = 0;
+            std::size_t   block_size = 0;
+            recorder::SampleRecorder::Block block{};
+        } record_download{};
+
+        void startRecordDownload(Command::Content::RecordRange const& range) noexcept;
+        void startSessionList() noexcept;
+        std::optional<std::uint32_t> loadRecordBlock() noexcept;
+        std::size_t fillRecordChunk(std::byte* buffer, std::size_t buffer_size) noexcept;
+
+        // Tick at which the current pulse value batch got its first value
+        TickType_t batch_start_tick = 0;
+
         // FreeRTOS task
         TaskHandle_t task_handle{nullptr};
         void taskLoop() noexcept;
@@ -43,6 +43,40 @@ struct Att {
                 static constexpr std::uint16_t kClientConfiguration = ATT_CHARACTERISTIC_652C47C3_C653_41BC_8828_30200EF3350A_01_CLIENT_CONFIGURATION_HANDLE;
                 static constexpr std::uint16_t kUserDescription     = ATT_CHARACTERISTIC_652C47C3_C653_41BC_8828_30200EF3350A_01_USER_DESCRIPTION_HANDLE;
             };
+
+            struct RecordData {
+                static constexpr std::uint16_t kValue               = ATT_CHARACTERISTIC_652C47C4_C653_41BC_8828_30200EF3350A_01_VALUE_HANDLE;
+                static constexpr std::uint16_t kClientConfiguration = ATT_CHARACTERISTIC_652C47C4_C653_41BC_8828_30200EF3350A_01_CLIENT_CONFIGURATION_HANDLE;
+                static constexpr std::uint16_t kUserDescription     = ATT_CHARACTERISTIC_652C47C4_C653_41BC_8828_30200EF3350A_01_USER_DESCRIPTION_HANDLE;
+            };
+
+            struct Diagnostics {
+                static constexpr std::uint16_t kValue           = ATT_CHARACTERISTIC_652C47C5_C653_41BC_8828_30200EF3350A_01_VALUE_HANDLE;
+                static constexpr std::uint16_t kUserDescription = ATT_CHARACTERISTIC_652C47C5_C653_41BC_8828_30200EF3350A_01_USER_DESCRIPTION_HANDLE;
+            };
+
+            struct Configuration {
+                static constexpr std::uint16_t kValue           = ATT_CHARACTERISTIC_652C47C6_C653_41BC_8828_30200EF3350A_01_VALUE_HANDLE;
+                static constexpr std::uint16_t kUserDescription = ATT_CHARACTERISTIC_652C47C6_C653_41BC_8828_30200EF3350A_01_USER_DESCRIPTION_HANDLE;
+            };
+
+            struct Analysis {
+                static constexpr std::uint16_t kValue               = ATT_CHARACTERISTIC_652C47C7_C653_41BC_8828_30200EF3350A_01_VALUE_HANDLE;
+                static constexpr std::uint16_t kClientConfiguration = ATT_CHARACTERISTIC_652C47C7_C653_41BC_8828_30200EF3350A_01_CLIENT_CONFIGURATION_HANDLE;
+                static constexpr std::uint16_t kUserDescription     = ATT_CHARACTERISTIC_652C47C7_C653_41BC_8828_30200EF3350A_01_USER_DESCRIPTION_HANDLE;
+            };
+
+            struct Preview {
+                static constexpr std::uint16_t kValue               = ATT_CHARACTERISTIC_652C47C8_C653_41BC_8828_30200EF3350A_01_VALUE_HANDLE;
+                static constexpr std::uint16_t kClientConfiguration = ATT_CHARACTERISTIC_652C47C8_C653_41BC_8828_30200EF3350A_01_CLIENT_CONFIGURATION_HANDLE;
+                static constexpr std::uint16_t kUserDescription     = ATT_CHARACTERISTIC_652C47C8_C653_41BC_8828_30200EF3350A_01_USER_DESCRIPTION_HANDLE;
+            };
+
+            struct Summary {
+                static constexpr std::uint16_t kValue               = ATT_CHARACTERISTIC_652C47C9_C653_41BC_8828_30200EF3350A_01_VALUE_HANDLE;
+                static constexpr std::uint16_t kClientConfiguration = ATT_CHARACTERISTIC_652C47C9_C653_41BC_8828_30200EF3350A_01_CLIENT_CONFIGURATION_HANDLE;
+                static constexpr std::uint16_t kUserDescription     = ATT_CHARACTERISTIC_652C47C9_C653_41BC_8828_30200EF3350A_01_USER_DESCRIPTION_HANDLE;
+            };
         };
     };
 
@@ -65,7 +99,7 @@ struct Att {
             0x0d, 0x00, 0x02, 0x00, 0x05, 0x00, 0x03, 0x28, 0x02, 0x06, 0x00, 0x2a, 0x2b, 
             // 0x0006 VALUE CHARACTERISTIC-GATT_DATABASE_HASH - READ -''
             // READ_ANYBODY
-            0x18, 0x00, 0x02, 0x00, 0x06, 0x00, 0x2a, 0x2b, 0xef, 0x29, 0x8b, 0x5d, 0x77, 0x1c, 0x19, 0x28, 0x7c, 0xd8, 0xf0, 0xf5, 0x8a, 0xaf, 0x04, 0xe1, 
+            0x18, 0x00, 0x02, 0x00, 0x06, 0x00, 0x2a, 0x2b, 0x19, 0x72, 0x41, 0x65, 0x1c, 0x4d, 0xd6, 0x0b, 0xf5, 0x50, 0x92, 0xe8, 0xa7, 0xe8, 0x5c, 0x7e, 
             // First custom service: Pulse Sampler
             // 0x0007 PRIMARY_SERVICE-652C47C0-C653-41BC-8828-30200EF3350A
             0x18, 0x00, 0x02, 0x00, 0x07, 0x00, 0x00, 0x28, 0x0a, 0x35, 0xf3, 0x0e, 0x20, 0x30, 0x28, 0x88, 0xbc, 0x41, 0x53, 0xc6, 0xc0, 0x47, 0x2c, 0x65, 
@@ -106,6 +140,78 @@ struct Att {
             // 0x0012 USER_DESCRIPTION-READ
             // READ_ANYBODY, WRITE_ANYBODY
             0x08, 0x00, 0x0a, 0x01, 0x12, 0x00, 0x01, 0x29, 
+            // Characteristic E: Record Data Packet
+            // read only, dynamic, with notifications
+            // 0x0013 CHARACTERISTIC-652C47C4-C653-41BC-8828-30200EF3350A - DYNAMIC | READ | NOTIFY
+            0x1b, 0x00, 0x02, 0x00, 0x13, 0x00, 0x03, 0x28, 0x12, 0x14, 0x00, 0x0a, 0x35, 0xf3, 0x0e, 0x20, 0x30, 0x28, 0x88, 0xbc, 0x41, 0x53, 0xc6, 0xc4, 0x47, 0x2c, 0x65, 
+            // 0x0014 VALUE CHARACTERISTIC-652C47C4-C653-41BC-8828-30200EF3350A - DYNAMIC | READ | NOTIFY
+            // READ_ANYBODY
+            0x16, 0x00, 0x02, 0x03, 0x14, 0x00, 0x0a, 0x35, 0xf3, 0x0e, 0x20, 0x30, 0x28, 0x88, 0xbc, 0x41, 0x53, 0xc6, 0xc4, 0x47, 0x2c, 0x65, 
+            // 0x0015 CLIENT_CHARACTERISTIC_CONFIGURATION
+            // READ_ANYBODY, WRITE_ANYBODY
+            0x0a, 0x00, 0x0e, 0x01, 0x15, 0x00, 0x02, 0x29, 0x00, 0x00, 
+            // 0x0016 USER_DESCRIPTION-READ
+            // READ_ANYBODY, WRITE_ANYBODY
+            0x08, 0x00, 0x0a, 0x01, 0x16, 0x00, 0x01, 0x29, 
+            // Characteristic F: Diagnostics Packet
+            // read only, dynamic
+            // 0x0017 CHARACTERISTIC-652C47C5-C653-41BC-8828-30200EF3350A - DYNAMIC | READ
+            0x1b, 0x00, 0x02, 0x00, 0x17, 0x00, 0x03, 0x28, 0x02, 0x18, 0x00, 0x0a, 0x35, 0xf3, 0x0e, 0x20, 0x30, 0x28, 0x88, 0xbc, 0x41, 0x53, 0xc6, 0xc5, 0x47, 0x2c, 0x65, 
+            // 0x0018 VALUE CHARACTERISTIC-652C47C5-C653-41BC-8828-30200EF3350A - DYNAMIC | READ
+            // READ_ANYBODY
+            0x16, 0x00, 0x02, 0x03, 0x18, 0x00, 0x0a, 0x35, 0xf3, 0x0e, 0x20, 0x30, 0x28, 0x88, 0xbc, 0x41, 0x53, 0xc6, 0xc5, 0x47, 0x2c, 0x65, 
+            // 0x0019 USER_DESCRIPTION-READ
+            // READ_ANYBODY, WRITE_ANYBODY
+            0x08, 0x00, 0x0a, 0x01, 0x19, 0x00, 0x01, 0x29, 
+            // Characteristic G: Configuration Packet
+            // read and write, dynamic
+            // 0x001a CHARACTERISTIC-652C47C6-C653-41BC-8828-30200EF3350A - DYNAMIC | READ | WRITE
+            0x1b, 0x00, 0x02, 0x00, 0x1a, 0x00, 0x03, 0x28, 0x0a, 0x1b, 0x00, 0x0a, 0x35, 0xf3, 0x0e, 0x20, 0x30, 0x28, 0x88, 0xbc, 0x41, 0x53, 0xc6, 0xc6, 0x47, 0x2c, 0x65, 
+            // 0x001b VALUE CHARACTERISTIC-652C47C6-C653-41BC-8828-30200EF3350A - DYNAMIC | READ | WRITE
+            // READ_ANYBODY, WRITE_ANYBODY
+            0x16, 0x00, 0x0a, 0x03, 0x1b, 0x00, 0x0a, 0x35, 0xf3, 0x0e, 0x20, 0x30, 0x28, 0x88, 0xbc, 0x41, 0x53, 0xc6, 0xc6, 0x47, 0x2c, 0x65, 
+            // 0x001c USER_DESCRIPTION-READ
+            // READ_ANYBODY, WRITE_ANYBODY
+            0x08, 0x00, 0x0a, 0x01, 0x1c, 0x00, 0x01, 0x29, 
+            // Characteristic H: Analysis Packet
+            // dynamic, with notifications
+            // 0x001d CHARACTERISTIC-652C47C7-C653-41BC-8828-30200EF3350A - DYNAMIC | NOTIFY
+            0x1b, 0x00, 0x02, 0x00, 0x1d, 0x00, 0x03, 0x28, 0x10, 0x1e, 0x00, 0x0a, 0x35, 0xf3, 0x0e, 0x20, 0x30, 0x28, 0x88, 0xbc, 0x41, 0x53, 0xc6, 0xc7, 0x47, 0x2c, 0x65, 
+            // 0x001e VALUE CHARACTERISTIC-652C47C7-C653-41BC-8828-30200EF3350A - DYNAMIC | NOTIFY
+            // 
+            0x16, 0x00, 0x00, 0x03, 0x1e, 0x00, 0x0a, 0x35, 0xf3, 0x0e, 0x20, 0x30, 0x28, 0x88, 0xbc, 0x41, 0x53, 0xc6, 0xc7, 0x47, 0x2c, 0x65, 
+            // 0x001f CLIENT_CHARACTERISTIC_CONFIGURATION
+            // READ_ANYBODY, WRITE_ANYBODY
+            0x0a, 0x00, 0x0e, 0x01, 0x1f, 0x00, 0x02, 0x29, 0x00, 0x00, 
+            // 0x0020 USER_DESCRIPTION-READ
+            // READ_ANYBODY, WRITE_ANYBODY
+            0x08, 0x00, 0x0a, 0x01, 0x20, 0x00, 0x01, 0x29, 
+            // Characteristic I: Preview Packet
+            // read only, dynamic, with notifications
+            // 0x0021 CHARACTERISTIC-652C47C8-C653-41BC-8828-30200EF3350A - DYNAMIC | READ | NOTIFY
+            0x1b, 0x00, 0x02, 0x00, 0x21, 0x00, 0x03, 0x28, 0x12, 0x22, 0x00, 0x0a, 0x35, 0xf3, 0x0e, 0x20, 0x30, 0x28, 0x88, 0xbc, 0x41, 0x53, 0xc6, 0xc8, 0x47, 0x2c, 0x65, 
+            // 0x0022 VALUE CHARACTERISTIC-652C47C8-C653-41BC-8828-30200EF3350A - DYNAMIC | READ | NOTIFY
+            // READ_ANYBODY
+            0x16, 0x00, 0x02, 0x03, 0x22, 0x00, 0x0a, 0x35, 0xf3, 0x0e, 0x20, 0x30, 0x28, 0x88, 0xbc, 0x41, 0x53, 0xc6, 0xc8, 0x47, 0x2c, 0x65, 
+            // 0x0023 CLIENT_CHARACTERISTIC_CONFIGURATION
+            // READ_ANYBODY, WRITE_ANYBODY
+            0x0a, 0x00, 0x0e, 0x01, 0x23, 0x00, 0x02, 0x29, 0x00, 0x00, 
+            // 0x0024 USER_DESCRIPTION-READ
+            // READ_ANYBODY, WRITE_ANYBODY
+            0x08, 0x00, 0x0a, 0x01, 0x24, 0x00, 0x01, 0x29, 
+            // Characteristic J: Summary Packet
+            // read only, dynamic, with notifications
+            // 0x0025 CHARACTERISTIC-652C47C9-C653-41BC-8828-30200EF3350A - DYNAMIC | READ | NOTIFY
+            0x1b, 0x00, 0x02, 0x00, 0x25, 0x00, 0x03, 0x28, 0x12, 0x26, 0x00, 0x0a, 0x35, 0xf3, 0x0e, 0x20, 0x30, 0x28, 0x88, 0xbc, 0x41, 0x53, 0xc6, 0xc9, 0x47, 0x2c, 0x65, 
+            // 0x0026 VALUE CHARACTERISTIC-652C47C9-C653-41BC-8828-30200EF3350A - DYNAMIC | READ | NOTIFY
+            // READ_ANYBODY
+            0x16, 0x00, 0x02, 0x03, 0x26, 0x00, 0x0a, 0x35, 0xf3, 0x0e, 0x20, 0x30, 0x28, 0x88, 0xbc, 0x41, 0x53, 0xc6, 0xc9, 0x47, 0x2c, 0x65, 
+            // 0x0027 CLIENT_CHARACTERISTIC_CONFIGURATION
+            // READ_ANYBODY, WRITE_ANYBODY
+            0x0a, 0x00, 0x0e, 0x01, 0x27, 0x00, 0x02, 0x29, 0x00, 0x00, 
+            // 0x0028 USER_DESCRIPTION-READ
+            // READ_ANYBODY, WRITE_ANYBODY
+            0x08, 0x00, 0x0a, 0x01, 0x28, 0x00, 0x01, 0x29, 
             // END
             0x00, 0x00
         );
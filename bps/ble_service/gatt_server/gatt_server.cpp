@@ -3,17 +3,24 @@
 #include <btstack.h>
 #include <pico/cyw43_arch.h>
 #include <pico/btstack_cyw43.h>
+#include <pico/time.h>
 
 #include <cstdint>
 #include <cstring>
+#include <cmath>
 #include <algorithm>
 #include <array>
+#include <span>
 #include <cstddef>
 #include <expected>
 #include <string_view>
+#include <bit>
 
 #include "common.hpp"
 #include "utils.hpp"
+#include "filter_bank.hpp"
+#include "pulse_analyzer.hpp"
+#include "summary_statistics.hpp"
 #include "gatt_database.hpp"
 #include "logger.hpp"
 
@@ -32,16 +39,53 @@ auto gap_adv_data = makeBytes(
 );
 static_assert(gap_adv_data.size() <= 31);
 
+// Holds the lock of the async context BTstack runs on for its scope. The packet handler,
+// and every ATT_EVENT_CAN_SEND_NOW notification with it, runs under this lock, so the
+// characteristics it notifies from never change under it. The lock is recursive, the
+// BTstack context itself may take it again.
+class ContextLock {
+    public:
+        ContextLock() noexcept {
+            async_context_acquire_lock_blocking(cyw43_arch_async_context());
+        }
+        ~ContextLock() noexcept {
+            async_context_release_lock(cyw43_arch_async_context());
+        }
+        ContextLock(ContextLock const&) = delete;
+        ContextLock& operator=(ContextLock const&) = delete;
+};
+
 constexpr uint16_t adv_int_min = 800;
 constexpr uint16_t adv_int_max = 800;
 constexpr std::uint8_t adv_type = 0;
 
+// Write the low 24 bits of "value" in little-endian order
+void writeAsLittleEndian24(std::uint32_t const& value, std::byte* dest) noexcept {
+    dest[0] = static_cast<std::byte>(value & 0xFFu);
+    dest[1] = static_cast<std::byte>((value >> 8) & 0xFFu);
+    dest[2] = static_cast<std::byte>((value >> 16) & 0xFFu);
+}
+
+// Pressure in "scale" units, saturated to the signed 24-bits range
+std::uint32_t packPressure(std::float32_t const& pressure, std::float32_t const& scale) noexcept {
+    constexpr std::int32_t kMin = -(1 << 23);
+    constexpr std::int32_t kMax = (1 << 23) - 1;
+    float const scaled = std::clamp(
+        static_cast<float>(pressure * scale),
+        static_cast<float>(kMin),
+        static_cast<float>(kMax)
+    );
+    return static_cast<std::uint32_t>(static_cast<std::int32_t>(std::lround(scaled)));
+}
+
 } // anonymous namespace
 
 // ================================================================================================
 // == GattServer::CustomCaracteristics                                                           ==
 // ================================================================================================
-GattServer::CustomCharacteristics::CustomCharacteristics() {}
+GattServer::CustomCharacteristics::CustomCharacteristics() {
+    setAcquisitionConfig(kDefaultAcquisitionConfig);
+}
 
 GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::setMachineStatus(
     MachineStatus const& status
@@ -57,22 +101,34 @@ GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::setMachine
     return *this;
 }
 
-GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::setPulseValue(
-    PulseValue const& value
+void GattServer::CustomCharacteristics::serializePulseValue(
+    PulseValue const& value,
+    std::byte* destination
 ) noexcept {
     std::size_t offset = 0;
 
-    writeAsLittleEndian(value.timestamp, &this->pulse_value[offset]);
+    writeAsLittleEndian(value.timestamp, &destination[offset]);
     offset += sizeof(value.timestamp);
 
-    writeAsLittleEndian(value.cun, &this->pulse_value[offset]);
+    writeAsLittleEndian(value.cun, &destination[offset]);
     offset += sizeof(value.cun);
 
-    writeAsLittleEndian(value.guan, &this->pulse_value[offset]);
+    writeAsLittleEndian(value.guan, &destination[offset]);
     offset += sizeof(value.guan);
 
-    writeAsLittleEndian(value.chi, &this->pulse_value[offset]);
+    writeAsLittleEndian(value.chi, &destination[offset]);
+    offset += sizeof(value.chi);
+
+    destination[offset] = static_cast<std::byte>(std::to_underlying(value.segment));
+    offset += sizeof(value.segment);
 
+    writeAsLittleEndian(value.sequence, &destination[offset]);
+}
+
+GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::setPulseValue(
+    PulseValue const& value
+) noexcept {
+    serializePulseValue(value, this->pulse_value.data());
     return *this;
 }
 
@@ -92,6 +148,296 @@ GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::setPulseVa
     );
 }
 
+GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::appendPulseValue(
+    PulseValue const& value
+) noexcept {
+    setPulseValue(value);
+    if (this->pulse_batch_queued == kPulseBatchSlots) {
+        // No open batch left
+        return *this;
+    }
+    PulseBatch& batch = this->pulse_batches[(this->pulse_batch_head + this->pulse_batch_queued) % kPulseBatchSlots];
+    if (batch.count == 0) {
+        AcquisitionConfig const config = getAcquisitionConfig();
+        batch.packed         = config.packed_batches;
+        batch.channel_mask   = config.channel_mask;
+        batch.segment        = value.segment;
+        batch.last_timestamp = value.timestamp;
+        batch.size           = 0;
+        if (batch.packed) {
+            writeAsLittleEndian(value.sequence, &batch.data[0]);
+            writeAsLittleEndian(value.timestamp, &batch.data[4]);
+            batch.data[12] = static_cast<std::byte>(std::to_underlying(value.segment));
+            batch.data[13] = std::byte{batch.channel_mask};
+            batch.size = kPackedHeaderSize;
+        }
+    }
+
+    if (!batch.packed) {
+        if (batch.size + kPulseValueSize > batch.data.size()) {
+            return *this;
+        }
+        std::copy(this->pulse_value.begin(), this->pulse_value.end(), batch.data.begin() + batch.size);
+        batch.size += kPulseValueSize;
+    } else {
+        std::size_t const sample_size = kPackedFieldSize * (1 + std::popcount(batch.channel_mask));
+        if (batch.size + sample_size > batch.data.size()) {
+            return *this;
+        }
+        std::byte* sample = &batch.data[batch.size];
+        writeAsLittleEndian24(static_cast<std::uint32_t>(value.timestamp - batch.last_timestamp), sample);
+        sample += kPackedFieldSize;
+        std::array<std::float32_t, 3> const pressures{ value.cun, value.guan, value.chi };
+        for (std::size_t i = 0; i < pressures.size(); ++i) {
+            if (batch.channel_mask & (1u << i)) {
+                writeAsLittleEndian24(packPressure(pressures[i], kPackedPressureScale), sample);
+                sample += kPackedFieldSize;
+            }
+        }
+        batch.size += sample_size;
+    }
+    batch.last_sequence  = value.sequence;
+    batch.last_timestamp = value.timestamp;
+    ++batch.count;
+    return *this;
+}
+
+GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::closePulseBatch() noexcept {
+    if (this->pulse_batch_queued < kPulseBatchSlots &&
+        this->pulse_batches[(this->pulse_batch_head + this->pulse_batch_queued) % kPulseBatchSlots].count > 0) {
+        ++this->pulse_batch_queued;
+    }
+    return *this;
+}
+
+GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::popPulseBatch() noexcept {
+    if (this->pulse_batch_queued > 0) {
+        PulseBatch& batch = this->pulse_batches[this->pulse_batch_head];
+        batch.count = 0;
+        batch.size  = 0;
+        this->pulse_batch_head = (this->pulse_batch_head + 1) % kPulseBatchSlots;
+        --this->pulse_batch_queued;
+    }
+    return *this;
+}
+
+GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::setPreviewValue(
+    PulseValue const& value
+) noexcept {
+    serializePulseValue(value, this->preview_value.data());
+    return *this;
+}
+
+GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::setPreviewClientConfiguration(
+    std::uint16_t const& configuration
+) noexcept {
+    this->preview_client_configuration = configuration;
+    return *this;
+}
+
+GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::setSummary(
+    PulseSummary const& summary
+) noexcept {
+    writeAsLittleEndian(summary.timestamp, &this->summary_value[0]);
+    writeAsLittleEndian(summary.first_sequence, &this->summary_value[8]);
+    writeAsLittleEndian(summary.sample_count, &this->summary_value[12]);
+    this->summary_value[14] = std::byte{std::to_underlying(summary.segment)};
+    this->summary_value[15] = std::byte{summary.channel_mask};
+    std::size_t offset = kSummaryHeaderSize;
+    for (std::size_t i = 0; i < summary.channels.size(); ++i) {
+        if ((summary.channel_mask & (1u << i)) == 0) {
+            continue;
+        }
+        auto const& channel = summary.channels[i];
+        writeAsLittleEndian(channel.min, &this->summary_value[offset]);
+        writeAsLittleEndian(channel.max, &this->summary_value[offset + 4]);
+        writeAsLittleEndian(channel.mean, &this->summary_value[offset + 8]);
+        writeAsLittleEndian(channel.variance, &this->summary_value[offset + 12]);
+        offset += kSummaryChannelSize;
+    }
+    this->summary_size = offset;
+    return *this;
+}
+
+GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::setSummaryClientConfiguration(
+    std::uint16_t const& configuration
+) noexcept {
+    this->summary_client_configuration = configuration;
+    return *this;
+}
+
+GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::setAcquisitionConfig(
+    AcquisitionConfig const& config
+) noexcept {
+    writeAsLittleEndian(config.conversion_wait_ms, &this->acquisition_configuration[0]);
+    this->acquisition_configuration[2] = std::byte{config.channel_mask};
+    this->acquisition_configuration[3] = std::byte{config.batch_size};
+    writeAsLittleEndian(config.flush_deadline_ms, &this->acquisition_configuration[4]);
+    for (std::size_t i = 0; i < config.filter_sections.size(); ++i) {
+        this->acquisition_configuration[6 + i] = std::byte{config.filter_sections[i]};
+    }
+    this->acquisition_configuration[9]  = std::byte{config.mains_hz};
+    this->acquisition_configuration[10] = std::byte{config.template_beats};
+    this->acquisition_configuration[11] = std::byte{config.quality_threshold};
+    this->acquisition_configuration[12] = std::byte{config.spectral_harmonics};
+    this->acquisition_configuration[13] = std::byte{config.preview_decimation};
+    this->acquisition_configuration[14] = std::byte{static_cast<std::uint8_t>(config.packed_batches)};
+    this->acquisition_configuration[15] = std::byte{static_cast<std::uint8_t>(config.classify_beats)};
+    writeAsLittleEndian(config.summary_window_ms, &this->acquisition_configuration[16]);
+    return *this;
+}
+
+GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::appendAnalysisReport(
+    AnalysisReport const& report
+) noexcept {
+    std::size_t const size = getAnalysisRecordSize(report);
+    if (size == 0 || this->analysis_batch_size + size > this->analysis_batch.size()) {
+        return *this;
+    }
+
+    std::byte* record = &this->analysis_batch[this->analysis_batch_size];
+    record[0] = static_cast<std::byte>(std::to_underlying(report.type));
+    record[1] = static_cast<std::byte>(size - kAnalysisHeaderSize);
+    record[2] = static_cast<std::byte>(std::to_underlying(report.position));
+    std::size_t offset = kAnalysisHeaderSize;
+
+    switch (report.type) {
+    case AnalysisReport::Type::eBeat: {
+        auto const& beat = report.content.beat;
+        writeAsLittleEndian(beat.timestamp, &record[offset]);
+        offset += sizeof(beat.timestamp);
+        writeAsLittleEndian(beat.sequence, &record[offset]);
+        offset += sizeof(beat.sequence);
+        writeAsLittleEndian(beat.interval_ms, &record[offset]);
+        offset += sizeof(beat.interval_ms);
+        writeAsLittleEndian(beat.heart_rate, &record[offset]);
+        offset += sizeof(beat.heart_rate);
+        writeAsLittleEndian(beat.mean_interval_ms, &record[offset]);
+        offset += sizeof(beat.mean_interval_ms);
+        writeAsLittleEndian(beat.rmssd_ms, &record[offset]);
+        offset += sizeof(beat.rmssd_ms);
+        record[offset] = std::byte{beat.interval_count};
+        break;
+    }
+    case AnalysisReport::Type::eTemplate: {
+        auto const& chunk = report.content.template_chunk;
+        writeAsLittleEndian(chunk.template_id, &record[offset]);
+        offset += sizeof(chunk.template_id);
+        record[offset++] = std::byte{chunk.beat_count};
+        record[offset++] = std::byte{chunk.first_point};
+        for (auto const& point : chunk.points) {
+            writeAsLittleEndian(point, &record[offset]);
+            offset += sizeof(point);
+        }
+        break;
+    }
+    case AnalysisReport::Type::eQuality: {
+        auto const& quality = report.content.quality;
+        writeAsLittleEndian(quality.first_sequence, &record[offset]);
+        offset += sizeof(quality.first_sequence);
+        writeAsLittleEndian(quality.last_sequence, &record[offset]);
+        offset += sizeof(quality.last_sequence);
+        record[offset++] = std::byte{quality.index};
+        record[offset++] = std::byte{quality.saturated_percent};
+        record[offset++] = std::byte{quality.steep_percent};
+        record[offset++] = std::byte{quality.flatline};
+        record[offset++] = static_cast<std::byte>(quality.correlation);
+        record[offset]   = std::byte{quality.beat_count};
+        break;
+    }
+    case AnalysisReport::Type::eSpectrum: {
+        auto const& spectrum = report.content.spectrum;
+        writeAsLittleEndian(spectrum.last_sequence, &record[offset]);
+        offset += sizeof(spectrum.last_sequence);
+        writeAsLittleEndian(spectrum.fundamental_mhz, &record[offset]);
+        offset += sizeof(spectrum.fundamental_mhz);
+        std::size_t const count = (size - kAnalysisHeaderSize - kSpectrumReportSize) / kSpectrumHarmonicSize;
+        record[offset++] = static_cast<std::byte>(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            writeAsLittleEndian(spectrum.amplitudes[i], &record[offset]);
+            offset += sizeof(spectrum.amplitudes[i]);
+            writeAsLittleEndian(spectrum.phases[i], &record[offset]);
+            offset += sizeof(spectrum.phases[i]);
+        }
+        break;
+    }
+    case AnalysisReport::Type::eEnvelope: {
+        auto const& envelope = report.content.envelope;
+        writeAsLittleEndian(envelope.measurement_id, &record[offset]);
+        offset += sizeof(envelope.measurement_id);
+        record[offset++] = std::byte{envelope.first_point};
+        record[offset++] = std::byte{envelope.beat_count};
+        writeAsLittleEndian(envelope.top_pressure, &record[offset]);
+        offset += sizeof(envelope.top_pressure);
+        writeAsLittleEndian(envelope.point_spacing, &record[offset]);
+        offset += sizeof(envelope.point_spacing);
+        writeAsLittleEndian(envelope.max_pressure, &record[offset]);
+        offset += sizeof(envelope.max_pressure);
+        writeAsLittleEndian(envelope.max_amplitude, &record[offset]);
+        offset += sizeof(envelope.max_amplitude);
+        for (auto const& amplitude : envelope.amplitudes) {
+            writeAsLittleEndian(amplitude, &record[offset]);
+            offset += sizeof(amplitude);
+        }
+        break;
+    }
+    case AnalysisReport::Type::eTransit: {
+        auto const& transit = report.content.transit;
+        writeAsLittleEndian(transit.sequence, &record[offset]);
+        offset += sizeof(transit.sequence);
+        record[offset++] = static_cast<std::byte>(std::to_underlying(transit.from));
+        writeAsLittleEndian(transit.delay_us, &record[offset]);
+        offset += sizeof(transit.delay_us);
+        record[offset] = static_cast<std::byte>(transit.correlation);
+        break;
+    }
+    case AnalysisReport::Type::eClass: {
+        auto const& classification = report.content.classification;
+        writeAsLittleEndian(classification.sequence, &record[offset]);
+        offset += sizeof(classification.sequence);
+        record[offset++] = std::byte{classification.label};
+        record[offset++] = std::byte{classification.confidence};
+        writeAsLittleEndian(classification.inference_us, &record[offset]);
+        break;
+    }
+    case AnalysisReport::Type::eTuning: {
+        auto const& tuning = report.content.tuning;
+        record[offset++] = std::byte{tuning.succeeded};
+        writeAsLittleEndian(tuning.pump_rate, &record[offset]);
+        offset += sizeof(tuning.pump_rate);
+        writeAsLittleEndian(tuning.vent_rate, &record[offset]);
+        offset += sizeof(tuning.vent_rate);
+        writeAsLittleEndian(tuning.dead_time_ms, &record[offset]);
+        offset += sizeof(tuning.dead_time_ms);
+        writeAsLittleEndian(tuning.kp, &record[offset]);
+        offset += sizeof(tuning.kp);
+        writeAsLittleEndian(tuning.ki, &record[offset]);
+        offset += sizeof(tuning.ki);
+        writeAsLittleEndian(tuning.settle_ms, &record[offset]);
+        offset += sizeof(tuning.settle_ms);
+        writeAsLittleEndian(tuning.vent_us_per_cycle, &record[offset]);
+        break;
+    }
+    default:
+        break;
+    }
+
+    this->analysis_batch_size += size;
+    return *this;
+}
+
+GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::clearAnalysisBatch() noexcept {
+    this->analysis_batch_size = 0;
+    return *this;
+}
+
+GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::setAnalysisClientConfiguration(
+    std::uint16_t const& configuration
+) noexcept {
+    this->analysis_client_configuration = configuration;
+    return *this;
+}
+
 GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::setPulseValueClientConfiguration(
     std::uint16_t configuration
 ) noexcept {
@@ -99,6 +445,20 @@ GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::setPulseVa
     return *this;
 }
 
+GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::setRecordDataSize(
+    std::size_t const& size
+) noexcept {
+    this->record_data_size = std::min(size, this->record_data.size());
+    return *this;
+}
+
+GattServer::CustomCharacteristics& GattServer::CustomCharacteristics::setRecordDataClientConfiguration(
+    std::uint16_t const& configuration
+) noexcept {
+    this->record_data_client_configuration = configuration;
+    return *this;
+}
+
 // Getters
 std::expected<Command, Error<std::byte>> GattServer::CustomCharacteristics::getCommand() const noexcept {
     auto command_type = toCommandType(this->command[0]);
@@ -122,6 +482,77 @@ std::expected<Command, Error<std::byte>> GattServer::CustomCharacteristics::getC
             break;
         case CommandType::eReset:
             break;
+        case CommandType::eDownloadRecord:
+            readAsNativeEndian(&this->command[1 + 0 * sizeof(std::uint32_t)], command_pack.content.record_range.first_sequence);
+            readAsNativeEndian(&this->command[1 + 1 * sizeof(std::uint32_t)], command_pack.content.record_range.last_sequence);
+            readAsNativeEndian(&this->command[1 + 2 * sizeof(std::uint32_t)], command_pack.content.record_range.session_id);
+            break;
+        case CommandType::eListSessions:
+            break;
+        case CommandType::eSweep: {
+            std::size_t offset = 1;
+            for (auto& level : command_pack.content.sweep_settings.levels) {
+                readAsNativeEndian(&this->command[offset + 0 * sizeof(std::float32_t)], level.cun);
+                readAsNativeEndian(&this->command[offset + 1 * sizeof(std::float32_t)], level.guan);
+                readAsNativeEndian(&this->command[offset + 2 * sizeof(std::float32_t)], level.chi);
+                offset += 3 * sizeof(std::float32_t);
+            }
+            for (auto& dwell_ms : command_pack.content.sweep_settings.dwell_ms) {
+                readAsNativeEndian(&this->command[offset], dwell_ms);
+                offset += sizeof(std::uint32_t);
+            }
+            break;
+        }
+        case CommandType::eOscillometry: {
+            auto& settings = command_pack.content.oscillometry_settings;
+            // An unknown position is rejected by the sampler
+            settings.position = toPosition(this->command[1]).value_or(Position::eNull);
+            readAsNativeEndian(&this->command[2], settings.inflate_pressure);
+            readAsNativeEndian(&this->command[6], settings.end_pressure);
+            readAsNativeEndian(&this->command[10], settings.deflate_rate);
+            break;
+        }
+        case CommandType::eSetControlGains: {
+            auto& settings = command_pack.content.control_settings;
+            // An unknown position is rejected by the sampler
+            settings.position = toPosition(this->command[1]).value_or(Position::eNull);
+            readAsNativeEndian(&this->command[2], settings.gains.kp);
+            readAsNativeEndian(&this->command[6], settings.gains.ki);
+            readAsNativeEndian(&this->command[10], settings.gains.settle_band);
+            readAsNativeEndian(&this->command[14], settings.gains.settle_ms);
+            readAsNativeEndian(&this->command[16], settings.gains.vent_us_per_cycle);
+            break;
+        }
+        case CommandType::eAutoTune: {
+            auto& settings = command_pack.content.auto_tune_settings;
+            // An unknown position is rejected by the sampler
+            settings.position = toPosition(this->command[1]).value_or(Position::eNull);
+            readAsNativeEndian(&this->command[2], settings.setpoint);
+            readAsNativeEndian(&this->command[6], settings.amplitude);
+            readAsNativeEndian(&this->command[10], settings.hysteresis);
+            break;
+        }
+        case CommandType::eSetProfile: {
+            auto& settings = command_pack.content.profile_settings;
+            // An unknown position, count or shape is rejected by the sampler
+            settings.position = toPosition(this->command[1]).value_or(Position::eNull);
+            settings.profile.count = std::to_integer<std::uint8_t>(this->command[2]);
+            std::size_t offset = 3;
+            for (std::size_t i = 0; i < std::min<std::size_t>(settings.profile.count, SetpointProfile::kMaxSegments); ++i) {
+                auto& segment = settings.profile.segments[i];
+                readAsNativeEndian(&this->command[offset], segment.pressure);
+                readAsNativeEndian(&this->command[offset + 4], segment.rate);
+                readAsNativeEndian(&this->command[offset + 6], segment.hold_ms);
+                auto const shape = toProfileShape(this->command[offset + 8]);
+                if (!shape) {
+                    settings.profile.count = 0;
+                    break;
+                }
+                segment.shape = shape.value();
+                offset += kProfileSegmentSize;
+            }
+            break;
+        }
         default:
             break;
     }
@@ -158,6 +589,12 @@ PulseValue GattServer::CustomCharacteristics::getPulseValue() const noexcept {
     offset += sizeof(value.guan);
 
     readAsNativeEndian(&this->pulse_value[offset], value.chi);
+    offset += sizeof(value.chi);
+
+    value.segment = toPressureType(this->pulse_value[offset]).value_or(PressureType::eNull);
+    offset += sizeof(value.segment);
+
+    readAsNativeEndian(&this->pulse_value[offset], value.sequence);
     
     return value;
 }
@@ -166,6 +603,137 @@ std::uint16_t GattServer::CustomCharacteristics::getPulseValueClientConfiguratio
     return this->pulse_value_client_configuration;
 }
 
+std::size_t GattServer::CustomCharacteristics::getPulseBatchCount() const noexcept {
+    if (this->pulse_batch_queued == kPulseBatchSlots) {
+        return 0;
+    }
+    return this->pulse_batches[(this->pulse_batch_head + this->pulse_batch_queued) % kPulseBatchSlots].count;
+}
+
+bool GattServer::CustomCharacteristics::canAppendPulseValue(PulseValue const& value) const noexcept {
+    if (this->pulse_batch_queued == kPulseBatchSlots) {
+        return false;
+    }
+    PulseBatch const& batch = this->pulse_batches[(this->pulse_batch_head + this->pulse_batch_queued) % kPulseBatchSlots];
+    if (batch.count == 0 || !batch.packed) {
+        return true;
+    }
+    // The sequences of a packed batch are implied, and the delta takes 24 bits
+    return value.sequence == batch.last_sequence + 1 &&
+           value.segment == batch.segment &&
+           value.timestamp - batch.last_timestamp < (std::uint64_t{1} << 24);
+}
+
+std::size_t GattServer::CustomCharacteristics::getQueuedPulseBatchCount() const noexcept {
+    return this->pulse_batch_queued;
+}
+
+std::uint16_t GattServer::CustomCharacteristics::getPreviewClientConfiguration() const noexcept {
+    return this->preview_client_configuration;
+}
+
+std::size_t GattServer::CustomCharacteristics::getSummarySize() const noexcept {
+    return this->summary_size;
+}
+
+std::uint16_t GattServer::CustomCharacteristics::getSummaryClientConfiguration() const noexcept {
+    return this->summary_client_configuration;
+}
+
+AcquisitionConfig GattServer::CustomCharacteristics::getAcquisitionConfig() const noexcept {
+    return parseAcquisitionConfig(this->acquisition_configuration);
+}
+
+AcquisitionConfig GattServer::CustomCharacteristics::parseAcquisitionConfig(
+    std::span<std::byte const, kConfigurationSize> const& bytes
+) noexcept {
+    AcquisitionConfig config{};
+    readAsNativeEndian(&bytes[0], config.conversion_wait_ms);
+    config.channel_mask = std::to_integer<std::uint8_t>(bytes[2]);
+    config.batch_size   = std::to_integer<std::uint8_t>(bytes[3]);
+    readAsNativeEndian(&bytes[4], config.flush_deadline_ms);
+    for (std::size_t i = 0; i < config.filter_sections.size(); ++i) {
+        config.filter_sections[i] = std::to_integer<std::uint8_t>(bytes[6 + i]);
+    }
+    config.mains_hz           = std::to_integer<std::uint8_t>(bytes[9]);
+    config.template_beats     = std::to_integer<std::uint8_t>(bytes[10]);
+    config.quality_threshold  = std::to_integer<std::uint8_t>(bytes[11]);
+    config.spectral_harmonics = std::to_integer<std::uint8_t>(bytes[12]);
+    config.preview_decimation = std::to_integer<std::uint8_t>(bytes[13]);
+    config.packed_batches     = std::to_integer<std::uint8_t>(bytes[14]) != 0;
+    config.classify_beats     = std::to_integer<std::uint8_t>(bytes[15]) != 0;
+    readAsNativeEndian(&bytes[16], config.summary_window_ms);
+    return config;
+}
+
+std::size_t GattServer::CustomCharacteristics::getAnalysisBatchSize() const noexcept {
+    return this->analysis_batch_size;
+}
+
+std::uint16_t GattServer::CustomCharacteristics::getAnalysisClientConfiguration() const noexcept {
+    return this->analysis_client_configuration;
+}
+
+std::size_t GattServer::CustomCharacteristics::getAnalysisRecordSize(AnalysisReport const& report) noexcept {
+    switch (report.type) {
+    case AnalysisReport::Type::eBeat:
+        return kAnalysisHeaderSize + kBeatReportSize;
+    case AnalysisReport::Type::eTemplate:
+        return kAnalysisHeaderSize + kTemplateReportSize;
+    case AnalysisReport::Type::eQuality:
+        return kAnalysisHeaderSize + kQualityReportSize;
+    case AnalysisReport::Type::eSpectrum:
+        return kAnalysisHeaderSize + kSpectrumReportSize +
+               std::min<std::size_t>(report.content.spectrum.harmonic_count, AnalysisReport::Content::Spectrum::kMaxHarmonics) *
+               kSpectrumHarmonicSize;
+    case AnalysisReport::Type::eEnvelope:
+        return kAnalysisHeaderSize + kEnvelopeReportSize;
+    case AnalysisReport::Type::eTransit:
+        return kAnalysisHeaderSize + kTransitReportSize;
+    case AnalysisReport::Type::eClass:
+        return kAnalysisHeaderSize + kClassReportSize;
+    case AnalysisReport::Type::eTuning:
+        return kAnalysisHeaderSize + kTuningReportSize;
+    default:
+        return 0;
+    }
+}
+
+std::size_t GattServer::CustomCharacteristics::getMaxAnalysisRecordSize(AcquisitionConfig const& config) noexcept {
+    // Beats, quality windows and transit delays are always analysed
+    std::size_t size = kAnalysisHeaderSize + std::max({ kBeatReportSize, kQualityReportSize, kTransitReportSize });
+    if (config.classify_beats) {
+        size = std::max(size, kAnalysisHeaderSize + kClassReportSize);
+    }
+    if (config.template_beats > 0) {
+        size = std::max(size, kAnalysisHeaderSize + kTemplateReportSize);
+    }
+    if (config.spectral_harmonics > 0) {
+        size = std::max(size, kAnalysisHeaderSize + kSpectrumReportSize + config.spectral_harmonics * kSpectrumHarmonicSize);
+    }
+    return size;
+}
+
+std::size_t GattServer::CustomCharacteristics::getSummarySize(AcquisitionConfig const& config) noexcept {
+    return kSummaryHeaderSize + std::popcount(config.channel_mask) * kSummaryChannelSize;
+}
+
+std::size_t GattServer::CustomCharacteristics::getPulseBatchSize(AcquisitionConfig const& config) noexcept {
+    if (!config.packed_batches) {
+        return config.batch_size * kPulseValueSize;
+    }
+    std::size_t const channels = std::popcount(config.channel_mask);
+    return kPackedHeaderSize + config.batch_size * kPackedFieldSize * (1 + channels);
+}
+
+std::size_t GattServer::CustomCharacteristics::getRecordDataSize() const noexcept {
+    return this->record_data_size;
+}
+
+std::uint16_t GattServer::CustomCharacteristics::getRecordDataClientConfiguration() const noexcept {
+    return this->record_data_client_configuration;
+}
+
 // ================================================================================================
 // == GattServer                                                                                 ==
 // ================================================================================================
@@ -293,7 +861,16 @@ void GattServer::packetHandler(
         /* Log handling */
         this->hci_con_handle = HCI_CON_HANDLE_INVALID;
         this->characteristics = CustomCharacteristics{};
+        this->notification_pending_preview = false;
+        this->notification_pending_summary = false;
+        this->notification_pending_record_data = false;
+        this->notification_pending_analysis = false;
         if (this->command_callback) {
+            // The acquisition configuration only lives as long as the connection
+            this->command_callback(
+                this->command_callback_context,
+                Command{ .command_type = CommandType::eConfigure, .content = { .acquisition_config = kDefaultAcquisitionConfig } }
+            );
             this->command_callback(this->command_callback_context, Command{ CommandType::eReset, {} });
         }
         BPS_LOG("Disconnected!\n");
@@ -310,13 +887,70 @@ void GattServer::packetHandler(
                 this->characteristics.getMachineStatusArray().size()
             );
             att_server_request_can_send_now_event(this->hci_con_handle);
-        } else if (this->notification_pending_pulse_value) {
-            this->notification_pending_pulse_value = false;
+        } else if (this->notification_pending_preview) {
+            // The live preview never waits behind the pulse data batches
+            this->notification_pending_preview = false;
+            att_server_notify(
+                this->hci_con_handle,
+                Att::Handle::CustomCharacteristic::Preview::kValue,
+                reinterpret_cast<uint8_t*>(this->characteristics.getPreviewValueArray().data()),
+                this->characteristics.getPreviewValueArray().size()
+            );
+            att_server_request_can_send_now_event(this->hci_con_handle);
+        } else if (this->notification_pending_summary) {
+            this->notification_pending_summary = false;
+            att_server_notify(
+                this->hci_con_handle,
+                Att::Handle::CustomCharacteristic::Summary::kValue,
+                reinterpret_cast<uint8_t*>(this->characteristics.getSummaryArray().data()),
+                this->characteristics.getSummarySize()
+            );
+            att_server_request_can_send_now_event(this->hci_con_handle);
+        } else if (this->notification_pending_analysis) {
+            // Few and small, the reports go ahead of the pulse values
+            this->notification_pending_analysis = false;
+            att_server_notify(
+                this->hci_con_handle,
+                Att::Handle::CustomCharacteristic::Analysis::kValue,
+                reinterpret_cast<uint8_t*>(this->characteristics.getAnalysisBatchArray().data()),
+                this->characteristics.getAnalysisBatchSize()
+            );
+            this->characteristics.clearAnalysisBatch();
+            att_server_request_can_send_now_event(this->hci_con_handle);
+        } else if (this->characteristics.getQueuedPulseBatchCount() > 0) {
+            auto const& batch = this->characteristics.getOldestPulseBatch();
+            if (att_server_notify(
+                    this->hci_con_handle,
+                    Att::Handle::CustomCharacteristic::PulseValue::kValue,
+                    reinterpret_cast<uint8_t const*>(batch.data.data()),
+                    batch.size
+                ) == ERROR_CODE_SUCCESS) {
+                diagnostics::Diagnostics::getInstance().countNotified(batch.count);
+                this->characteristics.popPulseBatch();
+            }
+            // A refused batch stays queued for the next chance to send
+            att_server_request_can_send_now_event(this->hci_con_handle);
+        } else if (this->notification_pending_record_data) {
+            // Pull the next chunk, as large as the current MTU allows
+            std::size_t const chunk_size = std::min(
+                static_cast<std::size_t>(att_server_get_mtu(this->hci_con_handle) - 3),
+                this->characteristics.getRecordDataArray().size()
+            );
+            std::size_t const filled_size = this->record_chunk_callback(
+                this->record_chunk_callback_context,
+                this->characteristics.getRecordDataArray().data(),
+                chunk_size
+            );
+            this->characteristics.setRecordDataSize(filled_size);
+            if (filled_size == 0) {
+                this->notification_pending_record_data = false;
+                break;
+            }
             att_server_notify(
                 this->hci_con_handle,
-                Att::Handle::CustomCharacteristic::PulseValue::kValue,
-                reinterpret_cast<uint8_t*>(this->characteristics.getPulseValueArray().data()),
-                this->characteristics.getPulseValueArray().size()
+                Att::Handle::CustomCharacteristic::RecordData::kValue,
+                reinterpret_cast<uint8_t*>(this->characteristics.getRecordDataArray().data()),
+                this->characteristics.getRecordDataSize()
             );
             att_server_request_can_send_now_event(this->hci_con_handle);
         }
@@ -331,6 +965,7 @@ void GattServer::packetHandler(
 GattServer& GattServer::sendMachineStatus(
     MachineStatus const& status
 ) noexcept {
+    ContextLock const lock{};
     this->characteristics.setMachineStatus(status);
     if (this->characteristics.getMachineStatusClientConfiguration() == 
     GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION &&
@@ -344,11 +979,122 @@ GattServer& GattServer::sendMachineStatus(
 GattServer& GattServer::sendPulseValue(
     PulseValue const& value
 ) noexcept {
-    this->characteristics.setPulseValue(value);
+    ContextLock const lock{};
+    auto& counters = diagnostics::Diagnostics::getInstance();
     if (this->characteristics.getPulseValueClientConfiguration() == 
     GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION &&
     (this->hci_con_handle != HCI_CON_HANDLE_INVALID)) {
-        this->notification_pending_pulse_value = true;
+        if (!this->characteristics.canAppendPulseValue(value)) {
+            // A gap or a new segment starts the next packed batch
+            closePulseBatch();
+        }
+        this->characteristics.appendPulseValue(value);
+        if (this->characteristics.getPulseBatchCount() >= this->characteristics.getAcquisitionConfig().batch_size) {
+            closePulseBatch();
+        }
+    } else {
+        this->characteristics.setPulseValue(value);
+        counters.countDrop(diagnostics::Stage::eBleQueue);
+    }
+    return *this;
+}
+
+GattServer& GattServer::flushPulseValues() noexcept {
+    ContextLock const lock{};
+    if (this->hci_con_handle != HCI_CON_HANDLE_INVALID) {
+        closePulseBatch();
+    }
+    return *this;
+}
+
+GattServer& GattServer::sendPreviewValue(
+    PulseValue const& value
+) noexcept {
+    ContextLock const lock{};
+    this->characteristics.setPreviewValue(value);
+    if (this->characteristics.getPreviewClientConfiguration() ==
+    GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION &&
+    (this->hci_con_handle != HCI_CON_HANDLE_INVALID)) {
+        // A point still waiting for the link is simply replaced
+        this->notification_pending_preview = true;
+        att_server_request_can_send_now_event(this->hci_con_handle);
+    }
+    return *this;
+}
+
+GattServer& GattServer::sendSummary(
+    PulseSummary const& summary
+) noexcept {
+    ContextLock const lock{};
+    this->characteristics.setSummary(summary);
+    if (this->characteristics.getSummaryClientConfiguration() ==
+    GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION &&
+    (this->hci_con_handle != HCI_CON_HANDLE_INVALID)) {
+        this->notification_pending_summary = true;
+        att_server_request_can_send_now_event(this->hci_con_handle);
+    }
+    return *this;
+}
+
+void GattServer::closePulseBatch() noexcept {
+    if (this->characteristics.getPulseBatchCount() == 0) {
+        return;
+    }
+    if (this->characteristics.getQueuedPulseBatchCount() + 1 >= CustomCharacteristics::kPulseBatchSlots) {
+        // The link fell too far behind, the oldest batch makes room
+        diagnostics::Diagnostics::getInstance().countDrop(
+            diagnostics::Stage::eNotify,
+            this->characteristics.getOldestPulseBatch().count
+        );
+        this->characteristics.popPulseBatch();
+    }
+    this->characteristics.closePulseBatch();
+    att_server_request_can_send_now_event(this->hci_con_handle);
+}
+
+GattServer& GattServer::sendAnalysisReport(
+    AnalysisReport const& report
+) noexcept {
+    ContextLock const lock{};
+    if (this->characteristics.getAnalysisClientConfiguration() ==
+    GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION &&
+    (this->hci_con_handle != HCI_CON_HANDLE_INVALID)) {
+        // A report which doesn't fit the pending notification is dropped and counted
+        std::size_t const payload_size = std::min(
+            static_cast<std::size_t>(att_server_get_mtu(this->hci_con_handle) - 3),
+            this->characteristics.getAnalysisBatchArray().size()
+        );
+        std::size_t const record_size = CustomCharacteristics::getAnalysisRecordSize(report);
+        if (record_size > payload_size) {
+            diagnostics::Diagnostics::getInstance().countAnalysisDrop(true);
+        } else if (this->characteristics.getAnalysisBatchSize() + record_size > payload_size) {
+            diagnostics::Diagnostics::getInstance().countAnalysisDrop(false);
+        } else {
+            this->characteristics.appendAnalysisReport(report);
+            this->notification_pending_analysis = true;
+            att_server_request_can_send_now_event(this->hci_con_handle);
+        }
+    }
+    return *this;
+}
+
+AcquisitionConfig GattServer::getAcquisitionConfig() const noexcept {
+    ContextLock const lock{};
+    return this->characteristics.getAcquisitionConfig();
+}
+
+std::size_t GattServer::getUnflushedPulseValueCount() const noexcept {
+    ContextLock const lock{};
+    return this->characteristics.getPulseBatchCount();
+}
+
+GattServer& GattServer::requestRecordData() noexcept {
+    ContextLock const lock{};
+    if (this->record_chunk_callback &&
+    this->characteristics.getRecordDataClientConfiguration() ==
+    GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION &&
+    (this->hci_con_handle != HCI_CON_HANDLE_INVALID)) {
+        this->notification_pending_record_data = true;
         att_server_request_can_send_now_event(this->hci_con_handle);
     }
     return *this;
@@ -375,6 +1121,16 @@ void GattServer::registerCommandCallback(commandCallback_t callback, void* conte
     this->command_callback_context = context;
 }
 
+void GattServer::registerRecordChunkCallback(recordChunkCallback_t callback, void* context) noexcept {
+    this->record_chunk_callback = callback;
+    this->record_chunk_callback_context = context;
+}
+
+void GattServer::registerEmergencyStopCallback(emergencyStopCallback_t callback, void* context) noexcept {
+    this->emergency_stop_callback = callback;
+    this->emergency_stop_callback_context = context;
+}
+
 // Real att read / write callback
 uint16_t GattServer::attReadCallback(
     [[maybe_unused]] hci_con_handle_t const& con_handle,
@@ -445,6 +1201,141 @@ uint16_t GattServer::attReadCallback(
             buffer_size
         );
 
+    case Att::Handle::CustomCharacteristic::RecordData::kValue:
+        return att_read_callback_handle_blob(
+            reinterpret_cast<uint8_t const*>(this->characteristics.getRecordDataArray().data()),
+            this->characteristics.getRecordDataSize(),
+            offset,
+            buffer,
+            buffer_size
+        );
+
+    case Att::Handle::CustomCharacteristic::RecordData::kClientConfiguration:
+        return att_read_callback_handle_little_endian_16(
+            this->characteristics.getRecordDataClientConfiguration(),
+            offset,
+            buffer,
+            buffer_size
+        );
+
+    case Att::Handle::CustomCharacteristic::RecordData::kUserDescription:
+        return att_read_callback_handle_blob(
+            reinterpret_cast<uint8_t const*>(CustomCharacteristics::record_data_description.data()),
+            CustomCharacteristics::record_data_description.size(),
+            offset,
+            buffer,
+            buffer_size
+        );
+
+    case Att::Handle::CustomCharacteristic::Diagnostics::kValue:
+        // Keep the counters consistent over the read blob requests of a small MTU
+        if (offset == 0 && buffer != nullptr) {
+            this->characteristics.getDiagnosticsArray() = diagnostics::Diagnostics::getInstance().getSnapshot();
+        }
+        return att_read_callback_handle_blob(
+            reinterpret_cast<uint8_t const*>(this->characteristics.getDiagnosticsArray().data()),
+            this->characteristics.getDiagnosticsArray().size(),
+            offset,
+            buffer,
+            buffer_size
+        );
+
+    case Att::Handle::CustomCharacteristic::Configuration::kValue:
+        return att_read_callback_handle_blob(
+            reinterpret_cast<uint8_t const*>(this->characteristics.getConfigurationArray().data()),
+            this->characteristics.getConfigurationArray().size(),
+            offset,
+            buffer,
+            buffer_size
+        );
+
+    case Att::Handle::CustomCharacteristic::Configuration::kUserDescription:
+        return att_read_callback_handle_blob(
+            reinterpret_cast<uint8_t const*>(CustomCharacteristics::configuration_description.data()),
+            CustomCharacteristics::configuration_description.size(),
+            offset,
+            buffer,
+            buffer_size
+        );
+
+    case Att::Handle::CustomCharacteristic::Diagnostics::kUserDescription:
+        return att_read_callback_handle_blob(
+            reinterpret_cast<uint8_t const*>(CustomCharacteristics::diagnostics_description.data()),
+            CustomCharacteristics::diagnostics_description.size(),
+            offset,
+            buffer,
+            buffer_size
+        );
+
+    case Att::Handle::CustomCharacteristic::Analysis::kClientConfiguration:
+        return att_read_callback_handle_little_endian_16(
+            this->characteristics.getAnalysisClientConfiguration(),
+            offset,
+            buffer,
+            buffer_size
+        );
+
+    case Att::Handle::CustomCharacteristic::Analysis::kUserDescription:
+        return att_read_callback_handle_blob(
+            reinterpret_cast<uint8_t const*>(CustomCharacteristics::analysis_description.data()),
+            CustomCharacteristics::analysis_description.size(),
+            offset,
+            buffer,
+            buffer_size
+        );
+
+    case Att::Handle::CustomCharacteristic::Preview::kValue:
+        return att_read_callback_handle_blob(
+            reinterpret_cast<uint8_t const*>(this->characteristics.getPreviewValueArray().data()),
+            this->characteristics.getPreviewValueArray().size(),
+            offset,
+            buffer,
+            buffer_size
+        );
+
+    case Att::Handle::CustomCharacteristic::Preview::kClientConfiguration:
+        return att_read_callback_handle_little_endian_16(
+            this->characteristics.getPreviewClientConfiguration(),
+            offset,
+            buffer,
+            buffer_size
+        );
+
+    case Att::Handle::CustomCharacteristic::Preview::kUserDescription:
+        return att_read_callback_handle_blob(
+            reinterpret_cast<uint8_t const*>(CustomCharacteristics::preview_description.data()),
+            CustomCharacteristics::preview_description.size(),
+            offset,
+            buffer,
+            buffer_size
+        );
+
+    case Att::Handle::CustomCharacteristic::Summary::kValue:
+        return att_read_callback_handle_blob(
+            reinterpret_cast<uint8_t const*>(this->characteristics.getSummaryArray().data()),
+            this->characteristics.getSummarySize(),
+            offset,
+            buffer,
+            buffer_size
+        );
+
+    case Att::Handle::CustomCharacteristic::Summary::kClientConfiguration:
+        return att_read_callback_handle_little_endian_16(
+            this->characteristics.getSummaryClientConfiguration(),
+            offset,
+            buffer,
+            buffer_size
+        );
+
+    case Att::Handle::CustomCharacteristic::Summary::kUserDescription:
+        return att_read_callback_handle_blob(
+            reinterpret_cast<uint8_t const*>(CustomCharacteristics::summary_description.data()),
+            CustomCharacteristics::summary_description.size(),
+            offset,
+            buffer,
+            buffer_size
+        );
+
     default:
         break;
     }
@@ -452,26 +1343,138 @@ uint16_t GattServer::attReadCallback(
     return 0;
 }
 
+void GattServer::dispatchCommand() noexcept {
+    auto command = this->characteristics.getCommand();
+    if (command && command.value().command_type == CommandType::eEmergencyStop) {
+        // Sent as a long write
+        emergencyStop(time_us_32());
+        return;
+    }
+    if (this->command_callback) {
+        this->command_callback(this->command_callback_context, command);
+    }
+}
+
+void GattServer::emergencyStop(std::uint32_t const& start_us) noexcept {
+    if (this->emergency_stop_callback) {
+        this->emergency_stop_callback(this->emergency_stop_callback_context);
+    }
+    diagnostics::Diagnostics::getInstance().countEmergencyStop(time_us_32() - start_us);
+}
+
+bool GattServer::isSustainable(AcquisitionConfig const& config) const noexcept {
+    std::size_t const channels = std::popcount(config.channel_mask);
+    std::size_t const payload_size = att_server_get_mtu(this->hci_con_handle) - 3;
+
+    // The sensors need their conversion time whatever the channel count
+    bool const bus_sustainable =
+        channels > 0 &&
+        (config.channel_mask & ~AcquisitionConfig::kAllChannels) == 0 &&
+        config.conversion_wait_ms >= AcquisitionConfig::kMinConversionWaitMs &&
+        config.conversion_wait_ms <= AcquisitionConfig::kMaxConversionWaitMs;
+
+    // One batch per sample at the shortest conversion wait is still within the notification rate
+    static_assert(AcquisitionConfig::kMinConversionWaitMs >= kMinNotificationIntervalMs);
+    bool const link_sustainable =
+        config.batch_size > 0 &&
+        CustomCharacteristics::getPulseBatchSize(config) <= std::min(payload_size, CustomCharacteristics::kMaxNotificationSize) &&
+        config.flush_deadline_ms >= config.conversion_wait_ms &&
+        config.flush_deadline_ms <= kMaxFlushDeadlineMs;
+
+    bool const preview_sustainable =
+        config.preview_decimation == 0 ||
+        config.conversion_wait_ms * config.preview_decimation >= kMinPreviewIntervalMs;
+
+    bool const summary_sustainable =
+        config.summary_window_ms == 0 ||
+        CustomCharacteristics::getSummarySize(config) <= std::min(payload_size, CustomCharacteristics::kMaxNotificationSize);
+
+    // Every analysis record the configuration produces fits one notification
+    bool const analysis_sustainable =
+        CustomCharacteristics::getMaxAnalysisRecordSize(config) <= std::min(payload_size, CustomCharacteristics::kMaxNotificationSize);
+
+    return bus_sustainable && link_sustainable && preview_sustainable && summary_sustainable && analysis_sustainable &&
+           dsp::FilterBank::supports(config) &&
+           analysis::PulseAnalyzer::supports(config) &&
+           analysis::SummaryStatistics::supports(config);
+}
+
 int GattServer::attWriteCallback(
     [[maybe_unused]] hci_con_handle_t const& con_handle,
     uint16_t const& attribute_handle,
-    [[maybe_unused]] uint16_t const& transaction_mode,
-    [[maybe_unused]] uint16_t const& offset,
+    uint16_t const& transaction_mode,
+    uint16_t const& offset,
     unsigned char *buffer,
-    [[maybe_unused]] uint16_t const& buffer_size
+    uint16_t const& buffer_size
 ) noexcept {
     switch (attribute_handle) {
     case Att::Handle::CustomCharacteristic::Command::kValue:
-        std::memcpy(
-            this->characteristics.getCommandArray().data(),
-            buffer,
-            std::min(static_cast<std::size_t>(buffer_size), this->characteristics.getCommandArray().size())
-        );
+        // Emergency stop cuts the outputs before anything else, the state machine
+        // notices the latched stop on its next pass
+        if (transaction_mode == ATT_TRANSACTION_MODE_NONE && buffer_size > 0 &&
+            buffer[0] == std::to_underlying(CommandType::eEmergencyStop)) {
+            emergencyStop(time_us_32());
+            break;
+        }
+        switch (transaction_mode) {
+        case ATT_TRANSACTION_MODE_NONE:
+            // Short writes leave the trailing fields zeroed
+            this->characteristics.getCommandArray().fill(std::byte{0});
+            std::memcpy(
+                this->characteristics.getCommandArray().data(),
+                buffer,
+                std::min(static_cast<std::size_t>(buffer_size), this->characteristics.getCommandArray().size())
+            );
+            dispatchCommand();
+            break;
+        case ATT_TRANSACTION_MODE_ACTIVE:
+            // Long write with a small MTU, fragments are assembled in place until executed
+            if (offset == 0) {
+                this->characteristics.getCommandArray().fill(std::byte{0});
+            }
+            if (static_cast<std::size_t>(offset) + buffer_size > this->characteristics.getCommandArray().size()) {
+                return ATT_ERROR_INVALID_OFFSET;
+            }
+            std::memcpy(this->characteristics.getCommandArray().data() + offset, buffer, buffer_size);
+            break;
+        case ATT_TRANSACTION_MODE_EXECUTE:
+            dispatchCommand();
+            break;
+        case ATT_TRANSACTION_MODE_CANCEL:
+            this->characteristics.getCommandArray().fill(std::byte{0});
+            break;
+        default:
+            break;
+        }
+        break;
+
+    case Att::Handle::CustomCharacteristic::Configuration::kValue: {
+        if (transaction_mode != ATT_TRANSACTION_MODE_NONE) {
+            return ATT_ERROR_REQUEST_NOT_SUPPORTED;
+        }
+        // Older clients write the first bytes only, the missing fields read as zero (turned off)
+        if (buffer_size < CustomCharacteristics::kMinConfigurationSize ||
+            buffer_size > CustomCharacteristics::kConfigurationSize) {
+            return ATT_ERROR_INVALID_ATTRIBUTE_VALUE_LENGTH;
+        }
+        // Parse a copy first, the current configuration is kept on rejection
+        std::array<std::byte, CustomCharacteristics::kConfigurationSize> bytes{ std::byte{0} };
+        std::memcpy(bytes.data(), buffer, buffer_size);
+        AcquisitionConfig const config = CustomCharacteristics::parseAcquisitionConfig(bytes);
+        if (!isSustainable(config)) {
+            return ATT_ERROR_VALUE_NOT_ALLOWED;
+        }
+        // The open batch keeps the format and channels it was started with
+        closePulseBatch();
+        this->characteristics.setAcquisitionConfig(config);
         if (this->command_callback) {
-            auto command = this->characteristics.getCommand();
-            this->command_callback(this->command_callback_context, command);
+            this->command_callback(
+                this->command_callback_context,
+                Command{ .command_type = CommandType::eConfigure, .content = { .acquisition_config = config } }
+            );
         }
         break;
+    }
 
     case Att::Handle::CustomCharacteristic::MachineStatus::kClientConfiguration:
         this->characteristics.setMachineStatusClientConfiguration(little_endian_read_16(buffer, 0));
@@ -480,6 +1483,22 @@ int GattServer::attWriteCallback(
     case Att::Handle::CustomCharacteristic::PulseValue::kClientConfiguration:
         this->characteristics.setPulseValueClientConfiguration(little_endian_read_16(buffer, 0));
         break;
+
+    case Att::Handle::CustomCharacteristic::RecordData::kClientConfiguration:
+        this->characteristics.setRecordDataClientConfiguration(little_endian_read_16(buffer, 0));
+        break;
+
+    case Att::Handle::CustomCharacteristic::Analysis::kClientConfiguration:
+        this->characteristics.setAnalysisClientConfiguration(little_endian_read_16(buffer, 0));
+        break;
+
+    case Att::Handle::CustomCharacteristic::Preview::kClientConfiguration:
+        this->characteristics.setPreviewClientConfiguration(little_endian_read_16(buffer, 0));
+        break;
+
+    case Att::Handle::CustomCharacteristic::Summary::kClientConfiguration:
+        this->characteristics.setSummaryClientConfiguration(little_endian_read_16(buffer, 0));
+        break;
         
     default:
         break;
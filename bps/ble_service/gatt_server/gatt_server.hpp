@@ -8,6 +8,7 @@
 #include <cstdint>
 #include <cstddef>
 #include <array>
+#include <span>
 #include <stdfloat>
 #include <expected>
 #include <string_view>
@@ -15,6 +16,7 @@
 #include "gatt_database.hpp"
 #include "common.hpp"
 #include "utils.hpp"
+#include "diagnostics.hpp"
 
 #define APP_AD_FLAGS 0x06
 
@@ -25,6 +27,11 @@ class GattServer {
     public:
         // Predefined type for convenience usages
         using commandCallback_t = void (*)(void* context, std::expected<Command, Error<std::byte>> command);
+        // Fill at most "buffer_size" bytes of record data into "buffer", return the number of filled bytes.
+        // Returning 0 means there is nothing left to transfer.
+        using recordChunkCallback_t = std::size_t (*)(void* context, std::byte* buffer, std::size_t buffer_size);
+        // Cut every pneumatic output, called straight from the ATT write handler
+        using emergencyStopCallback_t = void (*)(void* context);
 
         // Meyers' Singleton basic constructor settings
         static GattServer& getInstance() noexcept {
@@ -44,6 +51,9 @@ class GattServer {
         // =========================================================
         // == Setters, only allow to set data readable by client  ==
         // =========================================================
+
+        // The setters are called from the BLE task while BTstack notifies from its own
+        // async context, they hold the lock of that context for the whole update
         
         GattServer& sendMachineStatus(
             MachineStatus const& status
@@ -60,6 +70,29 @@ class GattServer {
             std::float32_t const& chi
         ) noexcept;
 
+        // Notify the partial pulse value batch without waiting for it to fill up
+        GattServer& flushPulseValues() noexcept;
+
+        // Replace the preview point waiting for the link, only the latest one is notified
+        GattServer& sendPreviewValue(
+            PulseValue const& value
+        ) noexcept;
+
+        // Replace the summary waiting for the link, only the latest window is notified
+        GattServer& sendSummary(
+            PulseSummary const& summary
+        ) noexcept;
+
+        // Queue a report for the next analysis notification, the reports which arrive
+        // before the link can send are notified together
+        GattServer& sendAnalysisReport(
+            AnalysisReport const& report
+        ) noexcept;
+
+        // Start pulling record data from the registered record chunk callback,
+        // one notification is sent every time the link can take one
+        GattServer& requestRecordData() noexcept;
+
         // =========================================================
         // == Getters                                             ==
         // =========================================================
@@ -79,11 +112,26 @@ class GattServer {
         [[nodiscard]] std::uint16_t getPulseValueClientConfiguration() const noexcept {
             return this->characteristics.getPulseValueClientConfiguration();
         }
+        [[nodiscard]] std::uint16_t getRecordDataClientConfiguration() const noexcept {
+            return this->characteristics.getRecordDataClientConfiguration();
+        }
+        // Safe from any task, like the setters
+        [[nodiscard]] AcquisitionConfig getAcquisitionConfig() const noexcept;
+        // Number of batched pulse values which are not scheduled for notification yet, safe from any task
+        [[nodiscard]] std::size_t getUnflushedPulseValueCount() const noexcept;
 
         // Register the Command & pressure base value callback which will be called
         // when value has been written
         void registerCommandCallback(commandCallback_t callback, void* context) noexcept;
 
+        // Register the record chunk callback which will be called when the link
+        // can send the next record data notification
+        void registerRecordChunkCallback(recordChunkCallback_t callback, void* context) noexcept;
+
+        // Register the emergency stop callback which will be called as soon as an
+        // EmergencyStop command is written, before any queue is involved
+        void registerEmergencyStopCallback(emergencyStopCallback_t callback, void* context) noexcept;
+
     private:
         // ================================================================================================
         // == Nest class: CustomCaracteristics                                                           ==
@@ -98,6 +146,67 @@ class GattServer {
                 = "Status of sampler";
                 static constexpr inline std::string_view pulse_value_description
                 = "Measured pulsed value";
+                static constexpr inline std::string_view record_data_description
+                = "Recorded pulse value blocks";
+                static constexpr inline std::string_view diagnostics_description
+                = "Sample drop counters";
+                static constexpr inline std::string_view configuration_description
+                = "Acquisition configuration";
+                static constexpr inline std::string_view analysis_description
+                = "Pulse analysis reports";
+                static constexpr inline std::string_view preview_description
+                = "Decimated live pulse value";
+                static constexpr inline std::string_view summary_description
+                = "Windowed pulse value statistics";
+
+                // Largest notification payload with the maximum LE data length
+                static constexpr std::size_t kMaxNotificationSize = 244;
+                // Serialized size of one pulse value
+                static constexpr std::size_t kPulseValueSize = 25;
+                // Packed batch header: u32 first sequence, u64 first timestamp, u8 segment, u8 channel mask
+                static constexpr std::size_t kPackedHeaderSize = 14;
+                // Packed sample: u24 timestamp delta in us, then an i24 pressure per enabled channel
+                static constexpr std::size_t kPackedFieldSize = 3;
+                // Pressure unit of the packed samples, 1/64 Pa
+                static constexpr std::float32_t kPackedPressureScale = 64.0f;
+                // Pulse data notifications which can wait for the link, the batch being filled included
+                static constexpr std::size_t kPulseBatchSlots = 8;
+                // Serialized size of the acquisition configuration, and of its filterless prefix
+                static constexpr std::size_t kConfigurationSize    = 18;
+                static constexpr std::size_t kMinConfigurationSize = 6;
+                // Set profile segment: f32 pressure, u16 rate, u16 hold time, u8 shape
+                static constexpr std::size_t kProfileSegmentSize = 9;
+                // Summary header: u64 first timestamp, u32 first sequence, u16 sample count, u8 segment,
+                // u8 channel mask, then a f32 minimum, maximum, mean and variance per enabled channel
+                static constexpr std::size_t kSummaryHeaderSize  = 16;
+                static constexpr std::size_t kSummaryChannelSize = 16;
+                static constexpr std::size_t kMaxSummarySize     = kSummaryHeaderSize + 3 * kSummaryChannelSize;
+                // Analysis record header: u8 report type, u8 payload size, u8 position
+                static constexpr std::size_t kAnalysisHeaderSize = 3;
+                static constexpr std::size_t kBeatReportSize     = 21;
+                static constexpr std::size_t kTemplateReportSize = 4 + 2 * AnalysisReport::Content::TemplateChunk::kPoints;
+                static constexpr std::size_t kQualityReportSize  = 14;
+                // Fixed part, then an amplitude and a phase per harmonic
+                static constexpr std::size_t kSpectrumReportSize = 7;
+                static constexpr std::size_t kSpectrumHarmonicSize = 4;
+                static constexpr std::size_t kEnvelopeReportSize = 18 + 2 * AnalysisReport::Content::Envelope::kPoints;
+                static constexpr std::size_t kTransitReportSize  = 8;
+                static constexpr std::size_t kClassReportSize    = 8;
+                static constexpr std::size_t kTuningReportSize   = 23;
+
+                // One pulse data notification, filled with consecutive values
+                struct PulseBatch {
+                    std::array<std::byte, kMaxNotificationSize> data{ std::byte{0} };
+                    std::size_t   size  = 0;
+                    std::size_t   count = 0;
+                    // Format and channels of the batch, fixed by its first value
+                    bool          packed = false;
+                    std::uint8_t  channel_mask = 0;
+                    // Last appended value, a packed batch continues from it
+                    std::uint32_t last_sequence = 0;
+                    std::uint64_t last_timestamp = 0;
+                    PressureType  segment = PressureType::eNull;
+                };
 
                 CustomCharacteristics();
 
@@ -126,6 +235,57 @@ class GattServer {
                 CustomCharacteristics& setPulseValueClientConfiguration(
                     std::uint16_t configuration
                 ) noexcept;
+
+                // Serialize the value, then append it to the open notification batch
+                CustomCharacteristics& appendPulseValue(
+                    PulseValue const& value
+                ) noexcept;
+
+                // Queue the open batch for notification, the next slot opens empty.
+                // The caller makes room first when every slot is queued.
+                CustomCharacteristics& closePulseBatch() noexcept;
+
+                // Release the oldest queued batch, once notified or dropped
+                CustomCharacteristics& popPulseBatch() noexcept;
+
+                CustomCharacteristics& setPreviewValue(
+                    PulseValue const& value
+                ) noexcept;
+
+                CustomCharacteristics& setPreviewClientConfiguration(
+                    std::uint16_t const& configuration
+                ) noexcept;
+
+                CustomCharacteristics& setSummary(
+                    PulseSummary const& summary
+                ) noexcept;
+
+                CustomCharacteristics& setSummaryClientConfiguration(
+                    std::uint16_t const& configuration
+                ) noexcept;
+
+                CustomCharacteristics& setAcquisitionConfig(
+                    AcquisitionConfig const& config
+                ) noexcept;
+
+                // Serialize the report as one record, then append it to the analysis batch
+                CustomCharacteristics& appendAnalysisReport(
+                    AnalysisReport const& report
+                ) noexcept;
+
+                CustomCharacteristics& clearAnalysisBatch() noexcept;
+
+                CustomCharacteristics& setAnalysisClientConfiguration(
+                    std::uint16_t const& configuration
+                ) noexcept;
+
+                CustomCharacteristics& setRecordDataSize(
+                    std::size_t const& size
+                ) noexcept;
+
+                CustomCharacteristics& setRecordDataClientConfiguration(
+                    std::uint16_t const& configuration
+                ) noexcept;
                 
 
                 // =========================================================
@@ -137,26 +297,94 @@ class GattServer {
                 [[nodiscard]] std::uint16_t getMachineStatusClientConfiguration() const noexcept;
                 [[nodiscard]] PulseValue getPulseValue() const noexcept;
                 [[nodiscard]] std::uint16_t getPulseValueClientConfiguration() const noexcept;
+                [[nodiscard]] std::size_t getRecordDataSize() const noexcept;
+                [[nodiscard]] std::uint16_t getRecordDataClientConfiguration() const noexcept;
+                // Samples in the open batch
+                [[nodiscard]] std::size_t getPulseBatchCount() const noexcept;
+                // Whether "value" can extend the open batch, a packed batch only holds
+                // consecutive samples of one segment
+                [[nodiscard]] bool canAppendPulseValue(PulseValue const& value) const noexcept;
+                [[nodiscard]] std::size_t getQueuedPulseBatchCount() const noexcept;
+                [[nodiscard]] std::uint16_t getPreviewClientConfiguration() const noexcept;
+                [[nodiscard]] std::size_t getSummarySize() const noexcept;
+                [[nodiscard]] std::uint16_t getSummaryClientConfiguration() const noexcept;
+                // Oldest queued batch, only valid when at least one is queued
+                [[nodiscard]] PulseBatch const& getOldestPulseBatch() const noexcept {
+                    return this->pulse_batches[this->pulse_batch_head];
+                }
+                [[nodiscard]] AcquisitionConfig getAcquisitionConfig() const noexcept;
+                // Configuration serialized in "bytes", with the layout of the characteristic
+                [[nodiscard]] static AcquisitionConfig parseAcquisitionConfig(std::span<std::byte const, kConfigurationSize> const& bytes) noexcept;
+                [[nodiscard]] std::size_t getAnalysisBatchSize() const noexcept;
+                [[nodiscard]] std::uint16_t getAnalysisClientConfiguration() const noexcept;
+                // Serialized size of the report record, 0 for an unknown type
+                [[nodiscard]] static std::size_t getAnalysisRecordSize(AnalysisReport const& report) noexcept;
+                // Largest record the streamed samples can produce under "config"
+                [[nodiscard]] static std::size_t getMaxAnalysisRecordSize(AcquisitionConfig const& config) noexcept;
+                // Serialized size of a full pulse data batch with this configuration
+                [[nodiscard]] static std::size_t getPulseBatchSize(AcquisitionConfig const& config) noexcept;
+                // Serialized size of a summary with this configuration
+                [[nodiscard]] static std::size_t getSummarySize(AcquisitionConfig const& config) noexcept;
                 // Data array reference getter
                 [[nodiscard]] auto& getCommandArray() noexcept { return this->command; };
                 [[nodiscard]] auto& getMachineStatusArray() noexcept { return this->machine_status; };
                 [[nodiscard]] auto& getPulseValueArray() noexcept { return this->pulse_value; };
+                [[nodiscard]] auto& getRecordDataArray() noexcept { return this->record_data; };
+                [[nodiscard]] auto& getDiagnosticsArray() noexcept { return this->diagnostics; };
+                [[nodiscard]] auto& getPreviewValueArray() noexcept { return this->preview_value; };
+                [[nodiscard]] auto& getSummaryArray() noexcept { return this->summary_value; };
+                [[nodiscard]] auto& getConfigurationArray() noexcept { return this->acquisition_configuration; };
+                [[nodiscard]] auto& getAnalysisBatchArray() noexcept { return this->analysis_batch; };
                 
             private:
+                // Write the 25-byte pulse value layout at "destination"
+                static void serializePulseValue(PulseValue const& value, std::byte* destination) noexcept;
+
                 // =========================================================
                 // == Serialized data and client configuration            ==
                 // =========================================================
                 
-                // Characteristic Command information
-                std::array<std::byte, 13> command{ std::byte{0} };
+                // Characteristic Command information, sized for the longest command (eSweep)
+                std::array<std::byte, 49> command{ std::byte{0} };
+                static_assert(3 + SetpointProfile::kMaxSegments * kProfileSegmentSize <= std::tuple_size_v<decltype(command)>);
 
                 // Characteristic Machine status information
                 std::array<std::byte, 1> machine_status{ std::byte{0} };
                 std::uint16_t            machine_status_client_configuration = 0;
 
                 // Characteristic Pulse value set information
-                std::array<std::byte, 20> pulse_value{ std::byte{0} };
-                std::uint16_t             pulse_value_client_configuration = 0;
+                std::array<std::byte, kPulseValueSize> pulse_value{ std::byte{0} };
+                std::uint16_t                          pulse_value_client_configuration = 0;
+
+                // Pulse data notifications, queued oldest first and followed by the open batch
+                std::array<PulseBatch, kPulseBatchSlots> pulse_batches{};
+                std::size_t                              pulse_batch_head = 0;
+                std::size_t                              pulse_batch_queued = 0;
+
+                // Characteristic Preview information, only the latest point is kept
+                std::array<std::byte, kPulseValueSize> preview_value{ std::byte{0} };
+                std::uint16_t                          preview_client_configuration = 0;
+
+                // Characteristic Summary information, the last closed window
+                std::array<std::byte, kMaxSummarySize> summary_value{ std::byte{0} };
+                std::size_t                            summary_size = 0;
+                std::uint16_t                          summary_client_configuration = 0;
+
+                // Characteristic Record data information, holds the last sent chunk
+                std::array<std::byte, kMaxNotificationSize> record_data{ std::byte{0} };
+                std::size_t                                 record_data_size = 0;
+                std::uint16_t                               record_data_client_configuration = 0;
+
+                // Characteristic Diagnostics information, refreshed when a read starts
+                diagnostics::Diagnostics::Snapshot diagnostics{ std::byte{0} };
+
+                // Characteristic Configuration information
+                std::array<std::byte, kConfigurationSize> acquisition_configuration{ std::byte{0} };
+
+                // Characteristic Analysis information, records waiting to be notified together
+                std::array<std::byte, kMaxNotificationSize> analysis_batch{ std::byte{0} };
+                std::size_t                                 analysis_batch_size = 0;
+                std::uint16_t                               analysis_client_configuration = 0;
 
         } characteristics{};
         // ================================================================================================
@@ -175,15 +403,42 @@ class GattServer {
         
         // Notifycation flags, true when there is one or more data need to be notified
         bool notification_pending_machine_status{false};
-        bool notification_pending_pulse_value{false};
+        bool notification_pending_preview{false};
+        bool notification_pending_summary{false};
+        bool notification_pending_record_data{false};
+        bool notification_pending_analysis{false};
 
         // command & pressure base value callback registered by user
         commandCallback_t command_callback{nullptr};
         void* command_callback_context{nullptr};
 
+        // record chunk callback registered by user
+        recordChunkCallback_t record_chunk_callback{nullptr};
+        void* record_chunk_callback_context{nullptr};
+
+        // emergency stop callback registered by user
+        emergencyStopCallback_t emergency_stop_callback{nullptr};
+        void* emergency_stop_callback_context{nullptr};
+
         // Btstack packet handlers
         void packetHandler(uint8_t packet_type, uint16_t channel, uint8_t* packet, uint16_t size);
 
+        // Parse the command array and hand it to the command callback
+        void dispatchCommand() noexcept;
+        // Queue the open pulse data batch, dropping the oldest queued one when every slot is taken
+        void closePulseBatch() noexcept;
+        // Run the emergency stop callback, "start_us" is when the write was received
+        void emergencyStop(std::uint32_t const& start_us) noexcept;
+
+        // What the link sustains: notifications at most every 5 ms, bounded batch latency
+        static constexpr std::uint16_t kMinNotificationIntervalMs = 5;
+        static constexpr std::uint16_t kMaxFlushDeadlineMs        = 1000;
+        // The preview is for the eye, at most 50 points per second
+        static constexpr std::uint16_t kMinPreviewIntervalMs      = 20;
+
+        // Check a configuration against the I2C bus and the current link
+        bool isSustainable(AcquisitionConfig const& config) const noexcept;
+
         // Real att read / write callback
         uint16_t attReadCallback(
             hci_con_handle_t const& con_handle,
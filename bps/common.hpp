@@ -7,8 +7,7 @@
 #include <cstddef>
 #include <stdfloat>
 #include <optional>
-
-#include "queue.hpp"
+#include <array>
 
 // UDL for 'pa' unit, return 32-bits float
 consteval std::float32_t operator""_pa(long double pa) {
@@ -36,11 +35,22 @@ concept ByteTypes = (sizeof(T) == 1u);
 
 // Type of Command
 enum class CommandType : std::uint8_t {
-    eNull          = 0X00,
-    eStopSampling  = 0x01,
-    eStartSampling = 0x02,
-    eSetPressure   = 0x03,
-    eReset         = 0x04
+    eNull            = 0X00,
+    eStopSampling    = 0x01,
+    eStartSampling   = 0x02,
+    eSetPressure     = 0x03,
+    eReset           = 0x04,
+    eDownloadRecord  = 0x05,
+    eListSessions    = 0x06,
+    eSweep           = 0x07,
+    // Internal only, sent when the configuration characteristic is written
+    eConfigure       = 0x08,
+    // Handled by the GATT server itself, never queued
+    eEmergencyStop   = 0x09,
+    eOscillometry    = 0x0A,
+    eSetControlGains = 0x0B,
+    eAutoTune        = 0x0C,
+    eSetProfile      = 0x0D
 };
 // Helper function, convert each byte type value to CommandType enum class
 // Return std::nullopt optional if there is no matched enum
@@ -55,6 +65,22 @@ inline std::optional<CommandType> toCommandType(ByteTypes auto value) noexcept {
         return CommandType::eSetPressure;
     case std::to_underlying(CommandType::eReset):
         return CommandType::eReset;
+    case std::to_underlying(CommandType::eDownloadRecord):
+        return CommandType::eDownloadRecord;
+    case std::to_underlying(CommandType::eListSessions):
+        return CommandType::eListSessions;
+    case std::to_underlying(CommandType::eSweep):
+        return CommandType::eSweep;
+    case std::to_underlying(CommandType::eEmergencyStop):
+        return CommandType::eEmergencyStop;
+    case std::to_underlying(CommandType::eOscillometry):
+        return CommandType::eOscillometry;
+    case std::to_underlying(CommandType::eSetControlGains):
+        return CommandType::eSetControlGains;
+    case std::to_underlying(CommandType::eAutoTune):
+        return CommandType::eAutoTune;
+    case std::to_underlying(CommandType::eSetProfile):
+        return CommandType::eSetProfile;
     default:
         return std::nullopt;
     }
@@ -65,7 +91,10 @@ enum class MachineStatus : std::uint8_t {
     eNull            = 0x00,
     eIdle            = 0x01,
     eSampling        = 0x02,
-    eSettingPressure = 0x03
+    eSettingPressure = 0x03,
+    eSweeping        = 0x04,
+    eOscillometry    = 0x05,
+    eAutoTuning      = 0x06
 };
 // Helper function, convert each byte type value to MachineStatus enum class
 // Return std::nullopt optional if there is no matched enum
@@ -78,6 +107,12 @@ inline std::optional<MachineStatus> toMachineStatus(ByteTypes auto value) noexce
         return MachineStatus::eSampling;
     case std::to_underlying(MachineStatus::eSettingPressure):
         return MachineStatus::eSettingPressure;
+    case std::to_underlying(MachineStatus::eSweeping):
+        return MachineStatus::eSweeping;
+    case std::to_underlying(MachineStatus::eOscillometry):
+        return MachineStatus::eOscillometry;
+    case std::to_underlying(MachineStatus::eAutoTuning):
+        return MachineStatus::eAutoTuning;
     default:
         return std::nullopt;
     }
@@ -129,6 +164,132 @@ inline std::optional<PressureType> toPressureType(ByteTypes auto value) noexcept
     }
 }
 
+// Runtime acquisition settings, written through the configuration characteristic
+struct AcquisitionConfig {
+    // Bit of each position in "channel_mask"
+    static constexpr std::uint8_t kCunChannel  = 1u << 0;
+    static constexpr std::uint8_t kGuanChannel = 1u << 1;
+    static constexpr std::uint8_t kChiChannel  = 1u << 2;
+    static constexpr std::uint8_t kAllChannels = kCunChannel | kGuanChannel | kChiChannel;
+
+    // Conversion time of the sensors, PressureSensors::kSampleRateMs. The channels convert
+    // together, so it does not grow with the channel count. No sample comes faster.
+    static constexpr std::uint16_t kMinConversionWaitMs = 6;
+    static constexpr std::uint16_t kMaxConversionWaitMs = 1000;
+
+    // Delay between triggering the conversions and fetching them. It is NOT the sample
+    // period, which adds the transfers and the processing of every sample: stages which
+    // depend on the rate use the interval measured between the sample timestamps.
+    std::uint16_t conversion_wait_ms;
+    // Channels to acquire while streaming, disabled channels read 0 Pa
+    std::uint8_t  channel_mask;
+    // Number of samples carried by one pulse data notification
+    std::uint8_t  batch_size;
+    // Longest time a partial batch waits before it is notified
+    std::uint16_t flush_deadline_ms;
+    // Filter sections applied to each streamed channel, in the Cun, Guan, Chi order
+    // (dsp::FilterBank section bits)
+    std::array<std::uint8_t, 3> filter_sections;
+    // Mains frequency rejected by the notch section, 50 or 60 Hz
+    std::uint8_t  mains_hz;
+    // Beats averaged into each beat template, 0 streams every sample instead
+    std::uint8_t  template_beats;
+    // Quality index below which a window of samples is not streamed, 0 streams every window
+    std::uint8_t  quality_threshold;
+    // Harmonics, the fundamental included, reported by the spectral stage, 0 turns it off
+    std::uint8_t  spectral_harmonics;
+    // Filtered samples averaged into each live preview point, 0 turns the preview off
+    std::uint8_t  preview_decimation;
+    // Pulse data batches are delta-packed instead of carrying whole 25-byte samples
+    bool          packed_batches;
+    // Every beat is classified on the device, see analysis::PulseClassifier
+    bool          classify_beats;
+    // Length of the summary statistics windows, 0 turns the summaries off
+    std::uint16_t summary_window_ms;
+};
+
+inline constexpr AcquisitionConfig kDefaultAcquisitionConfig{
+    .conversion_wait_ms = 6,
+    .channel_mask       = AcquisitionConfig::kAllChannels,
+    .batch_size         = 1,
+    .flush_deadline_ms  = 50,
+    .filter_sections    = { 0, 0, 0 },
+    .mains_hz           = 50,
+    .template_beats     = 0,
+    .quality_threshold  = 0,
+    .spectral_harmonics = 0,
+    .preview_decimation = 0,
+    .packed_batches     = false,
+    .classify_beats     = false,
+    .summary_window_ms  = 0
+};
+
+// Pressure controller settings of one channel. The controller output goes from -1
+// (vent as much as a control cycle allows) to 1 (pump at full duty).
+struct ControlGains {
+    // Output per Pa of error
+    std::float32_t kp;
+    // Output per Pa of error and per second
+    std::float32_t ki;
+    // The channel is stable once the error stays within the band for "settle_ms"
+    std::float32_t settle_band;
+    std::uint16_t  settle_ms;
+    // Valve opening per control cycle at an output of -1, in us
+    std::uint16_t  vent_us_per_cycle;
+};
+
+// Full pump at 4 kPa below the target, the integral takes over the last few hundred Pa
+inline constexpr ControlGains kDefaultControlGains{
+    .kp                = 0.00025f,
+    .ki                = 0.0002f,
+    .settle_band       = 300.0_pa,
+    .settle_ms         = 150,
+    .vent_us_per_cycle = 5000
+};
+
+// How a profile segment moves the setpoint to its pressure
+enum class ProfileShape : std::uint8_t {
+    // At once
+    eStep   = 0x00,
+    // At a constant rate
+    eRamp   = 0x01,
+    // Smoothly from rest to rest, at the rate at most
+    eSCurve = 0x02
+};
+// Helper function, convert each byte type value to ProfileShape enum class
+// Return std::nullopt optional if there is no matched enum
+inline std::optional<ProfileShape> toProfileShape(ByteTypes auto value) noexcept {
+    auto const enum_value = static_cast<std::underlying_type<ProfileShape>::type>(value);
+    switch (enum_value) {
+    case std::to_underlying(ProfileShape::eStep):
+        return ProfileShape::eStep;
+    case std::to_underlying(ProfileShape::eRamp):
+        return ProfileShape::eRamp;
+    case std::to_underlying(ProfileShape::eSCurve):
+        return ProfileShape::eSCurve;
+    default:
+        return std::nullopt;
+    }
+}
+
+// Piecewise setpoint of one channel. Each segment moves the setpoint from where the
+// previous one left it, the first from the pressure of the channel, to "pressure",
+// then holds it for "hold_ms".
+struct SetpointProfile {
+    static constexpr std::size_t kMaxSegments = 5;
+
+    struct Segment {
+        std::float32_t pressure;
+        // In Pa/s, unused by eStep
+        std::uint16_t  rate;
+        std::uint16_t  hold_ms;
+        ProfileShape   shape;
+    };
+
+    std::array<Segment, kMaxSegments> segments;
+    std::uint8_t count;
+};
+
 // Hold Common the machine should do
 struct Command {
     CommandType command_type = CommandType::eNull;
@@ -139,6 +300,47 @@ struct Command {
             std::float32_t guan;
             std::float32_t chi;
         } pressure_settings;
+        // For eDownloadRecord command, inclusive sequence range.
+        // Session 0 is the RAM ring, any other id is a session stored in flash.
+        struct RecordRange {
+            std::uint32_t first_sequence;
+            std::uint32_t last_sequence;
+            std::uint16_t session_id;
+        } record_range;
+        // For eSweep command, targets and dwell time of each level, in the
+        // float, middle, deep order. A level with a zero dwell time is skipped.
+        struct SweepSettings {
+            std::array<PressureInfo, 3>  levels;
+            std::array<std::uint32_t, 3> dwell_ms;
+        } sweep_settings;
+        // For eConfigure command
+        AcquisitionConfig acquisition_config;
+        // For eOscillometry command, the channel is inflated to "inflate_pressure", then
+        // deflated at "deflate_rate" Pa/s down to "end_pressure"
+        struct OscillometrySettings {
+            Position       position;
+            std::float32_t inflate_pressure;
+            std::float32_t end_pressure;
+            std::uint16_t  deflate_rate;
+        } oscillometry_settings;
+        // For eSetControlGains command
+        struct ControlSettings {
+            Position     position;
+            ControlGains gains;
+        } control_settings;
+        // For eAutoTune command, the relay output switches between "amplitude" and
+        // "-amplitude" whenever the pressure leaves "setpoint" by more than "hysteresis"
+        struct AutoTuneSettings {
+            Position       position;
+            std::float32_t setpoint;
+            std::float32_t amplitude;
+            std::float32_t hysteresis;
+        } auto_tune_settings;
+        // For eSetProfile command
+        struct ProfileSettings {
+            Position        position;
+            SetpointProfile profile;
+        } profile_settings;
     } content;
 };
 
@@ -148,6 +350,169 @@ struct PulseValue {
     std::float32_t cun  = 0.0_pa;
     std::float32_t guan = 0.0_pa;
     std::float32_t chi  = 0.0_pa;
+    // Sweep level the sample was taken at, eNull outside of a sweep
+    PressureType   segment = PressureType::eNull;
+    // Assigned at acquisition, it increases by one for every streamed sample
+    std::uint32_t  sequence = 0;
+};
+
+// Statistics of the streamed samples over one window, notified on the summary characteristic
+struct PulseSummary {
+    struct Channel {
+        std::float32_t min;
+        std::float32_t max;
+        std::float32_t mean;
+        // Population variance, in Pa^2
+        std::float32_t variance;
+    };
+    // Timestamp and sequence of the first sample of the window
+    std::uint64_t timestamp = 0;
+    std::uint32_t first_sequence = 0;
+    std::uint16_t sample_count = 0;
+    PressureType  segment = PressureType::eNull;
+    // Channels of the window, the disabled ones are left zeroed
+    std::uint8_t  channel_mask = 0;
+    // In the Cun, Guan, Chi order
+    std::array<Channel, 3> channels{};
+};
+
+// Low-rate result of the on-device pulse analysis, notified on the analysis characteristic
+struct AnalysisReport {
+    enum class Type : std::uint8_t {
+        eNull = 0x00,
+        // One detected beat, with the beat-to-beat interval statistics
+        eBeat     = 0x01,
+        // A slice of an ensemble-averaged beat template
+        eTemplate = 0x02,
+        // Signal quality index of a window of streamed samples
+        eQuality  = 0x03,
+        // Fundamental and harmonics of a window of streamed samples
+        eSpectrum = 0x04,
+        // A slice of the oscillation amplitude against cuff pressure of an oscillometric deflation
+        eEnvelope = 0x05,
+        // Pulse transit delay of one beat from the previous enabled position
+        eTransit  = 0x06,
+        // Pulse character of one beat, from the on-device classifier
+        eClass    = 0x07,
+        // Outcome of an auto-tune experiment, with the identified plant and the new gains
+        eTuning   = 0x08
+    };
+    Type     type = Type::eNull;
+    Position position = Position::eNull;
+    union Content {
+        // For eBeat report
+        struct Beat {
+            // Interpolated start of the upstroke, in us like PulseValue::timestamp
+            std::uint64_t timestamp;
+            // Streamed sample the beat was detected on
+            std::uint32_t sequence;
+            // Time since the previous beat, 0 for the first beat after a gap
+            std::uint16_t interval_ms;
+            // Instantaneous heart rate from the interval, in 0.1 bpm
+            std::uint16_t heart_rate;
+            // Mean and root mean square of successive differences of the last "interval_count" intervals
+            std::uint16_t mean_interval_ms;
+            std::uint16_t rmssd_ms;
+            std::uint8_t  interval_count;
+        } beat;
+        // For eTemplate report
+        struct TemplateChunk {
+            static constexpr std::size_t kPoints = 16;
+            // Counts the templates of the position, the chunks of one template share it
+            std::uint16_t template_id;
+            // Beats averaged into the template
+            std::uint8_t  beat_count;
+            // Index in the template of the first point of this chunk
+            std::uint8_t  first_point;
+            // Pressure relative to the first template point, in 1/8 Pa
+            std::array<std::int16_t, kPoints> points;
+        } template_chunk;
+        // For eQuality report
+        struct Quality {
+            // Inclusive sequence range of the window
+            std::uint32_t first_sequence;
+            std::uint32_t last_sequence;
+            // 0 unusable to 100
+            std::uint8_t  index;
+            std::uint8_t  saturated_percent;
+            // Share of the steps steeper than any pulse
+            std::uint8_t  steep_percent;
+            // 1 when the window is flat
+            std::uint8_t  flatline;
+            // Mean correlation of the window beats with the reference beat, in percent
+            std::int8_t   correlation;
+            std::uint8_t  beat_count;
+        } quality;
+        // For eSpectrum report
+        struct Spectrum {
+            static constexpr std::size_t kMaxHarmonics = 8;
+            // Last streamed sample of the window
+            std::uint32_t last_sequence;
+            // 0 when no fundamental was found
+            std::uint16_t fundamental_mhz;
+            // Valid entries of "amplitudes" and "phases", the fundamental first
+            std::uint8_t  harmonic_count;
+            // Amplitude of each harmonic, in 1/16 Pa
+            std::array<std::uint16_t, kMaxHarmonics> amplitudes;
+            // Phase of each harmonic minus its rank times the phase of the fundamental, in 0.1 mrad
+            std::array<std::int16_t, kMaxHarmonics>  phases;
+        } spectrum;
+        // For eEnvelope report
+        struct Envelope {
+            static constexpr std::size_t kPoints      = 16;
+            static constexpr std::size_t kTotalPoints = 32;
+            // Counts the deflations, the chunks of one envelope share it
+            std::uint16_t  measurement_id;
+            // Index in the envelope of the first point of this chunk
+            std::uint8_t   first_point;
+            // Beats measured during the deflation
+            std::uint8_t   beat_count;
+            // Cuff pressure of point 0, the next points step down by "point_spacing"
+            std::float32_t top_pressure;
+            std::float32_t point_spacing;
+            // Cuff pressure and amplitude of the largest oscillation, 0 when no beat was measured
+            std::float32_t max_pressure;
+            std::uint16_t  max_amplitude;
+            // Mean oscillation amplitude of the beats around each point, in 1/16 Pa, 0 without beat
+            std::array<std::uint16_t, kPoints> amplitudes;
+        } envelope;
+        // For eTransit report, the report position is the one the delay is measured at
+        struct Transit {
+            // Streamed sample the beat was detected on at the first enabled position
+            std::uint32_t sequence;
+            // Position the delay is measured from
+            Position      from;
+            // Arrival at the report position minus arrival at "from", in us
+            std::int16_t  delay_us;
+            // Peak correlation of the two upstrokes, in percent
+            std::int8_t   correlation;
+        } transit;
+        // For eClass report
+        struct Classification {
+            // Streamed sample the beat after the classified one was detected on
+            std::uint32_t sequence;
+            // analysis::pulse_model::PulseClass
+            std::uint8_t  label;
+            // Share of the model votes for "label", in percent
+            std::uint8_t  confidence;
+            // Time the inference took on the device, 0 when it was not measured
+            std::uint16_t inference_us;
+        } classification;
+        // For eTuning report
+        struct Tuning {
+            // 0 when the experiment failed, the other fields are then zero
+            std::uint8_t   succeeded;
+            // Pressure rate at full pump and at full vent, in Pa/s
+            std::float32_t pump_rate;
+            std::float32_t vent_rate;
+            std::uint16_t  dead_time_ms;
+            // Gains now in use, see ControlGains
+            std::float32_t kp;
+            std::float32_t ki;
+            std::uint16_t  settle_ms;
+            std::uint16_t  vent_us_per_cycle;
+        } tuning;
+    } content{};
 };
 
 } // namespace bps
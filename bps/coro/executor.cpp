@@ -0,0 +1,115 @@
+#include "executor.hpp"
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <coroutine>
+
+#include "diagnostics.hpp"
+
+namespace bps::coro {
+
+Executor::Executor() noexcept {}
+
+bool Executor::spawn(Task&& task) noexcept {
+    if (!task.isValid() || this->slot_count >= this->slots.size()) {
+        return false;
+    }
+    // A zero timeout resumes it on the first pass
+    this->slots[this->slot_count++] = Slot{ .handle = task.release() };
+    return true;
+}
+
+bool Executor::createTask(UBaseType_t const& priority) noexcept {
+    static auto freertos_task =
+        [](void* context) {
+            Executor* executor = static_cast<Executor*>(context);
+            executor->taskLoop();
+        };
+    this->task_handle = xTaskCreateStatic(
+        freertos_task,
+        "Executor",
+        kStackDepth,
+        this,
+        priority,
+        this->task_stack.data(),
+        &this->task_buffer
+    );
+    return this->task_handle != nullptr;
+}
+
+void Executor::notify() noexcept {
+    if (this->task_handle != nullptr) {
+        xTaskNotifyGive(this->task_handle);
+    }
+}
+
+void Executor::notifyFromIsr(BaseType_t* higher_priority_task_woken) noexcept {
+    if (this->task_handle != nullptr) {
+        vTaskNotifyGiveFromISR(this->task_handle, higher_priority_task_woken);
+    }
+}
+
+void* Executor::allocateFrame(std::size_t const& size) noexcept {
+    constexpr std::size_t kAlignment = alignof(std::max_align_t);
+    std::size_t const aligned_size = (size + kAlignment - 1) & ~(kAlignment - 1);
+    if (aligned_size > this->frame_arena.size() - this->frame_arena_used) {
+        return nullptr;
+    }
+    void* frame = &this->frame_arena[this->frame_arena_used];
+    this->frame_arena_used += aligned_size;
+    return frame;
+}
+
+void Executor::park(bool (*ready)(void* context), void* ready_context, TickType_t const& wait_ticks) noexcept {
+    Slot& slot = this->slots[this->running_slot];
+    slot.ready         = ready;
+    slot.ready_context = ready_context;
+    slot.wait_start    = xTaskGetTickCount();
+    slot.wait_ticks    = wait_ticks;
+}
+
+void Executor::taskLoop() noexcept {
+    // Refresh the stack headroom every this many wakeups, the check walks the whole stack
+    constexpr std::uint32_t kStackCheckPeriod = 256;
+
+    auto& counters = diagnostics::Diagnostics::getInstance();
+    std::uint32_t wakeups = 0;
+    counters.setExecutorMemory(this->frame_arena_used, uxTaskGetStackHighWaterMark(nullptr));
+
+    while (true) {
+        bool resumed = false;
+        TickType_t block_ticks = portMAX_DELAY;
+
+        for (std::size_t i = 0; i < this->slot_count; ++i) {
+            Slot& slot = this->slots[i];
+            if (slot.handle.done()) {
+                continue;
+            }
+            TickType_t const elapsed   = xTaskGetTickCount() - slot.wait_start;
+            bool const       timed_out = (slot.wait_ticks != portMAX_DELAY) && (elapsed >= slot.wait_ticks);
+            if (timed_out || (slot.ready != nullptr && slot.ready(slot.ready_context))) {
+                this->running_slot = i;
+                counters.countResume();
+                slot.handle.resume();
+                resumed = true;
+            } else if (slot.wait_ticks != portMAX_DELAY) {
+                block_ticks = std::min(block_ticks, slot.wait_ticks - elapsed);
+            }
+        }
+
+        if (!resumed) {
+            // Every coroutine waits, this is the only place the task gives the CPU away
+            ulTaskNotifyTake(pdTRUE, block_ticks);
+            counters.countExecutorWakeup();
+            if (++wakeups % kStackCheckPeriod == 0) {
+                counters.setExecutorMemory(this->frame_arena_used, uxTaskGetStackHighWaterMark(nullptr));
+            }
+        }
+    }
+}
+
+} // namespace bps::coro
\ No newline at end of file
@@ -0,0 +1,189 @@
+#ifndef BPS_CORO_EXECUTOR_HPP
+#define BPS_CORO_EXECUTOR_HPP
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <coroutine>
+#include <type_traits>
+
+namespace bps::coro {
+
+// Root coroutine run by the Executor.
+//
+// Frames come from the executor's static frame arena and are never given back,
+// the root coroutines live as long as the firmware. A coroutine which does not
+// fit in the arena yields an invalid Task, spawn() then reports the failure.
+class Task {
+    public:
+        struct promise_type {
+            Task get_return_object() noexcept {
+                return Task{ std::coroutine_handle<promise_type>::from_promise(*this) };
+            }
+            static Task get_return_object_on_allocation_failure() noexcept {
+                return Task{};
+            }
+            // Started by the executor, not by the caller
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            std::suspend_always final_suspend() const noexcept { return {}; }
+            void return_void() const noexcept {}
+            void unhandled_exception() const noexcept { configASSERT(false); }
+
+            static void* operator new(std::size_t size) noexcept;
+            static void operator delete([[maybe_unused]] void* frame) noexcept {}
+        };
+
+        Task() noexcept = default;
+        Task(Task const&) = delete;
+        Task& operator=(Task const&) = delete;
+        Task(Task&& other) noexcept: handle(other.handle) { other.handle = nullptr; }
+        Task& operator=(Task&& other) noexcept {
+            this->handle = other.handle;
+            other.handle = nullptr;
+            return *this;
+        }
+
+        bool isValid() const noexcept {
+            return static_cast<bool>(this->handle);
+        }
+
+        // Hand the coroutine over to its new owner
+        std::coroutine_handle<> release() noexcept {
+            std::coroutine_handle<> released = this->handle;
+            this->handle = nullptr;
+            return released;
+        }
+
+    private:
+        explicit Task(std::coroutine_handle<promise_type> const& coroutine) noexcept: handle(coroutine) {}
+
+        std::coroutine_handle<> handle{};
+};
+
+// Meyers' Singleton Implementation
+//
+// Cooperative executor running every spawned coroutine on one FreeRTOS task.
+// A coroutine runs until it awaits sleepFor() or waitUntil(), and the task only
+// blocks when every coroutine waits, until the earliest timeout or notify().
+//
+// waitUntil() predicates are evaluated by the executor task, any number of times.
+// They only look at state and never take or change anything, a resource waited for
+// is taken once the coroutine resumes. They may only depend on state changed by the
+// coroutines themselves, anything changed from another task or from an interrupt
+// must be followed by notify() or notifyFromIsr().
+class Executor {
+    public:
+        // Coroutines which can be spawned
+        static constexpr std::size_t   kMaxCoroutines  = 4;
+        // Static storage for the coroutine frames
+        static constexpr std::size_t   kFrameArenaSize = 1024;
+        // Executor task stack, in words
+        static constexpr std::uint32_t kStackDepth     = 2048;
+
+        // Suspend the calling coroutine for "ticks" ticks, 0 waits for the next tick
+        // so that a coroutine looping on short sleeps never keeps the task spinning
+        struct SleepAwaiter {
+            TickType_t ticks;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend([[maybe_unused]] std::coroutine_handle<> handle) const noexcept {
+                Executor::getInstance().park(nullptr, nullptr, std::max<TickType_t>(this->ticks, 1));
+            }
+            void await_resume() const noexcept {}
+        };
+
+        // Suspend the calling coroutine until "predicate" returns true
+        template<typename Predicate>
+        struct WaitAwaiter {
+            static_assert(std::is_invocable_r_v<bool, Predicate const&>,
+                "A waitUntil() predicate only looks, it is called as const");
+
+            Predicate predicate;
+
+            bool await_ready() const noexcept { return this->predicate(); }
+            void await_suspend([[maybe_unused]] std::coroutine_handle<> handle) noexcept {
+                Executor::getInstance().park(&WaitAwaiter::isReady, &this->predicate, portMAX_DELAY);
+            }
+            void await_resume() const noexcept {}
+
+            static bool isReady(void* context) noexcept {
+                return (*static_cast<Predicate const*>(context))();
+            }
+        };
+
+        // Meyers' Singleton basic constructor settings
+        static Executor& getInstance() noexcept {
+            static Executor executor;
+            return executor;
+        }
+        Executor(Executor const&) = delete;
+        Executor& operator=(Executor const&) = delete;
+
+        // Add a coroutine, it starts once the executor task runs
+        // ! This must be done before createTask !
+        bool spawn(Task&& task) noexcept;
+
+        // Create the executor task
+        // ! This must be done once before running !
+        bool createTask(UBaseType_t const& priority) noexcept;
+
+        // Re-evaluate the waiting coroutines, from another task or from an interrupt
+        void notify() noexcept;
+        void notifyFromIsr(BaseType_t* higher_priority_task_woken) noexcept;
+
+        SleepAwaiter sleepFor(TickType_t const& ticks) const noexcept {
+            return SleepAwaiter{ ticks };
+        }
+
+        template<typename Predicate>
+        WaitAwaiter<Predicate> waitUntil(Predicate predicate) const noexcept {
+            return WaitAwaiter<Predicate>{ predicate };
+        }
+
+        // Frame storage for Task::promise_type, nullptr once the arena is exhausted
+        void* allocateFrame(std::size_t const& size) noexcept;
+
+        std::size_t getFrameArenaUsage() const noexcept {
+            return this->frame_arena_used;
+        }
+
+    private:
+        Executor() noexcept;
+
+        struct Slot {
+            std::coroutine_handle<> handle{};
+            // Resumed once "ready" returns true, or once "wait_ticks" have passed since "wait_start"
+            bool        (*ready)(void* context) = nullptr;
+            void*       ready_context = nullptr;
+            TickType_t  wait_start = 0;
+            TickType_t  wait_ticks = 0;
+        };
+
+        // Record what the running coroutine waits for
+        void park(bool (*ready)(void* context), void* ready_context, TickType_t const& wait_ticks) noexcept;
+
+        std::array<Slot, kMaxCoroutines> slots{};
+        std::size_t slot_count = 0;
+        std::size_t running_slot = 0;
+
+        alignas(std::max_align_t) std::array<std::byte, kFrameArenaSize> frame_arena{};
+        std::size_t frame_arena_used = 0;
+
+        // FreeRTOS task
+        std::array<StackType_t, kStackDepth> task_stack{};
+        StaticTask_t task_buffer{};
+        TaskHandle_t task_handle{nullptr};
+        void taskLoop() noexcept;
+};
+
+inline void* Task::promise_type::operator new(std::size_t size) noexcept {
+    return Executor::getInstance().allocateFrame(size);
+}
+
+} // namespace bps::coro
+
+#endif // BPS_CORO_EXECUTOR_HPP
\ No newline at end of file
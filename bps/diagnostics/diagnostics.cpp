@@ -0,0 +1,74 @@
+#include "diagnostics.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+
+#include "utils.hpp"
+
+namespace bps::diagnostics {
+
+Diagnostics::Diagnostics() noexcept {}
+
+Diagnostics::Snapshot Diagnostics::getSnapshot() const noexcept {
+    Snapshot snapshot{};
+    std::size_t offset = 0;
+
+    writeAsLittleEndian(this->sequenced.load(std::memory_order_relaxed), &snapshot[offset]);
+    offset += sizeof(std::uint32_t);
+
+    writeAsLittleEndian(this->notified.load(std::memory_order_relaxed), &snapshot[offset]);
+    offset += sizeof(std::uint32_t);
+
+    for (auto const& drop : this->drops) {
+        writeAsLittleEndian(drop.load(std::memory_order_relaxed), &snapshot[offset]);
+        offset += sizeof(std::uint32_t);
+    }
+
+    writeAsLittleEndian(this->executor_wakeups.load(std::memory_order_relaxed), &snapshot[offset]);
+    offset += sizeof(std::uint32_t);
+
+    writeAsLittleEndian(this->resumptions.load(std::memory_order_relaxed), &snapshot[offset]);
+    offset += sizeof(std::uint32_t);
+
+    writeAsLittleEndian(this->frame_arena_bytes.load(std::memory_order_relaxed), &snapshot[offset]);
+    offset += sizeof(std::uint16_t);
+
+    writeAsLittleEndian(this->stack_headroom.load(std::memory_order_relaxed), &snapshot[offset]);
+    offset += sizeof(std::uint16_t);
+
+    writeAsLittleEndian(this->emergency_stops.load(std::memory_order_relaxed), &snapshot[offset]);
+    offset += sizeof(std::uint32_t);
+
+    writeAsLittleEndian(this->emergency_stop_latency_us.load(std::memory_order_relaxed), &snapshot[offset]);
+    offset += sizeof(std::uint32_t);
+
+    writeAsLittleEndian(this->withheld.load(std::memory_order_relaxed), &snapshot[offset]);
+    offset += sizeof(std::uint32_t);
+
+    for (auto const& settle_ms : this->time_to_stable_ms) {
+        writeAsLittleEndian(settle_ms.load(std::memory_order_relaxed), &snapshot[offset]);
+        offset += sizeof(std::uint16_t);
+    }
+
+    writeAsLittleEndian(this->control_input_age_ms.load(std::memory_order_relaxed), &snapshot[offset]);
+    offset += sizeof(std::uint16_t);
+
+    writeAsLittleEndian(this->stale_control_inputs.load(std::memory_order_relaxed), &snapshot[offset]);
+    offset += sizeof(std::uint32_t);
+
+    for (auto const& leak_rate : this->leak_rate_pa_s) {
+        writeAsLittleEndian(leak_rate.load(std::memory_order_relaxed), &snapshot[offset]);
+        offset += sizeof(std::uint16_t);
+    }
+
+    writeAsLittleEndian(this->oversized_analysis_records.load(std::memory_order_relaxed), &snapshot[offset]);
+    offset += sizeof(std::uint32_t);
+
+    writeAsLittleEndian(this->analysis_drops.load(std::memory_order_relaxed), &snapshot[offset]);
+    offset += sizeof(std::uint32_t);
+
+    return snapshot;
+}
+
+} // namespace bps::diagnostics
\ No newline at end of file
@@ -0,0 +1,182 @@
+#ifndef BPS_DIAGNOSTICS_HPP
+#define BPS_DIAGNOSTICS_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+#include <limits>
+
+namespace bps::diagnostics {
+
+// Stages a streamed sample goes through, each one counts the samples it drops
+enum class Stage : std::uint8_t {
+    // The pressure sensors could not be read
+    eAcquisition  = 0x00,
+    // The sampler could not queue the sample to the BLE service
+    eSamplerQueue = 0x01,
+    // The BLE service dequeued the sample while no client was subscribed
+    eBleQueue     = 0x02,
+    // The sample was overwritten before it could be notified, or the notify failed
+    eNotify       = 0x03,
+    eCount
+};
+
+// Meyers' Singleton Implementation
+//
+// Lock-free counters, safe to update from any task or from the BTstack context.
+//
+// Snapshot layout (little endian):
+//   0  u32  sequenced samples
+//   4  u32  notified samples
+//   8  u32  acquisition drops
+//   12 u32  sampler queue drops
+//   16 u32  BLE queue drops
+//   20 u32  notify drops
+//   24 u32  executor wakeups, times the coroutine executor task was switched back in
+//   28 u32  coroutine resumptions
+//   32 u16  coroutine frame arena bytes in use
+//   34 u16  executor stack headroom, in words
+//   36 u32  emergency stops
+//   40 u32  worst emergency stop latency, from the ATT write to the outputs cut, in us
+//   44 u32  withheld samples, recorded but kept off the stream on purpose (template mode, quality gating)
+//   48 u16  last time to stable of the Cun controller, from the target to the settled pressure, in ms
+//   50 u16  same for Guan
+//   52 u16  same for Chi
+//   54 u16  worst age of a control input when it was taken, in ms
+//   56 u32  stale control inputs, too old to be acted on
+//   60 u16  leak rate of the Cun cuff at its last held pressure, in Pa/s
+//   62 u16  same for Guan
+//   64 u16  same for Chi
+//   66 u32  analysis records larger than a notification at the current ATT MTU, dropped
+//   70 u32  analysis records dropped because the pending notification was full
+class Diagnostics {
+    public:
+        static constexpr std::size_t kNumStages    = std::to_underlying(Stage::eCount);
+        static constexpr std::size_t kNumChannels  = 3;
+        static constexpr std::size_t kSnapshotSize =
+            (10 + kNumStages) * sizeof(std::uint32_t) + (3 + 2 * kNumChannels) * sizeof(std::uint16_t);
+
+        using Snapshot = std::array<std::byte, kSnapshotSize>;
+
+        // Meyers' Singleton basic constructor settings
+        static Diagnostics& getInstance() noexcept {
+            static Diagnostics diagnostics;
+            return diagnostics;
+        }
+        Diagnostics(Diagnostics const&) = delete;
+        Diagnostics& operator=(Diagnostics const&) = delete;
+
+        void countSequenced() noexcept {
+            this->sequenced.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void countNotified(std::uint32_t const& count = 1) noexcept {
+            this->notified.fetch_add(count, std::memory_order_relaxed);
+        }
+
+        void countDrop(Stage const& stage, std::uint32_t const& count = 1) noexcept {
+            this->drops[std::to_underlying(stage)].fetch_add(count, std::memory_order_relaxed);
+        }
+
+        // Not a drop, the sample is in the record and the client asked for it not to be streamed
+        void countWithheld(std::uint32_t const& count = 1) noexcept {
+            this->withheld.fetch_add(count, std::memory_order_relaxed);
+        }
+
+        std::uint32_t getDrops(Stage const& stage) const noexcept {
+            return this->drops[std::to_underlying(stage)].load(std::memory_order_relaxed);
+        }
+
+        void countExecutorWakeup() noexcept {
+            this->executor_wakeups.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void countResume() noexcept {
+            this->resumptions.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void setExecutorMemory(std::size_t const& frame_arena_used, std::size_t const& stack_headroom_words) noexcept {
+            this->frame_arena_bytes.store(static_cast<std::uint16_t>(frame_arena_used), std::memory_order_relaxed);
+            this->stack_headroom.store(static_cast<std::uint16_t>(stack_headroom_words), std::memory_order_relaxed);
+        }
+
+        void countEmergencyStop(std::uint32_t const& latency_us) noexcept {
+            this->emergency_stops.fetch_add(1, std::memory_order_relaxed);
+            std::uint32_t worst = this->emergency_stop_latency_us.load(std::memory_order_relaxed);
+            while (latency_us > worst &&
+                   !this->emergency_stop_latency_us.compare_exchange_weak(worst, latency_us, std::memory_order_relaxed)) {}
+        }
+
+        // "channel" in the Cun, Guan, Chi order, saturated to 65535 ms
+        void setTimeToStable(std::size_t const& channel, std::uint32_t const& settle_ms) noexcept {
+            if (channel < kNumChannels) {
+                this->time_to_stable_ms[channel].store(
+                    static_cast<std::uint16_t>(std::min<std::uint32_t>(settle_ms, std::numeric_limits<std::uint16_t>::max())),
+                    std::memory_order_relaxed
+                );
+            }
+        }
+
+        // "channel" in the Cun, Guan, Chi order, saturated to 65535 Pa/s
+        void setLeakRate(std::size_t const& channel, std::uint32_t const& leak_pa_s) noexcept {
+            if (channel < kNumChannels) {
+                this->leak_rate_pa_s[channel].store(
+                    static_cast<std::uint16_t>(std::min<std::uint32_t>(leak_pa_s, std::numeric_limits<std::uint16_t>::max())),
+                    std::memory_order_relaxed
+                );
+            }
+        }
+
+        // Age of the control input taken by the control coroutine, "stale" when it was not acted on
+        void countControlInput(std::uint32_t const& age_ms, bool const& stale) noexcept {
+            auto const age = static_cast<std::uint16_t>(std::min<std::uint32_t>(age_ms, std::numeric_limits<std::uint16_t>::max()));
+            std::uint16_t worst = this->control_input_age_ms.load(std::memory_order_relaxed);
+            while (age > worst &&
+                   !this->control_input_age_ms.compare_exchange_weak(worst, age, std::memory_order_relaxed)) {}
+            if (stale) {
+                this->stale_control_inputs.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        // An analysis record the link could not carry, "oversized" when it never fits a notification
+        void countAnalysisDrop(bool const& oversized) noexcept {
+            (oversized ? this->oversized_analysis_records : this->analysis_drops).fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Serialize every counter
+        Snapshot getSnapshot() const noexcept;
+
+    private:
+        Diagnostics() noexcept;
+
+        std::atomic<std::uint32_t> sequenced{0};
+        std::atomic<std::uint32_t> notified{0};
+        std::array<std::atomic<std::uint32_t>, kNumStages> drops{};
+
+        std::atomic<std::uint32_t> executor_wakeups{0};
+        std::atomic<std::uint32_t> resumptions{0};
+        std::atomic<std::uint16_t> frame_arena_bytes{0};
+        std::atomic<std::uint16_t> stack_headroom{0};
+
+        std::atomic<std::uint32_t> emergency_stops{0};
+        std::atomic<std::uint32_t> emergency_stop_latency_us{0};
+
+        std::atomic<std::uint32_t> withheld{0};
+
+        std::array<std::atomic<std::uint16_t>, kNumChannels> time_to_stable_ms{};
+
+        std::atomic<std::uint16_t> control_input_age_ms{0};
+        std::atomic<std::uint32_t> stale_control_inputs{0};
+
+        std::array<std::atomic<std::uint16_t>, kNumChannels> leak_rate_pa_s{};
+
+        std::atomic<std::uint32_t> oversized_analysis_records{0};
+        std::atomic<std::uint32_t> analysis_drops{0};
+};
+
+} // namespace bps::diagnostics
+
+#endif // BPS_DIAGNOSTICS_HPP
\ No newline at end of file
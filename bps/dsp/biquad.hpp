@@ -0,0 +1,163 @@
+#ifndef BPS_DSP_BIQUAD_HPP
+#define BPS_DSP_BIQUAD_HPP
+
+#if defined(__ARM_FEATURE_DSP)
+#include <arm_acle.h>
+#endif
+
+#include <cstdint>
+#include <algorithm>
+
+#include "trigonometry.hpp"
+
+namespace bps::dsp {
+
+// --- Fixed point formats ---
+// Samples are pressures in 1/64 Pa (the LSB of the XGZP6857D), saturated to 28 bits.
+// Coefficients are Q2.30, the products are accumulated on 64 bits.
+//
+// With |coefficient| < 2^31 and |sample| < 2^27 the five products stay below 2^61,
+// so the accumulator shifted back by 30 bits always fits 32 bits. Both kernels below
+// rely on it and give bit-exact results, checked on the host by tests/dsp_test.cpp.
+inline constexpr int          kCoefficientFractionBits = 30;
+inline constexpr int          kSampleBits              = 28;
+inline constexpr std::int32_t kSampleMax               = (std::int32_t{1} << (kSampleBits - 1)) - 1;
+inline constexpr std::int32_t kSampleMin               = -(std::int32_t{1} << (kSampleBits - 1));
+inline constexpr double       kSamplesPerPa            = 64.0;
+
+constexpr std::int32_t toQ30(double const value) noexcept {
+    double const scaled = value * static_cast<double>(std::int64_t{1} << kCoefficientFractionBits);
+    return static_cast<std::int32_t>(scaled >= 0.0 ? scaled + 0.5 : scaled - 0.5);
+}
+
+enum class BiquadType : std::uint8_t {
+    eBypass,
+    eLowPass,
+    eHighPass,
+    eNotch
+};
+
+// Direct form I: y = b0 x + b1 x[-1] + b2 x[-2] - a1 y[-1] - a2 y[-2], normalised by a0
+struct BiquadCoefficients {
+    std::int32_t b0;
+    std::int32_t b1;
+    std::int32_t b2;
+    std::int32_t a1;
+    std::int32_t a2;
+    // Gain at DC, used to start from the settled state
+    std::int32_t dc_gain;
+};
+
+inline constexpr BiquadCoefficients kBypassBiquad{
+    .b0 = toQ30(1.0), .b1 = 0, .b2 = 0, .a1 = 0, .a2 = 0, .dc_gain = toQ30(1.0)
+};
+
+// RBJ audio EQ cookbook design. A cutoff at or above Nyquist can't be realised and gives a bypass.
+constexpr BiquadCoefficients designBiquad(
+    BiquadType const type,
+    double const cutoff_hz,
+    double const q,
+    double const sample_rate_hz
+) noexcept {
+    if (type == BiquadType::eBypass || cutoff_hz <= 0.0 || cutoff_hz >= sample_rate_hz / 2.0) {
+        return kBypassBiquad;
+    }
+    double const w0    = 2.0 * kPi * cutoff_hz / sample_rate_hz;
+    double const cos0  = cosine(w0);
+    double const alpha = sine(w0) / (2.0 * q);
+
+    double b0 = 1.0;
+    double b1 = 0.0;
+    double b2 = 0.0;
+    switch (type) {
+    case BiquadType::eLowPass:
+        b0 = (1.0 - cos0) / 2.0;
+        b1 = 1.0 - cos0;
+        b2 = (1.0 - cos0) / 2.0;
+        break;
+    case BiquadType::eHighPass:
+        b0 = (1.0 + cos0) / 2.0;
+        b1 = -(1.0 + cos0);
+        b2 = (1.0 + cos0) / 2.0;
+        break;
+    case BiquadType::eNotch:
+        b0 = 1.0;
+        b1 = -2.0 * cos0;
+        b2 = 1.0;
+        break;
+    default:
+        break;
+    }
+    double const a0 = 1.0 + alpha;
+    double const a1 = -2.0 * cos0 / a0;
+    double const a2 = (1.0 - alpha) / a0;
+    b0 /= a0;
+    b1 /= a0;
+    b2 /= a0;
+
+    return BiquadCoefficients{
+        .b0      = toQ30(b0),
+        .b1      = toQ30(b1),
+        .b2      = toQ30(b2),
+        .a1      = toQ30(a1),
+        .a2      = toQ30(a2),
+        .dc_gain = toQ30((b0 + b1 + b2) / (1.0 + a1 + a2))
+    };
+}
+
+// One second order section, the coefficients are shared between channels
+class Biquad {
+    public:
+        // Start from the steady state of a constant "sample" input
+        void prime(BiquadCoefficients const& coefficients, std::int32_t const& sample) noexcept {
+            std::int64_t const output = (std::int64_t{coefficients.dc_gain} * sample) >> kCoefficientFractionBits;
+            this->x1 = sample;
+            this->x2 = sample;
+            this->y1 = saturate(output);
+            this->y2 = this->y1;
+            this->error = 0;
+        }
+
+        std::int32_t process(BiquadCoefficients const& coefficients, std::int32_t const& sample) noexcept {
+            // Fraction saving: the bits dropped by the last shift are added back, which
+            // cancels the quantisation error at DC. Plain rounding would be amplified by
+            // 1 / (1 + a1 + a2), thousands of LSB for the 0.5 Hz high-pass.
+            std::int64_t accumulator = this->error;
+            accumulator += std::int64_t{coefficients.b0} * sample;
+            accumulator += std::int64_t{coefficients.b1} * this->x1;
+            accumulator += std::int64_t{coefficients.b2} * this->x2;
+            accumulator -= std::int64_t{coefficients.a1} * this->y1;
+            accumulator -= std::int64_t{coefficients.a2} * this->y2;
+
+            std::int64_t const shifted = accumulator >> kCoefficientFractionBits;
+            this->error = static_cast<std::int32_t>(accumulator - (shifted << kCoefficientFractionBits));
+            std::int32_t const output = saturate(shifted);
+            this->x2 = this->x1;
+            this->x1 = sample;
+            this->y2 = this->y1;
+            this->y1 = output;
+            return output;
+        }
+
+        // Saturate to the 28-bit sample range, "value" always fits 32 bits (see above)
+        static std::int32_t saturate(std::int64_t const& value) noexcept {
+#if defined(__ARM_FEATURE_DSP)
+            return __ssat(static_cast<std::int32_t>(value), kSampleBits);
+#else
+            // Portable reference, bit-exact with the SSAT path
+            return static_cast<std::int32_t>(std::clamp<std::int64_t>(value, kSampleMin, kSampleMax));
+#endif
+        }
+
+    private:
+        std::int32_t x1 = 0;
+        std::int32_t x2 = 0;
+        std::int32_t y1 = 0;
+        std::int32_t y2 = 0;
+        // Fraction of the last output, below one LSB
+        std::int32_t error = 0;
+};
+
+} // namespace bps::dsp
+
+#endif // BPS_DSP_BIQUAD_HPP
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include "filter_bank.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+
+namespace bps::dsp {
+
+void FilterBank::configure(AcquisitionConfig const& config) noexcept {
+    this->channel_sections = config.filter_sections;
+    this->mains_hz = config.mains_hz;
+    if (config.conversion_wait_ms >= kMinFilteredPeriodMs && config.conversion_wait_ms <= kMaxFilteredPeriodMs) {
+        setSampleInterval(std::uint32_t{config.conversion_wait_ms} * 1000);
+    } else {
+        // Not supported, leave the samples untouched
+        this->channel_sections = {};
+    }
+    reset();
+}
+
+void FilterBank::setSampleInterval(std::uint32_t const& interval_us) noexcept {
+    if (interval_us == 0) {
+        return;
+    }
+    double const sample_rate_hz = 1.0e6 / static_cast<double>(interval_us);
+    this->coefficients = {
+        designBiquad(BiquadType::eLowPass, kLowPassHz, kButterworthQ, sample_rate_hz),
+        designBiquad(BiquadType::eNotch, (this->mains_hz == 60) ? 60.0 : 50.0, kNotchQ, sample_rate_hz),
+        designBiquad(BiquadType::eHighPass, kHighPassHz, kButterworthQ, sample_rate_hz)
+    };
+    // The old state does not belong to the new coefficients
+    reset();
+}
+
+void FilterBank::reset() noexcept {
+    this->primed = false;
+}
+
+void FilterBank::process(PulseValue& value) noexcept {
+    value.cun  = filterChannel(0, value.cun);
+    value.guan = filterChannel(1, value.guan);
+    value.chi  = filterChannel(2, value.chi);
+    this->primed = true;
+}
+
+std::float32_t FilterBank::filterChannel(std::size_t const& channel, std::float32_t const& pressure) noexcept {
+    std::uint8_t const enabled = this->channel_sections[channel];
+    if (enabled == 0) {
+        return pressure;
+    }
+
+    std::int32_t sample = static_cast<std::int32_t>(std::clamp<long>(
+        std::lround(pressure * kSamplesPerPa),
+        kSampleMin,
+        kSampleMax
+    ));
+    for (std::size_t i = 0; i < kNumSections; ++i) {
+        if ((enabled & (1u << i)) == 0) {
+            continue;
+        }
+        if (!this->primed) {
+            this->sections[channel][i].prime(this->coefficients[i], sample);
+        }
+        sample = this->sections[channel][i].process(this->coefficients[i], sample);
+    }
+    return static_cast<std::float32_t>(sample / kSamplesPerPa);
+}
+
+} // namespace bps::dsp
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef BPS_DSP_FILTER_BANK_HPP
+#define BPS_DSP_FILTER_BANK_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+
+#include "common.hpp"
+#include "biquad.hpp"
+
+namespace bps::dsp {
+
+// Per channel biquad cascade applied to the streamed samples: a low-pass against
+// sensor noise, a mains notch, and a high-pass removing the cuff pressure baseline.
+//
+// The coefficients are designed for the measured sample interval, which is longer
+// than the conversion wait by the rest of the acquisition cycle. configure() starts
+// from the conversion wait, setSampleInterval() designs them again once the interval
+// is measured, and the cascade settles again on the next sample.
+class FilterBank {
+    public:
+        // Bits of AcquisitionConfig::filter_sections, applied in this order
+        static constexpr std::uint8_t kLowPass          = 1u << 0;
+        static constexpr std::uint8_t kMainsNotch       = 1u << 1;
+        static constexpr std::uint8_t kBaselineHighPass = 1u << 2;
+        static constexpr std::uint8_t kAllSections      = kLowPass | kMainsNotch | kBaselineHighPass;
+
+        static constexpr double kLowPassHz    = 20.0;
+        static constexpr double kHighPassHz   = 0.5;
+        static constexpr double kButterworthQ = 0.70710678118654752;
+        static constexpr double kNotchQ       = 5.0;
+
+        static constexpr std::uint16_t kMinFilteredPeriodMs = 2;
+        static constexpr std::uint16_t kMaxFilteredPeriodMs = 20;
+
+        // Whether the filters asked by "config" can be realised. The conversion wait is the
+        // shortest sample interval, a notch pushed past Nyquist by a longer one is bypassed.
+        static constexpr bool supports(AcquisitionConfig const& config) noexcept {
+            std::uint8_t const sections = config.filter_sections[0] | config.filter_sections[1] | config.filter_sections[2];
+            if (sections == 0) {
+                return true;
+            }
+            if ((sections & ~kAllSections) != 0 ||
+                config.conversion_wait_ms < kMinFilteredPeriodMs ||
+                config.conversion_wait_ms > kMaxFilteredPeriodMs) {
+                return false;
+            }
+            if ((sections & kMainsNotch) != 0) {
+                // The notch must stay below Nyquist
+                return (config.mains_hz == 50 || config.mains_hz == 60) &&
+                       2u * config.mains_hz * config.conversion_wait_ms < 1000u;
+            }
+            return true;
+        }
+
+        // Take the sections of a supported configuration, designed for its conversion wait
+        void configure(AcquisitionConfig const& config) noexcept;
+        // Design the sections for the measured interval between the samples
+        void setSampleInterval(std::uint32_t const& interval_us) noexcept;
+        // Start again from a settled state on the next sample
+        void reset() noexcept;
+        // Filter the enabled channels of "value" in place
+        void process(PulseValue& value) noexcept;
+
+    private:
+        static constexpr std::size_t kNumChannels = 3;
+        static constexpr std::size_t kNumSections = 3;
+
+        // Coefficients of the low-pass, notch and high-pass sections
+        std::array<BiquadCoefficients, kNumSections> coefficients{ kBypassBiquad, kBypassBiquad, kBypassBiquad };
+        std::array<std::uint8_t, kNumChannels> channel_sections{};
+        std::uint8_t mains_hz = 50;
+        std::array<std::array<Biquad, kNumSections>, kNumChannels> sections{};
+        bool primed = false;
+
+        std::float32_t filterChannel(std::size_t const& channel, std::float32_t const& pressure) noexcept;
+};
+
+} // namespace bps::dsp
+
+#endif // BPS_DSP_FILTER_BANK_HPP
\ No newline at end of file
@@ -0,0 +1,137 @@
+#ifndef BPS_DSP_REAL_FFT_HPP
+#define BPS_DSP_REAL_FFT_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <stdfloat>
+#include <utility>
+
+#include "trigonometry.hpp"
+
+namespace bps::dsp {
+
+// In-place FFT of kSize real samples, with the tables built at compile time.
+//
+// The samples are taken as kSize / 2 complex values (even samples real, odd ones
+// imaginary), transformed by an iterative radix-2 FFT, then split into the spectrum
+// of the real signal. Everything runs inside the caller's array, walking it and the
+// twiddle table forward, with no allocation.
+//
+// Output packing, X[k] the DFT of the samples:
+//   [0]          X[0], real
+//   [1]          X[kSize / 2], real
+//   [2k], [2k+1] real and imaginary parts of X[k], for 0 < k < kSize / 2
+template <std::size_t kSize>
+class RealFft {
+    static_assert(kSize >= 4 && (kSize & (kSize - 1)) == 0, "The size must be a power of two");
+
+    public:
+        using Buffer = std::array<std::float32_t, kSize>;
+
+        static void transform(Buffer& data) noexcept {
+            permute(data);
+            butterflies(data);
+            split(data);
+        }
+
+    private:
+        static constexpr std::size_t kComplexSize = kSize / 2;
+
+        // cos and sin of 2 pi j / kSize, for j < kSize / 2
+        struct Twiddles {
+            std::array<std::float32_t, kSize / 2> cos;
+            std::array<std::float32_t, kSize / 2> sin;
+        };
+        static constexpr Twiddles kTwiddles = [] {
+            Twiddles twiddles{};
+            for (std::size_t j = 0; j < kSize / 2; ++j) {
+                double const angle = 2.0 * kPi * static_cast<double>(j) / static_cast<double>(kSize);
+                twiddles.cos[j] = static_cast<std::float32_t>(cosine(angle));
+                twiddles.sin[j] = static_cast<std::float32_t>(sine(angle));
+            }
+            return twiddles;
+        }();
+
+        // Bit-reversed index of every complex value
+        static constexpr std::array<std::uint16_t, kComplexSize> kBitReversed = [] {
+            std::array<std::uint16_t, kComplexSize> table{};
+            std::size_t bits = 0;
+            while ((std::size_t{1} << bits) < kComplexSize) {
+                ++bits;
+            }
+            for (std::size_t i = 0; i < kComplexSize; ++i) {
+                std::size_t reversed = 0;
+                for (std::size_t b = 0; b < bits; ++b) {
+                    reversed |= ((i >> b) & 1u) << (bits - 1 - b);
+                }
+                table[i] = static_cast<std::uint16_t>(reversed);
+            }
+            return table;
+        }();
+
+        static void permute(Buffer& data) noexcept {
+            for (std::size_t i = 0; i < kComplexSize; ++i) {
+                std::size_t const j = kBitReversed[i];
+                if (i < j) {
+                    std::swap(data[2 * i],     data[2 * j]);
+                    std::swap(data[2 * i + 1], data[2 * j + 1]);
+                }
+            }
+        }
+
+        // Decimation in time, W = exp(-2 pi i k / size) is twiddle k * kSize / size
+        static void butterflies(Buffer& data) noexcept {
+            for (std::size_t size = 2; size <= kComplexSize; size *= 2) {
+                std::size_t const half   = size / 2;
+                std::size_t const stride = kSize / size;
+                for (std::size_t start = 0; start < kComplexSize; start += size) {
+                    for (std::size_t k = 0; k < half; ++k) {
+                        std::float32_t const w_re =  kTwiddles.cos[k * stride];
+                        std::float32_t const w_im = -kTwiddles.sin[k * stride];
+                        std::size_t const top    = 2 * (start + k);
+                        std::size_t const bottom = 2 * (start + k + half);
+                        std::float32_t const t_re = w_re * data[bottom] - w_im * data[bottom + 1];
+                        std::float32_t const t_im = w_re * data[bottom + 1] + w_im * data[bottom];
+                        data[bottom]     = data[top] - t_re;
+                        data[bottom + 1] = data[top + 1] - t_im;
+                        data[top]       += t_re;
+                        data[top + 1]   += t_im;
+                    }
+                }
+            }
+        }
+
+        // With Z the complex FFT and W = exp(-2 pi i k / kSize):
+        //   E = (Z[k] + conj(Z[M - k])) / 2,  O = -i (Z[k] - conj(Z[M - k])) / 2
+        //   X[k] = E + W O,  X[M - k] = conj(E - W O)
+        static void split(Buffer& data) noexcept {
+            std::float32_t const z0_re = data[0];
+            std::float32_t const z0_im = data[1];
+            data[0] = z0_re + z0_im;
+            data[1] = z0_re - z0_im;
+
+            for (std::size_t k = 1; k <= kComplexSize / 2; ++k) {
+                std::size_t const a = 2 * k;
+                std::size_t const b = 2 * (kComplexSize - k);
+                std::float32_t const e_re = 0.5f * (data[a] + data[b]);
+                std::float32_t const e_im = 0.5f * (data[a + 1] - data[b + 1]);
+                std::float32_t const o_re = 0.5f * (data[a + 1] + data[b + 1]);
+                std::float32_t const o_im = -0.5f * (data[a] - data[b]);
+                std::float32_t const w_re =  kTwiddles.cos[k];
+                std::float32_t const w_im = -kTwiddles.sin[k];
+                std::float32_t const wo_re = w_re * o_re - w_im * o_im;
+                std::float32_t const wo_im = w_re * o_im + w_im * o_re;
+                data[a]     = e_re + wo_re;
+                data[a + 1] = e_im + wo_im;
+                if (a != b) {
+                    data[b]     = e_re - wo_re;
+                    data[b + 1] = -(e_im - wo_im);
+                }
+            }
+        }
+};
+
+} // namespace bps::dsp
+
+#endif // BPS_DSP_REAL_FFT_HPP
\ No newline at end of file
@@ -0,0 +1,95 @@
+#ifndef BPS_DSP_SAMPLE_INTERVAL_HPP
+#define BPS_DSP_SAMPLE_INTERVAL_HPP
+
+#include <cstdint>
+
+namespace bps::dsp {
+
+// Interval between the streamed samples, measured on their timestamps.
+//
+// The configured conversion wait is only a floor: the acquisition cycle adds the
+// control work and the executor tick to it. The interval is taken over windows of
+// kWindowSamples samples, counted by sequence so that failed reads do not stretch
+// it, which keeps the tick jitter of single samples out of the estimate. A pair
+// further apart than kMaxGap intervals (a pause between sessions) starts a new window.
+class SampleInterval {
+    public:
+        static constexpr std::uint32_t kWindowSamples = 64;
+        static constexpr std::uint32_t kMaxGap        = 4;
+        // Relative change, in 1/1000, reported as a new interval
+        static constexpr std::uint32_t kTolerancePermille = 10;
+
+        // Forget the measurements, the interval is "nominal_us" until the first window closes
+        void reset(std::uint32_t const& nominal_us) noexcept {
+            this->interval_us = nominal_us;
+            this->applied_us  = nominal_us;
+            this->measured    = false;
+            this->anchored    = false;
+        }
+
+        // Take one sample, true once the interval has moved past the tolerance since the
+        // last time it was reported
+        bool update(std::uint64_t const& timestamp, std::uint32_t const& sequence) noexcept {
+            if (this->anchored && sequence != this->last_sequence && timestamp > this->last_timestamp) {
+                std::uint64_t const step = (timestamp - this->last_timestamp) / (sequence - this->last_sequence);
+                if (this->interval_us != 0 && step > std::uint64_t{kMaxGap} * this->interval_us) {
+                    this->anchored = false;
+                }
+            }
+            if (!this->anchored || sequence == this->anchor_sequence) {
+                anchor(timestamp, sequence);
+                return false;
+            }
+            this->last_timestamp = timestamp;
+            this->last_sequence  = sequence;
+            std::uint32_t const samples = sequence - this->anchor_sequence;
+            if (samples < kWindowSamples) {
+                return false;
+            }
+            auto const window_us = static_cast<std::uint32_t>((timestamp - this->anchor_timestamp) / samples);
+            // The first window replaces the nominal interval, the next ones are averaged in
+            this->interval_us = this->measured ? (3 * this->interval_us + window_us) / 4 : window_us;
+            this->measured = true;
+            anchor(timestamp, sequence);
+
+            std::uint32_t const difference = (this->interval_us > this->applied_us) ?
+                this->interval_us - this->applied_us : this->applied_us - this->interval_us;
+            if (std::uint64_t{difference} * 1000 <= std::uint64_t{kTolerancePermille} * this->applied_us) {
+                return false;
+            }
+            this->applied_us = this->interval_us;
+            return true;
+        }
+
+        // Last reported interval
+        std::uint32_t getIntervalUs() const noexcept {
+            return this->applied_us;
+        }
+
+        bool isMeasured() const noexcept {
+            return this->measured;
+        }
+
+    private:
+        std::uint32_t interval_us = 0;
+        std::uint32_t applied_us = 0;
+        bool          measured = false;
+
+        bool          anchored = false;
+        std::uint64_t anchor_timestamp = 0;
+        std::uint32_t anchor_sequence = 0;
+        std::uint64_t last_timestamp = 0;
+        std::uint32_t last_sequence = 0;
+
+        void anchor(std::uint64_t const& timestamp, std::uint32_t const& sequence) noexcept {
+            this->anchored         = true;
+            this->anchor_timestamp = timestamp;
+            this->anchor_sequence  = sequence;
+            this->last_timestamp   = timestamp;
+            this->last_sequence    = sequence;
+        }
+};
+
+} // namespace bps::dsp
+
+#endif // BPS_DSP_SAMPLE_INTERVAL_HPP
\ No newline at end of file
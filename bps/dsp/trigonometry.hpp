@@ -0,0 +1,31 @@
+#ifndef BPS_DSP_TRIGONOMETRY_HPP
+#define BPS_DSP_TRIGONOMETRY_HPP
+
+namespace bps::dsp {
+
+inline constexpr double kPi = 3.14159265358979323846;
+
+// std::sin and std::cos are not constexpr before C++26
+constexpr double sine(double x) noexcept {
+    while (x > kPi) {
+        x -= 2.0 * kPi;
+    }
+    while (x < -kPi) {
+        x += 2.0 * kPi;
+    }
+    double term = x;
+    double sum  = x;
+    for (int n = 1; n < 16; ++n) {
+        term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+        sum  += term;
+    }
+    return sum;
+}
+
+constexpr double cosine(double const x) noexcept {
+    return sine(x + kPi / 2.0);
+}
+
+} // namespace bps::dsp
+
+#endif // BPS_DSP_TRIGONOMETRY_HPP
\ No newline at end of file
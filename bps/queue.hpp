@@ -2,6 +2,7 @@
 #define BPS_QUEUE_HPP
 
 #include <FreeRTOS.h>
+#include <task.h>
 #include <queue.h>
 
 #include <cstddef>
@@ -115,12 +116,21 @@ class StaticQueue {
         QueueHandle_t queue_handle{nullptr};
 };
 
+template<typename T>
+class Mailbox;
+
+template<typename Q>
+inline constexpr bool kIsMailbox = false;
+template<typename T>
+inline constexpr bool kIsMailbox<Mailbox<T>> = true;
+
 template <typename T>
 class QueueReference {
     public:
         QueueReference() = default;
 
-        template<QueueType Q>
+        // A mailbox slot holds a stamped value, a reference would send bare ones
+        template<QueueType Q> requires (!kIsMailbox<Q>)
         QueueReference(Q const& queue) {
             this->queue_handle = queue.getFreeRTOSQueueHandle();
         }
@@ -185,6 +195,117 @@ class QueueReference {
 template <QueueType Q>
 QueueReference(Q const&) -> QueueReference<typename Q::ContentType>;
 
+// Single slot queue only keeping the newest value, for inputs where an older one is useless.
+//
+// send() replaces an unread value instead of failing, so the receiver never works through
+// a backlog. Every value is stamped with the tick it was sent at, which tells the receiver
+// how stale it is.
+template<typename T>
+class Mailbox {
+    public:
+        using ContentType = T;
+
+        struct Letter {
+            T          content;
+            TickType_t sent_tick;
+        };
+
+        // Constructor
+        Mailbox() noexcept {
+            this->queue_handle = xQueueCreateStatic(
+                1,
+                sizeof(Letter),
+                reinterpret_cast<uint8_t*>(buffer.data()),
+                &this->static_queue_cb
+            );
+            configASSERT(this->queue_handle != nullptr);
+        }
+
+        Mailbox(Mailbox const&) = delete;
+        Mailbox& operator=(Mailbox const&) = delete;
+        Mailbox(Mailbox&& other) = delete;
+        Mailbox& operator=(Mailbox&& other) = delete;
+
+        // --- API Methods ---
+
+        // Overwrite the slot, never waits
+        bool send(T const& object, [[maybe_unused]] TickType_t wait_tick) noexcept {
+            Letter const letter{ object, xTaskGetTickCount() };
+            if (
+                this->queue_handle == nullptr ||
+                xQueueOverwrite(
+                    this->queue_handle,
+                    reinterpret_cast<void const*>(&letter)
+                ) != pdPASS
+            ) return false;
+            return true;
+        }
+
+        bool sendFromIsr(T const& object, BaseType_t* higher_priority_task_to_woken) noexcept {
+            Letter const letter{ object, xTaskGetTickCountFromISR() };
+            if (
+                this->queue_handle == nullptr ||
+                xQueueOverwriteFromISR(
+                    this->queue_handle,
+                    reinterpret_cast<void const*>(&letter),
+                    higher_priority_task_to_woken
+                ) != pdPASS
+            ) return false;
+            return true;
+        }
+
+        // Receive the value with its stamp
+        bool receive(Letter& receive_buffer, TickType_t wait_tick) noexcept {
+            if (
+                this->queue_handle == nullptr ||
+                xQueueReceive(
+                    this->queue_handle,
+                    reinterpret_cast<void*>(&receive_buffer),
+                    wait_tick
+                ) != pdPASS
+            ) return false;
+            return true;
+        }
+
+        // Receive the value alone
+        bool receive(T& receive_buffer, TickType_t wait_tick) noexcept {
+            Letter letter{};
+            if (!receive(letter, wait_tick)) {
+                return false;
+            }
+            receive_buffer = letter.content;
+            return true;
+        }
+
+        // Ticks since "letter" was sent
+        static TickType_t ageOf(Letter const& letter) noexcept {
+            return xTaskGetTickCount() - letter.sent_tick;
+        }
+
+        // Get the raw FreeRTOS queue handle
+        QueueHandle_t getFreeRTOSQueueHandle() const noexcept {
+            return this->queue_handle;
+        }
+
+        // Helper to check if the mailbox was created successfully
+        bool isValid() const noexcept {
+            return this->queue_handle != nullptr;
+        }
+
+        static constexpr UBaseType_t length() {
+            return 1;
+        }
+
+        UBaseType_t size() const noexcept {
+            return uxQueueMessagesWaiting(this->queue_handle);
+        }
+
+    private:
+        std::array<std::byte, sizeof(Letter)> buffer{};
+        StaticQueue_t static_queue_cb{};
+        QueueHandle_t queue_handle{nullptr};
+};
+
 template<StaticQueueType... Qs>
 class StaticQueueSet {
         // The combined length of the all queues and that will be
@@ -0,0 +1,200 @@
+#include "recorder.hpp"
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <utility>
+
+#include "common.hpp"
+#include "utils.hpp"
+
+namespace bps::recorder {
+
+namespace {
+
+// Largest encoded size of one delta sample: a 32-bits varint and three 32-bits zigzag varints
+constexpr std::size_t kMaxDeltaSampleSize = 4 * 5;
+
+constexpr std::uint32_t zigzagEncode(std::int32_t const& value) noexcept {
+    return (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31);
+}
+
+// Write a LEB128 varint, return the number of written bytes
+std::size_t writeVarint(std::uint32_t value, std::byte* dest) noexcept {
+    std::size_t size = 0;
+    while (value >= 0x80) {
+        dest[size++] = std::byte((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    dest[size++] = std::byte(value);
+    return size;
+}
+
+std::int32_t toFixedPoint(std::float32_t const& pressure) noexcept {
+    return static_cast<std::int32_t>(std::lround(pressure * SampleRecorder::kValueScale));
+}
+
+} // anonymous namespace
+
+SampleRecorder::SampleRecorder() noexcept {}
+
+void SampleRecorder::record(PulseValue const& value) noexcept {
+    std::array<std::int32_t, 3> const values{
+        toFixedPoint(value.cun),
+        toFixedPoint(value.guan),
+        toFixedPoint(value.chi)
+    };
+
+    taskENTER_CRITICAL();
+    if (this->open_sample_count == 0) {
+        openBlock(value, values);
+    } else {
+        // Encode deltas into a scratch buffer first, so the block header is the only thing to patch
+        std::array<std::byte, kMaxDeltaSampleSize> encoded{};
+        std::size_t size = writeVarint(static_cast<std::uint32_t>(value.timestamp - this->prev_timestamp), &encoded[0]);
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            size += writeVarint(zigzagEncode(values[i] - this->prev_values[i]), &encoded[size]);
+        }
+
+        // A block holds consecutive sequences of a single sweep segment
+        if (this->open_used_bytes + size > kBlockSize ||
+            this->open_sample_count == std::numeric_limits<std::uint16_t>::max() ||
+            this->open_segment != value.segment ||
+            value.sequence != this->next_sequence) {
+            ++this->open_ordinal;
+            openBlock(value, values);
+        } else {
+            Block& block = this->blocks[this->open_ordinal % kNumBlocks];
+            std::copy_n(encoded.begin(), size, block.begin() + this->open_used_bytes);
+            this->open_used_bytes += size;
+            ++this->open_sample_count;
+            writeAsLittleEndian(this->open_sample_count, &block[4]);
+            writeAsLittleEndian(static_cast<std::uint16_t>(this->open_used_bytes), &block[6]);
+        }
+    }
+    this->prev_timestamp = value.timestamp;
+    this->prev_values = values;
+    this->next_sequence = value.sequence + 1;
+    taskEXIT_CRITICAL();
+}
+
+std::optional<std::uint32_t> SampleRecorder::readBlock(std::uint32_t const& sequence, Block& dest) const noexcept {
+    std::optional<std::uint32_t> ordinal{};
+
+    taskENTER_CRITICAL();
+    if (sequence < this->next_sequence) {
+        // Binary search the last block whose first sequence is not greater than "sequence"
+        // An empty open block still holds the content of the block it overwrites
+        std::uint32_t low  = oldestOrdinal();
+        std::uint32_t high = (this->open_sample_count == 0) ? (this->open_ordinal - 1) : this->open_ordinal;
+        while (low < high) {
+            std::uint32_t const middle = low + (high - low + 1) / 2;
+            if (getFirstSequence(this->blocks[middle % kNumBlocks]) <= sequence) {
+                low = middle;
+            } else {
+                high = middle - 1;
+            }
+        }
+        dest = this->blocks[low % kNumBlocks];
+        ordinal = low;
+    }
+    taskEXIT_CRITICAL();
+
+    return ordinal;
+}
+
+bool SampleRecorder::readBlockByOrdinal(std::uint32_t const& ordinal, Block& dest) const noexcept {
+    bool found = false;
+
+    taskENTER_CRITICAL();
+    if (ordinal >= oldestOrdinal() && ordinal < this->open_ordinal) {
+        dest = this->blocks[ordinal % kNumBlocks];
+        found = true;
+    }
+    taskEXIT_CRITICAL();
+
+    return found;
+}
+
+std::uint32_t SampleRecorder::sealBlock() noexcept {
+    taskENTER_CRITICAL();
+    if (this->open_sample_count != 0) {
+        ++this->open_ordinal;
+        this->open_sample_count = 0;
+    }
+    std::uint32_t const ordinal = this->open_ordinal;
+    taskEXIT_CRITICAL();
+
+    return ordinal;
+}
+
+std::uint32_t SampleRecorder::getOpenOrdinal() const noexcept {
+    taskENTER_CRITICAL();
+    std::uint32_t const ordinal = this->open_ordinal;
+    taskEXIT_CRITICAL();
+
+    return ordinal;
+}
+
+std::optional<SampleRecorder::Range> SampleRecorder::getRange() const noexcept {
+    std::optional<Range> range{};
+
+    taskENTER_CRITICAL();
+    if (this->next_sequence != 0) {
+        range = Range{
+            .first = getFirstSequence(this->blocks[oldestOrdinal() % kNumBlocks]),
+            .last  = this->next_sequence - 1
+        };
+    }
+    taskEXIT_CRITICAL();
+
+    return range;
+}
+
+std::uint32_t SampleRecorder::getFirstSequence(Block const& block) noexcept {
+    std::uint32_t sequence = 0;
+    readAsNativeEndian(&block[0], sequence);
+    return sequence;
+}
+
+std::uint16_t SampleRecorder::getSampleCount(Block const& block) noexcept {
+    std::uint16_t count = 0;
+    readAsNativeEndian(&block[4], count);
+    return count;
+}
+
+std::uint16_t SampleRecorder::getUsedBytes(Block const& block) noexcept {
+    std::uint16_t used_bytes = 0;
+    readAsNativeEndian(&block[6], used_bytes);
+    return used_bytes;
+}
+
+std::uint32_t SampleRecorder::oldestOrdinal() const noexcept {
+    // The open block overwrites the oldest one, so only "kNumBlocks - 1" complete blocks remain
+    return (this->open_ordinal >= kNumBlocks) ? (this->open_ordinal - kNumBlocks + 1) : 0;
+}
+
+void SampleRecorder::openBlock(PulseValue const& value, std::array<std::int32_t, 3> const& values) noexcept {
+    Block& block = this->blocks[this->open_ordinal % kNumBlocks];
+    this->open_sample_count = 1;
+    this->open_used_bytes   = kBlockHeaderSize;
+    this->open_segment      = value.segment;
+
+    writeAsLittleEndian(value.sequence, &block[0]);
+    writeAsLittleEndian(this->open_sample_count, &block[4]);
+    writeAsLittleEndian(static_cast<std::uint16_t>(this->open_used_bytes), &block[6]);
+    writeAsLittleEndian(value.timestamp, &block[8]);
+    writeAsLittleEndian(values[0], &block[16]);
+    writeAsLittleEndian(values[1], &block[20]);
+    writeAsLittleEndian(values[2], &block[24]);
+    block[28] = static_cast<std::byte>(std::to_underlying(value.segment));
+}
+
+} // namespace bps::recorder
\ No newline at end of file
@@ -0,0 +1,112 @@
+#ifndef BPS_RECORDER_HPP
+#define BPS_RECORDER_HPP
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <optional>
+
+#include "common.hpp"
+
+namespace bps::recorder {
+
+// Meyers' Singleton Implementation
+//
+// Keeps the most recent samples in a RAM ring of fixed-size, self-contained blocks.
+// Each block starts with absolute values and stores every following sample as
+// variable-length deltas, so a block can be decoded without any other block.
+//
+// Block layout (little endian):
+//   0  u32  sequence of the first sample in the block
+//   4  u16  number of samples in the block
+//   6  u16  number of used bytes, header included
+//   8  u64  timestamp of the first sample
+//   16 i32  Cun  of the first sample, in 1/kValueScale Pa
+//   20 i32  Guan of the first sample, in 1/kValueScale Pa
+//   24 i32  Chi  of the first sample, in 1/kValueScale Pa
+//   28 u8   sweep segment of every sample in the block
+//   29 ...  per following sample: varint timestamp delta, zigzag varint Cun/Guan/Chi deltas
+class SampleRecorder {
+    public:
+        // One block plus the 4-byte transfer header fits a 244-byte notification
+        static constexpr std::size_t kBlockSize       = 240;
+        static constexpr std::size_t kBlockHeaderSize = 29;
+        static constexpr std::size_t kCapacityBytes   = 128 * 1024;
+        static constexpr std::size_t kNumBlocks       = kCapacityBytes / kBlockSize;
+        // Pressure values are stored as fixed point integers of this resolution
+        static constexpr std::float32_t kValueScale   = 64.0f;
+
+        using Block = std::array<std::byte, kBlockSize>;
+
+        // Range of sequences that can currently be read back, [first, last]
+        struct Range {
+            std::uint32_t first = 0;
+            std::uint32_t last  = 0;
+        };
+
+        // Meyers' Singleton basic constructor settings
+        static SampleRecorder& getInstance() noexcept {
+            static SampleRecorder recorder;
+            return recorder;
+        }
+        SampleRecorder(SampleRecorder const&) = delete;
+        SampleRecorder& operator=(SampleRecorder const&) = delete;
+
+        // Append one sample, the oldest block is overwritten when the ring is full.
+        // Sequences must increase, a gap starts a new block.
+        // Only one task is allowed to record.
+        void record(PulseValue const& value) noexcept;
+
+        // Copy the block which contains the given sequence into "dest".
+        // If the sequence is older than the ring, the oldest block is copied instead.
+        // Return the ordinal of the copied block, or std::nullopt if the sequence
+        // has not been recorded yet.
+        std::optional<std::uint32_t> readBlock(std::uint32_t const& sequence, Block& dest) const noexcept;
+
+        // Copy a complete block by its ordinal into "dest".
+        // Return false if the block is still open or no longer held by the ring.
+        bool readBlockByOrdinal(std::uint32_t const& ordinal, Block& dest) const noexcept;
+
+        // Close the open block, the next sample starts a new one.
+        // Blocks before the returned ordinal are complete and won't change anymore.
+        std::uint32_t sealBlock() noexcept;
+
+        // Ordinal of the first block which is not complete yet
+        std::uint32_t getOpenOrdinal() const noexcept;
+
+        // Return the readable range, std::nullopt if nothing has been recorded
+        std::optional<Range> getRange() const noexcept;
+
+        // Helpers to read a block header
+        static std::uint32_t getFirstSequence(Block const& block) noexcept;
+        static std::uint16_t getSampleCount(Block const& block) noexcept;
+        static std::uint16_t getUsedBytes(Block const& block) noexcept;
+
+    private:
+        SampleRecorder() noexcept;
+
+        std::array<Block, kNumBlocks> blocks{};
+
+        // Ordinal of the block being filled, it increases monotonically
+        std::uint32_t open_ordinal = 0;
+        // Sequence following the last recorded sample
+        std::uint32_t next_sequence = 0;
+
+        // Encoder state of the open block, it is empty while "open_sample_count" is 0
+        std::size_t   open_used_bytes = 0;
+        std::uint16_t open_sample_count = 0;
+        PressureType  open_segment = PressureType::eNull;
+        std::uint64_t prev_timestamp = 0;
+        std::array<std::int32_t, 3> prev_values{};
+
+        // Return the oldest block ordinal still held by the ring
+        std::uint32_t oldestOrdinal() const noexcept;
+        void openBlock(PulseValue const& value, std::array<std::int32_t, 3> const& values) noexcept;
+};
+
+} // namespace bps::recorder
+
+#endif // BPS_RECORDER_HPP
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include "leak_estimator.hpp"
+
+#include <cstdint>
+#include <algorithm>
+
+namespace bps::sampler::pneumatic {
+
+void LeakEstimator::setPumpRate(std::float32_t const& rate) noexcept {
+    if (rate > 0.0f) {
+        this->pump_rate = rate;
+    }
+}
+
+std::float32_t LeakEstimator::getPumpRate() const noexcept {
+    return this->pump_rate;
+}
+
+void LeakEstimator::observeHold(std::float32_t const& pressure, std::float32_t const& duty, std::float32_t const& dt_s) noexcept {
+    this->pumping_s = 0.0f;
+    if (pressure < kMinPressure) {
+        this->in_window = false;
+        return;
+    }
+    if (!this->in_window) {
+        this->in_window = true;
+        this->window_start_pressure = pressure;
+        this->window_s = 0.0f;
+        this->window_duty_s = 0.0f;
+        this->window_pressure_s = 0.0f;
+        return;
+    }
+    this->window_s          += dt_s;
+    this->window_duty_s     += duty * dt_s;
+    this->window_pressure_s += pressure * dt_s;
+    if (this->window_s < kWindowS) {
+        return;
+    }
+    // pressure change = pump_rate * duty integral - leak_per_pa * pressure integral
+    std::float32_t const reading =
+        (this->pump_rate * this->window_duty_s - (pressure - this->window_start_pressure)) / this->window_pressure_s;
+    this->leak_per_pa = this->has_reading ? this->leak_per_pa + (reading - this->leak_per_pa) * kWindowWeight : reading;
+    this->has_reading = true;
+    // The next window starts where this one ends
+    this->window_start_pressure = pressure;
+    this->window_s = 0.0f;
+    this->window_duty_s = 0.0f;
+    this->window_pressure_s = 0.0f;
+}
+
+void LeakEstimator::observePumping(
+    std::float32_t const& pressure,
+    std::float32_t const& rate,
+    std::float32_t const& duty,
+    std::float32_t const& dt_s
+) noexcept {
+    this->in_window = false;
+    if (duty < kMinPumpingDuty) {
+        this->pumping_s = 0.0f;
+        return;
+    }
+    this->pumping_s += dt_s;
+    if (this->pumping_s < kMinPumpingS) {
+        return;
+    }
+    // The leak is known from the previous holds, without one it reads 0
+    std::float32_t const reading = (rate + getLeakRate(pressure)) / duty;
+    if (reading <= 0.0f) {
+        return;
+    }
+    std::float32_t const weight = std::min(dt_s / kTimeConstantS, 1.0f);
+    this->pump_rate += (reading - this->pump_rate) * weight;
+}
+
+std::float32_t LeakEstimator::getLeakRate(std::float32_t const& pressure) const noexcept {
+    return std::max(this->leak_per_pa, 0.0f) * pressure;
+}
+
+std::float32_t LeakEstimator::getFeedforward(std::float32_t const& pressure) const noexcept {
+    return std::clamp(getLeakRate(pressure) / this->pump_rate, 0.0f, kMaxFeedforward);
+}
+
+} // namespace bps::sampler::pneumatic
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef BPS_LEAK_ESTIMATOR_HPP
+#define BPS_LEAK_ESTIMATOR_HPP
+
+#include <cstdint>
+#include <stdfloat>
+
+#include "common.hpp"
+
+namespace bps::sampler::pneumatic {
+
+// Online leak model of one cuff, and the pump duty which cancels the leak.
+//
+// The leak is taken proportional to the pressure, a leak rate per Pa. While the channel
+// holds with the valve closed, the pressure moves at the pump rate times the duty minus
+// the leak. Over a window of a few pulses, the pressure change, the pump duty and the
+// pressure integrated over the window give one leak reading. Whole windows, rather than
+// samples, keep the pulse out of the reading: the pump duty follows the pulse, and a
+// per-sample reading would pick up that correlation as leak.
+//
+// The feedforward duty converges to the duty cancelling the leak even with a wrong pump
+// rate, since the pump rate cancels out of the fixed point; only the reported leak rate
+// scales with it. The pump rate is learnt while pumping hard, or taken from an auto-tune.
+class LeakEstimator {
+    public:
+        // A typical cuff pump at full duty, until a better one is known
+        static constexpr std::float32_t kDefaultPumpRate = 12000.0f;
+        // Length of a hold window, a couple of pulses at least
+        static constexpr std::float32_t kWindowS = 2.0f;
+        // Share of a new window reading in the estimate
+        static constexpr std::float32_t kWindowWeight = 0.3f;
+        // Averaging time of the pump rate readings
+        static constexpr std::float32_t kTimeConstantS = 2.0f;
+        // Below it the leak is too small to read
+        static constexpr std::float32_t kMinPressure = 2000.0_pa;
+        // Cap of the feedforward duty, a larger leak is left to the PI loop
+        static constexpr std::float32_t kMaxFeedforward = 0.5f;
+        // The pump rate is only read after this long at this duty, past the dead time
+        static constexpr std::float32_t kMinPumpingDuty = 0.5f;
+        static constexpr std::float32_t kMinPumpingS = 0.1f;
+
+        // Pressure rate at full duty, in Pa/s
+        void setPumpRate(std::float32_t const& rate) noexcept;
+        std::float32_t getPumpRate() const noexcept;
+
+        // One sample of a hold with the valve closed, "duty" drove the pump since the previous one
+        void observeHold(std::float32_t const& pressure, std::float32_t const& duty, std::float32_t const& dt_s) noexcept;
+        // One sample away from a hold, "duty" is 0 while venting. It ends the hold window.
+        void observePumping(std::float32_t const& pressure, std::float32_t const& rate,
+                            std::float32_t const& duty, std::float32_t const& dt_s) noexcept;
+
+        // Pressure lost per second at "pressure", in Pa/s
+        std::float32_t getLeakRate(std::float32_t const& pressure) const noexcept;
+        // Pump duty cancelling the leak at "pressure"
+        std::float32_t getFeedforward(std::float32_t const& pressure) const noexcept;
+
+    private:
+        // Leak rate per Pa, in 1/s
+        std::float32_t leak_per_pa = 0.0f;
+        bool           has_reading = false;
+        // Open hold window
+        bool           in_window = false;
+        std::float32_t window_start_pressure = 0.0_pa;
+        std::float32_t window_s = 0.0f;
+        // Integrals of the pump duty and of the pressure over the window
+        std::float32_t window_duty_s = 0.0f;
+        std::float32_t window_pressure_s = 0.0f;
+        std::float32_t pump_rate = kDefaultPumpRate;
+        // Time spent pumping at kMinPumpingDuty or more, in s
+        std::float32_t pumping_s = 0.0f;
+};
+
+} // namespace bps::sampler::pneumatic
+
+#endif // BPS_LEAK_ESTIMATOR_HPP
\ No newline at end of file
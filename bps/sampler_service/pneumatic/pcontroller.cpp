@@ -1,7 +1,6 @@
 #include "pcontroller.hpp"
 
 #include <FreeRTOS.h>
-#include <semphr.h>
 
 #include <pico/stdlib.h>
 #include <hardware/pwm.h>
@@ -11,19 +10,40 @@
 #include <stdfloat>
 #include <cstdint>
 #include <array>
-#include <cstring>
 #include <cstdio>
 
+#include "diagnostics.hpp"
 #include "logger.hpp"
 
 namespace bps::sampler::pneumatic {
 
-std::uint8_t PressureController::task_counter = 0;
+namespace {
 
-PressureController::PressureController(uint const& chan_a_gpio) noexcept: 
+// Estimate after "samples" readings, "period_us" apart, of a ramp at "rate" Pa/s from 1000 Pa
+constexpr PressureEstimator replayRamp(std::float32_t const& rate, std::uint64_t const& period_us,
+                                       std::uint32_t const& samples) noexcept {
+    PressureEstimator estimator{};
+    for (std::uint32_t i = 0; i < samples; ++i) {
+        std::float32_t const t_s = static_cast<std::float32_t>(i * period_us) / 1000000.0f;
+        estimator.update(1000.0_pa + rate * t_s, i * period_us);
+    }
+    return estimator;
+}
+
+// Quick checks wherever this file compiles: the estimator holds a constant pressure, and
+// locks on a ramp it starts on within 50 samples, at both ends of the sample intervals.
+// The pulse, the noise and the pump switching are replayed in tests/estimator_test.cpp.
+static_assert(replayRamp(0.0f, 6000, 50).getPressure() == 1000.0_pa && replayRamp(0.0f, 6000, 50).getRate() == 0.0f);
+static_assert(std::abs(replayRamp(12000.0f, 6000, 50).getRate() - 12000.0f) < 120.0f);
+static_assert(std::abs(replayRamp(12000.0f, 10000, 50).getPressure() - (1000.0_pa + 12000.0f * 0.49f)) < 5.0_pa);
+static_assert(std::abs(replayRamp(-20000.0f, 6000, 50).predict(0.006f) - (1000.0_pa - 20000.0f * 0.3f)) < 10.0_pa);
+
+} // anonymous namespace
+
+PressureController::PressureController(std::uint8_t const& channel_index, uint const& chan_a_gpio) noexcept: 
     pump_gpio_pin(chan_a_gpio),
     valve_gpio_pin(chan_a_gpio + 1),
-    task_id(task_counter++)
+    channel(channel_index)
 {}
 
 void PressureController::initialize() noexcept {
@@ -38,154 +58,300 @@ void PressureController::initialize() noexcept {
     // Set the wrap, which tweak the maximum frequency to 1kHz
     pwm_set_wrap(this->slice_num, kPwmMaxWrap);
     // Set pwm level to 0 (no output)
-    setPumpPwmPercentage(0.0f);
-    setValvePwmPercentage(0.0f);
+    setPumpPwmPercentage(0.0f).setValvePwmPercentage(0.0f).apply();
     // Set pwm running
     pwm_set_enabled(this->slice_num, true);
+    // Add the channel as the suffix of the controller name.
+    // Use this weird method so no dynamic resource allocation
+    snprintf(this->name.data(), this->name.size(), "PressureController-%d", this->channel);
 }
 
-void PressureController::createTask(UBaseType_t const& priority) noexcept {
-    this->valve_done_sem = xSemaphoreCreateBinaryStatic(&this->valve_sem_buffer);
-    static auto freertos_task = 
-        [](void* context) {
-            PressureController* controller = static_cast<PressureController*>(context);
-            controller->taskLoop();
-        };
-    // Add task id as the suffix of created task.
-    // Use this weird method so no dynamic resource allocation
-    snprintf(this->task_name.data(), this->task_name.size(), "PressureController-%d", this->task_id);
-    xTaskCreate(
-        freertos_task,
-        this->task_name.data(),
-        2048,
-        this,
-        priority,
-        &this->task_handle
-    );
+void PressureController::setTarget(std::float32_t const& pressure) noexcept {
+    if (pressure == 0.0_pa) {
+        // Releasing is what the stop asked for, the outputs may be driven again
+        this->emergency_stopped.store(false);
+    }
+    restart(pressure);
 }
 
-QueueReference<PressureController::TriggerPack> PressureController::getTriggerPackQueueRef() const noexcept {
-    return this->trigger_pack_queue;
+void PressureController::setProfile(SetpointProfile const& profile) noexcept {
+    if (profile.count == 0) {
+        return;
+    }
+    restart(profile.segments[profile.count - 1].pressure);
+    this->trajectory.start(profile);
+}
+
+void PressureController::restart(std::float32_t const& pressure) noexcept {
+    this->target_pressure = pressure;
+    this->trajectory.stop();
+    if (this->tuning) {
+        this->tuning = false;
+        this->tuner.stop();
+    }
+    this->is_stable = false;
+    this->holding = false;
+    this->feedforward = this->leak.getFeedforward(pressure);
+    this->estimator.reset();
+    this->integral = 0.0f;
+    this->has_last_timestamp = false;
+    this->in_band = false;
+    this->target_us = time_us_64();
+}
+
+void PressureController::startTuning(RelayTuner::Settings const& settings) noexcept {
+    setTarget(settings.setpoint);
+    this->tuning = true;
+    this->tuner.start(settings, this->gains, time_us_64());
+    BPS_LOG("%s tuning around %d Pa\n", this->name.data(), static_cast<int>(settings.setpoint));
+}
+
+void PressureController::setGains(ControlGains const& control_gains) noexcept {
+    this->gains = control_gains;
+}
+
+ControlGains const& PressureController::getGains() const noexcept {
+    return this->gains;
+}
+
+RelayTuner const& PressureController::getTuner() const noexcept {
+    return this->tuner;
+}
+
+LeakEstimator const& PressureController::getLeakEstimator() const noexcept {
+    return this->leak;
+}
+
+bool PressureController::isStable() const noexcept {
+    return this->is_stable;
+}
+
+void PressureController::update(TriggerPack const& trigger_pack) noexcept {
+    this->vent_us = 0;
+    // A vent pulse in progress does not stop the loop, apply() re-times it from the new output
+    if (this->is_stable && !this->holding) {
+        return;
+    }
+    controlPressure(trigger_pack);
+}
+
+void PressureController::apply() noexcept {
+    // Take back the pulse in progress, the new outputs decide whether the valve stays open
+    if (this->venting.load() && !cancel_alarm(this->vent_alarm)) {
+        // The alarm is closing the valve right now
+        while (this->venting.load()) {
+            tight_loop_contents();
+        }
+    }
+    this->venting.store(false);
+    if (this->hold_alarm > 0) {
+        // An alarm already firing only stops the pump one cycle early
+        cancel_alarm(this->hold_alarm);
+        this->hold_alarm = 0;
+    }
+    setChannelLevels(toPwmLevel(this->pump_pwm_level_percentage), toPwmLevel(this->valve_pwm_level_percentage));
+    if (this->holding && this->pump_pwm_level_percentage > 0.0f) {
+        // Alarm callback which stops the held pump once the samples stop coming
+        static auto hold_alarm_callback = []([[maybe_unused]]alarm_id_t id, void* user_data) -> int64_t {
+            PressureController* self = reinterpret_cast<PressureController*>(user_data);
+            self->setChannelLevels(0, toPwmLevel(self->valve_pwm_level_percentage));
+            return 0;
+        };
+        this->hold_alarm = add_alarm_in_us(kHoldTimeoutUs, hold_alarm_callback, this, true);
+        if (this->hold_alarm <= 0) {
+            // No alarm slot, never leave the pump unattended
+            hold_alarm_callback(0, this);
+            this->hold_alarm = 0;
+        }
+    }
+    if (this->vent_us == 0) {
+        return;
+    }
+    // Alarm callback which closes the valve after "vent_us" us
+    static auto valve_alarm_callback = []([[maybe_unused]]alarm_id_t id, void* user_data) -> int64_t {
+        PressureController* self = reinterpret_cast<PressureController*>(user_data);
+        self->valve_pwm_level_percentage = 1.0f;
+        self->setChannelLevels(toPwmLevel(self->pump_pwm_level_percentage), kPwmMaxWrap);
+        self->venting.store(false);
+        return 0;
+    };
+    // Set first, a short pulse may end before add_alarm_in_us returns
+    this->venting.store(true);
+    this->vent_alarm = add_alarm_in_us(this->vent_us, valve_alarm_callback, this, true);
+    if (this->vent_alarm <= 0) {
+        // No alarm slot, close the valve now rather than leave it open
+        valve_alarm_callback(0, this);
+    }
 }
 
-QueueReference<std::float32_t> PressureController::getTargetPressureQueueRef() const noexcept {
-    return this->target_pressure_queue;
+void PressureController::emergencyStop() noexcept {
+    this->emergency_stopped.store(true);
+    pwm_set_both_levels(this->slice_num, 0, 0);
 }
 
+void PressureController::setChannelLevels(std::uint16_t const& pump_level, std::uint16_t const& valve_level) noexcept {
+    if (this->emergency_stopped.load()) {
+        return;
+    }
+    pwm_set_both_levels(this->slice_num, pump_level, valve_level);
+    // A stop latched during the write above may have been overwritten
+    if (this->emergency_stopped.load()) {
+        pwm_set_both_levels(this->slice_num, 0, 0);
+    }
+}
 
-void PressureController::registerIsStableQueue(QueueReference<bool> const& queue) noexcept {
-    this->output_is_stable_queue_ref = queue;
+std::uint16_t PressureController::toPwmLevel(float const& percentage) noexcept {
+    return static_cast<std::uint16_t>(std::clamp(percentage, 0.0f, 1.0f) * kPwmMaxWrap);
 }
 
 PressureController& PressureController::setValvePwmPercentage(float const& percentage) noexcept {
     this->valve_pwm_level_percentage = percentage;
-    std::uint16_t level = std::clamp(
-                            static_cast<std::uint16_t>(percentage * kPwmMaxWrap),
-                            static_cast<std::uint16_t>(0),
-                            kPwmMaxWrap
-                          );
-    pwm_set_chan_level(this->slice_num, kPwmChanValve, level);
-
     return *this;
 }
 
 PressureController& PressureController::setPumpPwmPercentage(float const& percentage) noexcept {
     this->pump_pwm_level_percentage = percentage;
-    std::uint16_t level = std::clamp(
-                            static_cast<std::uint16_t>(percentage * kPwmMaxWrap),
-                            static_cast<std::uint16_t>(0),
-                            kPwmMaxWrap
-                          );
-    pwm_set_chan_level(this->slice_num, kPwmChanPump, level);
-
     return *this;
 }
 
-void PressureController::controlPressure(std::float32_t const& current_pressure) noexcept {
-    if (current_pressure > 90000.0_pa) {
+void PressureController::controlPressure(TriggerPack const& trigger_pack) noexcept {
+    std::float32_t const& current_pressure = trigger_pack.current_pressure;
+    if (current_pressure > kMaxPressure) {
         this->setPumpPwmPercentage(0.0f).setValvePwmPercentage(0.0f);
         return;
     }
     
-    // Signal Processing (Exponential Moving Average)
-    if (this->is_first_filtering) {
-        this->prev_pressure = current_pressure;
-        this->is_first_filtering = false;
+    // Outputs of the previous cycle, what moved the pressure up to this sample
+    std::float32_t const previous_duty = this->pump_pwm_level_percentage;
+    bool const valve_was_closed = this->valve_pwm_level_percentage >= 1.0f && !this->venting.load();
+
+    this->estimator.update(current_pressure, trigger_pack.timestamp);
+    std::float32_t const estimated_pressure = this->estimator.getPressure();
+
+    if (this->tuning) {
+        std::float32_t const relay_output = this->tuner.update(estimated_pressure, trigger_pack.timestamp);
+        if (this->tuner.getState() == RelayTuner::State::eRunning) {
+            drive(relay_output);
+            steerEstimator(previous_duty, valve_was_closed);
+            return;
+        }
+        // Hold until the sampler takes the result and releases the channel
+        if (auto const result = this->tuner.getResult()) {
+            this->leak.setPumpRate(result.value().pump_rate);
+        }
+        this->tuning = false;
+        setValvePwmPercentage(1.0f);
+        setPumpPwmPercentage(0.0f);
+        setStatusToStable();
+        return;
     }
-    std::float32_t filtered_value = kEmaAlpha * current_pressure + (1 - kEmaAlpha) * prev_pressure;
-    
-    // Control
-    std::float32_t error = filtered_value - this->target_pressure;
-    if (this->target_pressure == 0.0f) {
-        this->is_stable = true;
+
+    // Follow the profile in progress, if any
+    std::float32_t const setpoint = this->trajectory.isActive() ?
+        this->trajectory.sample(estimated_pressure, trigger_pack.timestamp) : this->target_pressure;
+    bool const following = this->trajectory.isActive();
+
+    if (setpoint == 0.0_pa && !following) {
         setValvePwmPercentage(0.0f);
         setPumpPwmPercentage(0.0f);
         setStatusToStable();
-    } else if (error >= 500 && error <= 1000) {
-        this->is_stable = true;
-        setValvePwmPercentage(1.0f);
-        setPumpPwmPercentage(0.0f);
+        return;
+    }
+
+    std::float32_t const dt_s = this->has_last_timestamp ?
+        static_cast<std::float32_t>(trigger_pack.timestamp - this->last_timestamp) / 1000000.0f : 0.0f;
+    this->last_timestamp = trigger_pack.timestamp;
+    this->has_last_timestamp = true;
+    // The outputs hold until the next sample, act on the pressure expected by then
+    std::float32_t const error = setpoint - this->estimator.predict(dt_s);
+
+    bool const near_target = !following && std::abs(this->target_pressure - estimated_pressure) <= this->gains.settle_band;
+
+    // Leak, read while the pressure is held with the valve closed
+    if (this->holding && valve_was_closed) {
+        // A pump left running past the hold timeout was stopped by the alarm
+        std::float32_t const held_s = static_cast<std::float32_t>(kHoldTimeoutUs) / 1000000.0f;
+        std::float32_t const duty = dt_s > held_s ? previous_duty * held_s / dt_s : previous_duty;
+        this->leak.observeHold(estimated_pressure, duty, dt_s);
+        diagnostics::Diagnostics::getInstance().setLeakRate(
+            this->channel, static_cast<std::uint32_t>(std::lround(this->leak.getLeakRate(estimated_pressure))));
+    } else {
+        this->leak.observePumping(estimated_pressure, this->estimator.getRate(), valve_was_closed ? previous_duty : 0.0f, dt_s);
+    }
+    // Bumpless, the integral gives up what the feedforward takes over
+    std::float32_t const next_feedforward = this->leak.getFeedforward(this->target_pressure);
+    this->integral -= next_feedforward - this->feedforward;
+    this->feedforward = next_feedforward;
+
+    // Settling criterion, on the pressure itself once the profile is over. Once stable
+    // the channel holds, the loop keeps running on the samples which still come.
+    if (!near_target) {
+        this->in_band = false;
+    } else if (!this->in_band) {
+        this->in_band = true;
+        this->band_entry_us = trigger_pack.timestamp;
+    } else if (!this->is_stable && trigger_pack.timestamp - this->band_entry_us >= this->gains.settle_ms * 1000ull) {
         setStatusToStable();
-    } else if (filtered_value < (this->target_pressure + this->target_pressure * 0.1)) {
+        this->holding = true;
+        std::uint64_t const settle_ms = (time_us_64() - this->target_us) / 1000;
+        diagnostics::Diagnostics::getInstance().setTimeToStable(this->channel, static_cast<std::uint32_t>(settle_ms));
+        BPS_LOG("%s settled in %u ms\n", this->name.data(), static_cast<unsigned>(settle_ms));
+    }
+
+    // PI on top of the leak feedforward, the integral stops while the output is saturated
+    // in the direction of the error. It also stops while the setpoint moves: the plant
+    // integrates, so an integral carrying the slope of a ramp would still pump once the
+    // ramp ends and overshoot.
+    std::float32_t const next_integral = this->trajectory.isMoving() ?
+        this->integral : this->integral + this->gains.ki * error * dt_s;
+    std::float32_t const unsaturated = this->feedforward + this->gains.kp * error + next_integral;
+    if ((unsaturated < 1.0f || error < 0.0f) && (unsaturated > -1.0f || error > 0.0f)) {
+        this->integral = next_integral;
+    }
+    std::float32_t output = std::clamp(this->feedforward + this->gains.kp * error + this->integral, -1.0f, 1.0f);
+    if (this->holding && output < 0.0f &&
+        estimated_pressure - this->target_pressure <= kHoldVentBands * this->gains.settle_band) {
+        output = 0.0f;
+    }
+    drive(output);
+    steerEstimator(previous_duty, valve_was_closed);
+}
+
+void PressureController::steerEstimator(std::float32_t const& previous_duty, bool const& valve_was_closed) noexcept {
+    std::float32_t const rate_change = this->leak.getPumpRate() * (this->pump_pwm_level_percentage - previous_duty);
+    this->estimator.steer(rate_change, kPumpRateShare * std::abs(rate_change));
+    if (!valve_was_closed || this->vent_us > 0) {
+        this->estimator.steer(0.0f, kVentRateSd);
+    }
+}
+
+void PressureController::drive(std::float32_t const& output) noexcept {
+    if (output >= 0.0f) {
         setValvePwmPercentage(1.0f);
-        setPumpPwmPercentage(1.0f);
-    } else if (filtered_value > this->target_pressure) {
-        pressureProcessRelease(-1.0f);
+        setPumpPwmPercentage(output);
+        return;
     }
-    
-    this->prev_pressure = filtered_value;
+    pressureProcessRelease(output);
 }
 
 void PressureController::pressureProcessRelease(float const& p_output) noexcept {
     setPumpPwmPercentage(0.0f);
 
-    constexpr std::uint64_t kMaxVentUsPerCycle = 5000;
-    std::uint64_t open_time_us = static_cast<std::uint64_t>(std::pow(p_output, 2) * kMaxVentUsPerCycle);
+    std::uint64_t open_time_us = static_cast<std::uint64_t>(std::abs(p_output) * this->gains.vent_us_per_cycle);
     
     if (open_time_us < 10) {
         setValvePwmPercentage(1.0f);
         return;
     }
 
-    // Release pressure
+    // Release pressure, apply() opens the valve, or keeps it open, until "now + open_time_us"
     setValvePwmPercentage(0.0f);
-    // Create alarm callback which will be called after @open_time_us us
-    static auto valve_alarm_callback = []([[maybe_unused]]alarm_id_t id, void* user_data) -> int64_t {
-        PressureController* self = reinterpret_cast<PressureController*>(user_data);
-        self->setValvePwmPercentage(1.0f);
-        BaseType_t higher_priority_taskwoken = pdFALSE;
-        xSemaphoreGiveFromISR(self->valve_done_sem, &higher_priority_taskwoken);
-        portYIELD_FROM_ISR(higher_priority_taskwoken);
-        return 0;
-    };
-    // Add the alarm
-    add_alarm_in_us(open_time_us, valve_alarm_callback, this, true);
-    xSemaphoreTake(this->valve_done_sem, portMAX_DELAY);
+    this->vent_us = open_time_us;
 }
 
 void PressureController::setStatusToStable() noexcept {
     this->is_stable = true;
-    this->output_is_stable_queue_ref.send(true, 0);
-    BPS_LOG("%s is stable! Send signal to %p\n", this->task_name.data(), this->output_is_stable_queue_ref.getFreeRTOSQueueHandle());
-}
-
-void PressureController::taskLoop() noexcept {
-    while (true) {
-        std::expected<QueueHandle_t, std::nullptr_t> selected_handle{};
-        if ((selected_handle = this->queue_set.selectFromSet(portMAX_DELAY))) {
-            if (selected_handle == this->trigger_pack_queue.getFreeRTOSQueueHandle()) {
-                TriggerPack trigger_pack{};
-                this->trigger_pack_queue.receive(trigger_pack, pdTICKS_TO_MS(0));
-                if (!is_stable) {
-                    controlPressure(trigger_pack.current_pressure);
-                }
-            } else if (selected_handle == this->target_pressure_queue.getFreeRTOSQueueHandle()) {
-                this->target_pressure_queue.receive(this->target_pressure, pdTICKS_TO_MS(0));
-                this->is_stable = false;
-                this->is_first_filtering = true; 
-            }
-        }
-    }
+    BPS_LOG("%s is stable!\n", this->name.data());
 }
 
 } // namespace bps::sampler::pneumatic
\ No newline at end of file
@@ -1,40 +1,72 @@
 #ifndef BPS_PRESSURE_CONTROLLER_HPP
 #define BPS_PRESSURE_CONTROLLER_HPP
 
-#include <FreeRTOS.h>
-#include <semphr.h>
-
 #include <pico/stdlib.h>
 #include <hardware/pwm.h>
 
 #include <stdfloat>
 #include <cstdint>
+#include <cstddef>
 #include <array>
+#include <atomic>
 
 #include "common.hpp"
-#include "queue.hpp"
+#include "relay_tuner.hpp"
+#include "pressure_estimator.hpp"
+#include "setpoint_trajectory.hpp"
+#include "leak_estimator.hpp"
 
 namespace bps::sampler::pneumatic {
 
+// Pump and valve of one channel, with the state of its control loop.
+//
+// The controller has no task of its own: the pneumatic handler's control coroutine
+// calls update() for every channel with the same sample, then apply() for every
+// channel, so the three slices get their new levels together.
 class PressureController {
     public:
         struct TriggerPack {
             std::float32_t current_pressure = 0.0_pa;
+            // When the pressure was read, in us since boot
+            std::uint64_t  timestamp = 0;
         };
 
-        PressureController(uint const& chan_a_gpio) noexcept;
+        PressureController(std::uint8_t const& channel_index, uint const& chan_a_gpio) noexcept;
 
         void initialize() noexcept;
-        void createTask(UBaseType_t const& priority) noexcept;
-
-        QueueReference<TriggerPack> getTriggerPackQueueRef() const noexcept;
-        QueueReference<std::float32_t> getTargetPressureQueueRef() const noexcept;
 
-        void registerIsStableQueue(QueueReference<bool> const& queue) noexcept;
+        // Start controlling towards a new target, a zero target releases the channel
+        void setTarget(std::float32_t const& pressure) noexcept;
+        // Follow "profile" from the current pressure, then settle on its last pressure.
+        // Unlike a zero target, a profile ending at zero keeps an emergency stop latched.
+        void setProfile(SetpointProfile const& profile) noexcept;
+        // Run a relay experiment around "settings.setpoint" instead of controlling, until it is
+        // over or a new target is set. The channel holds and reports stable once it is over.
+        void startTuning(RelayTuner::Settings const& settings) noexcept;
+        // Used from the next control cycle on
+        void setGains(ControlGains const& control_gains) noexcept;
+        ControlGains const& getGains() const noexcept;
+        RelayTuner const& getTuner() const noexcept;
+        bool isStable() const noexcept;
+
+        // Compute the next outputs from one sample. Skipped while stable, unless the channel
+        // holds a pressure: the loop then keeps running, with the leak feedforward.
+        void update(TriggerPack const& trigger_pack) noexcept;
+        // Write the outputs computed by update(). A vent pulse asked by it ends "vent_us"
+        // from now, which shortens or extends a pulse still in progress, and a pulse
+        // still in progress is cut short if the new outputs do not vent. While holding,
+        // the pump stops on its own unless the next apply() comes within kHoldTimeoutUs.
+        void apply() noexcept;
+        LeakEstimator const& getLeakEstimator() const noexcept;
+
+        // Stop the pump and open the valve with one register write, safe from any task or core.
+        // The outputs stay off until a zero target pressure is received.
+        void emergencyStop() noexcept;
         
     private:
         // Status
         bool is_stable = true;
+        std::atomic<bool> emergency_stopped{false};
 
         // PWM related
         static constexpr uint kPwmChanPump  = PWM_CHAN_A;
@@ -50,45 +82,75 @@ class PressureController {
         float valve_pwm_level_percentage = 0.0f;
 
         // Control related
+        static constexpr std::float32_t kMaxPressure = 90000.0_pa;
         std::float32_t target_pressure = 0.0_pa;
-
-        void controlPressure(std::float32_t const& current_pressure) noexcept;
+        ControlGains   gains = kDefaultControlGains;
+        // PI state, the integral is only accumulated while the output is not saturated
+        std::float32_t integral = 0.0f;
+        std::uint64_t  last_timestamp = 0;
+        bool           has_last_timestamp = false;
+        // Settling, measured from the reception of the target
+        std::uint64_t  target_us = 0;
+        std::uint64_t  band_entry_us = 0;
+        bool           in_band = false;
+        // Vent pulse asked by the last update(), started by apply()
+        std::uint64_t  vent_us = 0;
+        // Set while a vent pulse is in progress, cleared by the valve alarm
+        std::atomic<bool> venting{false};
+        alarm_id_t        vent_alarm = 0;
+
+        // Setpoint of the PI loop while active, "target_pressure" otherwise
+        SetpointTrajectory trajectory{};
+
+        // Leak compensation, the feedforward duty follows the leak estimate of the target
+        LeakEstimator  leak{};
+        std::float32_t feedforward = 0.0f;
+        // Settled on a non-zero target, the loop runs on whatever samples still come
+        bool           holding = false;
+        // Without a sample to keep it going, a held pump stops after this long
+        static constexpr std::uint64_t kHoldTimeoutUs = 30000;
+        alarm_id_t     hold_alarm = 0;
+        // While holding, the valve only vents past this many settle bands above the target,
+        // not on every pulse peak; the leak readings need the valve closed.
+        static constexpr std::float32_t kHoldVentBands = 2.0f;
+
+        // Relay experiment, it replaces the PI loop while "tuning"
+        RelayTuner     tuner{};
+        bool           tuning = false;
+
+        // Reset the loop state for a new final target
+        void restart(std::float32_t const& pressure) noexcept;
+        void controlPressure(TriggerPack const& trigger_pack) noexcept;
+        // Pump for an output from 0 to 1, vent for an output from -1 to 0
+        void drive(std::float32_t const& output) noexcept;
+        // Vent for a share of the gains' vent pulse scale, "p_output" is the controller output, from -1 to 0
         void pressureProcessRelease(float const& p_output) noexcept;
 
-        // EMA related
-        static constexpr std::float32_t kEmaAlpha = 0.65f;
-        std::float32_t prev_pressure   = 0.0_pa;
-        bool is_first_filtering = true;
-
-        StaticQueue<TriggerPack, 512> trigger_pack_queue{};
-        StaticQueue<std::float32_t, 3> target_pressure_queue{};
-        QueueReference<bool> output_is_stable_queue_ref{};
+        // Pressure and rate of the channel, restarted on every target
+        PressureEstimator estimator{};
+        // Share of the expected rate change trusted when the pump duty changes, the pump rate
+        // is neither linear in the duty nor the same at every pressure
+        static constexpr std::float32_t kPumpRateShare = 0.3f;
+        // Uncertainty of the rate when a vent pulse starts or ends, in Pa/s, its rate is not modelled
+        static constexpr std::float32_t kVentRateSd = 10000.0f;
+        // Tell the estimator what the outputs just computed do to the rate, from the pump duty
+        // and the valve of the previous cycle
+        void steerEstimator(std::float32_t const& previous_duty, bool const& valve_was_closed) noexcept;
 
         // Status
         void setStatusToStable() noexcept;
 
-        // Task related
-        StaticQueueSet<
-            decltype(trigger_pack_queue),
-            decltype(target_pressure_queue)
-        > queue_set {
-            trigger_pack_queue,
-            target_pressure_queue
-        };
-        
-        // Set the output level percentage for pump control, the range of percentage is [0.0f, 1.0f]
+        // Set the output level percentage of the next apply(), the range of percentage is [0.0f, 1.0f]
         PressureController& setValvePwmPercentage(float const& percentage) noexcept;
         PressureController& setPumpPwmPercentage(float const& percentage) noexcept;
+        static std::uint16_t toPwmLevel(float const& percentage) noexcept;
+        // Write both channel levels, unless an emergency stop is latched
+        void setChannelLevels(std::uint16_t const& pump_level, std::uint16_t const& valve_level) noexcept;
         
-        // FreeRTOS task
-        static constexpr std::size_t kMaxLenOfTaskName = 25;
-        static std::uint8_t task_counter;
-        std::uint8_t task_id;
-        TaskHandle_t task_handle = nullptr;
-        SemaphoreHandle_t valve_done_sem = nullptr;
-        StaticSemaphore_t valve_sem_buffer{};
-        std::array<char, kMaxLenOfTaskName> task_name{0};
-        void taskLoop() noexcept;
+        static constexpr std::size_t kMaxLenOfName = 25;
+        // Cun, Guan, Chi, also the Diagnostics channel
+        std::uint8_t channel;
+        std::array<char, kMaxLenOfName> name{0};
 };
 
 } // namespace bps::sampler::pneumatic
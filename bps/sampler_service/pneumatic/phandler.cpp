@@ -5,98 +5,152 @@
 #include <pico/stdlib.h>
 
 #include <cstdint>
+#include <cstddef>
+#include <array>
 #include <stdfloat>
+#include <optional>
 
 #include "pcontroller.hpp"
-#include "logger.hpp"
+#include "executor.hpp"
+#include "diagnostics.hpp"
 
 namespace bps::sampler::pneumatic {
 
 PneumaticHandler::PneumaticHandler() noexcept {}
 
 void PneumaticHandler::initialize() noexcept {
-    this->cun_controller.initialize();
-    this->guan_controller.initialize();
-    this->chi_controller.initialize();
-
-    this->cun_controller.registerIsStableQueue(this->cun_is_stable_queue);
-    this->guan_controller.registerIsStableQueue(this->guan_is_stable_queue);
-    this->chi_controller.registerIsStableQueue(this->chi_is_stable_queue);
+    for (auto& controller : this->controllers) {
+        controller.initialize();
+    }
 }
 
-void PneumaticHandler::createTask(UBaseType_t const& priority) noexcept {
-    this->cun_controller.createTask(priority);
-    this->guan_controller.createTask(priority);
-    this->chi_controller.createTask(priority);
+bool PneumaticHandler::spawn() noexcept {
+    return coro::Executor::getInstance().spawn(run());
 }
 
 void PneumaticHandler::trigger(PulseValue const& pulse_value) noexcept {
-    static std::expected<QueueHandle_t, std::nullptr_t> selected_queue{};
-    while ((selected_queue = this->queue_set.selectFromSet(0))) {
-        BPS_LOG("Receive stable signal from a controller: %p\n", selected_queue.value());
-        if (selected_queue == this->cun_is_stable_queue.getFreeRTOSQueueHandle()) {
-            BPS_LOG("Cun controller is stable!\n");
-            this->cun_is_stable_queue.receive(this->cun_is_stable, 0);
-        } else if (selected_queue == this->guan_is_stable_queue.getFreeRTOSQueueHandle()) {
-            BPS_LOG("Guan controller is stable!\n");
-            this->guan_is_stable_queue.receive(this->guan_is_stable, 0);
-        } else if (selected_queue == this->chi_is_stable_queue.getFreeRTOSQueueHandle()) {
-            BPS_LOG("Chi controller is stable!\n");
-            this->chi_is_stable_queue.receive(this->chi_is_stable, 0);
+    this->pulse_value_mailbox.send(pulse_value, pdTICKS_TO_MS(0));
+}
+
+void PneumaticHandler::control(PulseValue const& pulse_value) noexcept {
+    std::array<std::float32_t, kNumChannels> const pressures{ pulse_value.cun, pulse_value.guan, pulse_value.chi };
+    for (std::size_t i = 0; i < kNumChannels; ++i) {
+        this->controllers[i].update(PressureController::TriggerPack{ pressures[i], pulse_value.timestamp });
+    }
+    // The outputs only change once every channel is computed
+    for (auto& controller : this->controllers) {
+        controller.apply();
+    }
+}
+
+coro::Task PneumaticHandler::run() noexcept {
+    auto& executor = coro::Executor::getInstance();
+    while (true) {
+        co_await executor.waitUntil([this] {
+            return this->pulse_value_mailbox.size() > 0;
+        });
+        decltype(pulse_value_mailbox)::Letter letter{};
+        if (!this->pulse_value_mailbox.receive(letter, pdTICKS_TO_MS(0))) {
+            continue;
+        }
+        TickType_t const age = decltype(pulse_value_mailbox)::ageOf(letter);
+        bool const stale = age > kMaxInputAge;
+        diagnostics::Diagnostics::getInstance().countControlInput(age * portTICK_PERIOD_MS, stale);
+        if (!stale) {
+            control(letter.content);
         }
     }
-    this->cun_controller.getTriggerPackQueueRef().send(
-        PressureController::TriggerPack{ pulse_value.cun },
-        pdTICKS_TO_MS(0)
-    );
-    this->guan_controller.getTriggerPackQueueRef().send(
-        PressureController::TriggerPack{ pulse_value.guan },
-        pdTICKS_TO_MS(0)
-    );
-    this->chi_controller.getTriggerPackQueueRef().send(
-        PressureController::TriggerPack{ pulse_value.chi },
-        pdTICKS_TO_MS(0)
-    );
 }
 
 PneumaticHandler& PneumaticHandler::setCunPressure(std::float32_t const& pressure) noexcept {
-    BPS_LOG(
-        "Queue Handle: cun = %p, guan = %p, chi = %p\n",
-        this->cun_is_stable_queue.getFreeRTOSQueueHandle(),
-        this->guan_is_stable_queue.getFreeRTOSQueueHandle(),
-        this->chi_is_stable_queue.getFreeRTOSQueueHandle()    
-    );
-    this->cun_is_stable = false;
-    this->cun_controller.getTargetPressureQueueRef().send(pressure, pdTICKS_TO_MS(0));
+    this->controllers[kCun].setTarget(pressure);
     return *this;
 }
 
 PneumaticHandler& PneumaticHandler::setGuanPressure(std::float32_t const& pressure) noexcept {
-    this->guan_is_stable = false;
-    this->guan_controller.getTargetPressureQueueRef().send(pressure, pdTICKS_TO_MS(0));
+    this->controllers[kGuan].setTarget(pressure);
     return *this;
 }
 
 PneumaticHandler& PneumaticHandler::setChiPressure(std::float32_t const& pressure) noexcept {
-    this->chi_is_stable = false;
-    this->chi_controller.getTargetPressureQueueRef().send(pressure, pdTICKS_TO_MS(0));
+    this->controllers[kChi].setTarget(pressure);
     return *this;
 }
 
+PneumaticHandler& PneumaticHandler::setProfile(Position const& position, SetpointProfile const& profile) noexcept {
+    if (auto const index = indexOf(position)) {
+        this->controllers[index.value()].setProfile(profile);
+    }
+    return *this;
+}
+
+std::optional<std::size_t> PneumaticHandler::indexOf(Position const& position) noexcept {
+    switch (position) {
+    case Position::eCun:
+        return kCun;
+    case Position::eGuan:
+        return kGuan;
+    case Position::eChi:
+        return kChi;
+    default:
+        return std::nullopt;
+    }
+}
+
+PneumaticHandler& PneumaticHandler::setGains(Position const& position, ControlGains const& gains) noexcept {
+    if (auto const index = indexOf(position)) {
+        this->controllers[index.value()].setGains(gains);
+    }
+    return *this;
+}
+
+ControlGains PneumaticHandler::getGains(Position const& position) const noexcept {
+    auto const index = indexOf(position);
+    return index ? this->controllers[index.value()].getGains() : kDefaultControlGains;
+}
+
+PneumaticHandler& PneumaticHandler::startTuning(Position const& position, RelayTuner::Settings const& settings) noexcept {
+    if (auto const index = indexOf(position)) {
+        this->controllers[index.value()].startTuning(settings);
+    }
+    return *this;
+}
+
+RelayTuner::State PneumaticHandler::getTuningState(Position const& position) const noexcept {
+    auto const index = indexOf(position);
+    return index ? this->controllers[index.value()].getTuner().getState() : RelayTuner::State::eIdle;
+}
+
+std::optional<RelayTuner::Result> PneumaticHandler::getTuningResult(Position const& position) const noexcept {
+    auto const index = indexOf(position);
+    return index ? this->controllers[index.value()].getTuner().getResult() : std::nullopt;
+}
+
 bool PneumaticHandler::isStable() const noexcept {
-    return this->cun_is_stable && this->guan_is_stable && this->chi_is_stable;
+    return cunIsStable() && guanIsStable() && chiIsStable();
 }
 
 bool PneumaticHandler::cunIsStable() const noexcept {
-    return this->cun_is_stable;
+    return this->controllers[kCun].isStable();
 }
 
 bool PneumaticHandler::guanIsStable() const noexcept {
-    return this->guan_is_stable;
+    return this->controllers[kGuan].isStable();
 }
 
 bool PneumaticHandler::chiIsStable() const noexcept {
-    return this->chi_is_stable;
+    return this->controllers[kChi].isStable();
+}
+
+void PneumaticHandler::emergencyStop() noexcept {
+    for (auto& controller : this->controllers) {
+        controller.emergencyStop();
+    }
+    this->emergency_stop_count.fetch_add(1);
+}
+
+std::uint32_t PneumaticHandler::getEmergencyStopCount() const noexcept {
+    return this->emergency_stop_count.load();
 }
 
 } // namespace bps::sampler::pneumatic
\ No newline at end of file
@@ -4,10 +4,16 @@
 #include <pico/stdlib.h>
 
 #include <cstdint>
-#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+#include <optional>
 
 #include "common.hpp"
+#include "queue.hpp"
+#include "executor.hpp"
 #include "pcontroller.hpp"
+#include "relay_tuner.hpp"
 
 namespace bps::sampler::pneumatic {
 
@@ -23,16 +29,33 @@ class PneumaticHandler {
         PneumaticHandler& operator=(PneumaticHandler const&) = delete;
 
         void initialize() noexcept;
-        void createTask(UBaseType_t const& priority) noexcept;
+        // Spawn the control coroutine on the executor
+        bool spawn() noexcept;
+        // Hand one sample to the control coroutine, call from the executor
         void trigger(PulseValue const& pulse_value) noexcept;
         PneumaticHandler& setCunPressure(std::float32_t const& pressure) noexcept;
         PneumaticHandler& setGuanPressure(std::float32_t const& pressure) noexcept;
         PneumaticHandler& setChiPressure(std::float32_t const& pressure) noexcept;
+        // Move the setpoint of one channel along "profile" instead of stepping it
+        PneumaticHandler& setProfile(Position const& position, SetpointProfile const& profile) noexcept;
+        // Controller settings of one channel, used from its next control cycle
+        PneumaticHandler& setGains(Position const& position, ControlGains const& gains) noexcept;
+        ControlGains getGains(Position const& position) const noexcept;
+        // Run a relay experiment on one channel, until it is over or the channel gets a new target
+        PneumaticHandler& startTuning(Position const& position, RelayTuner::Settings const& settings) noexcept;
+        // eIdle for an unknown position
+        RelayTuner::State getTuningState(Position const& position) const noexcept;
+        std::optional<RelayTuner::Result> getTuningResult(Position const& position) const noexcept;
         bool isStable() const noexcept;
         bool cunIsStable() const noexcept;
         bool guanIsStable() const noexcept;
         bool chiIsStable() const noexcept;
 
+        // Cut every pump and valve output at once, safe from any task or core
+        void emergencyStop() noexcept;
+        // Number of emergency stops so far, the state machine follows it
+        std::uint32_t getEmergencyStopCount() const noexcept;
+
     private:
         PneumaticHandler() noexcept;
 
@@ -43,28 +66,33 @@ class PneumaticHandler {
         static constexpr uint kChiPumpPwmGpioPin   = 10;
         static constexpr uint kChiValvePwmGpioPin  = kChiPumpPwmGpioPin + 1;
 
-        PressureController cun_controller{kCunPumpPwmGpioPin};
-        PressureController guan_controller{kGuanPumpPwmGpioPin};
-        PressureController chi_controller{kChiPumpPwmGpioPin};
-        
-        // Status Related
-        StaticQueue<bool, 1> cun_is_stable_queue{};
-        StaticQueue<bool, 1> guan_is_stable_queue{};
-        StaticQueue<bool, 1> chi_is_stable_queue{};
-
-        StaticQueueSet<
-            decltype(cun_is_stable_queue),
-            decltype(guan_is_stable_queue),
-            decltype(chi_is_stable_queue)
-        > queue_set {
-            cun_is_stable_queue,
-            guan_is_stable_queue,
-            chi_is_stable_queue
-        };
-
-        bool cun_is_stable  = true;
-        bool guan_is_stable = true;
-        bool chi_is_stable  = true;
+        // Indices of "controllers", also the Diagnostics channels
+        static constexpr std::size_t kCun  = 0;
+        static constexpr std::size_t kGuan = 1;
+        static constexpr std::size_t kChi  = 2;
+        static constexpr std::size_t kNumChannels = 3;
+
+        std::array<PressureController, kNumChannels> controllers{{
+            PressureController{kCun, kCunPumpPwmGpioPin},
+            PressureController{kGuan, kGuanPumpPwmGpioPin},
+            PressureController{kChi, kChiPumpPwmGpioPin}
+        }};
+
+        // A sample older than this when the control coroutine takes it is not acted on,
+        // the outputs keep their levels until a fresh one
+        static constexpr TickType_t kMaxInputAge = pdMS_TO_TICKS(20);
+
+        // Only the sampler coroutine feeds it, the control coroutine takes the newest sample
+        Mailbox<PulseValue> pulse_value_mailbox{};
+
+        // Index in "controllers", std::nullopt for eNull
+        static std::optional<std::size_t> indexOf(Position const& position) noexcept;
+
+        // One pass over every channel for one sample
+        void control(PulseValue const& pulse_value) noexcept;
+        coro::Task run() noexcept;
+
+        std::atomic<std::uint32_t> emergency_stop_count{0};
 };
 
 } // namespace bps::sampler::pneumatic
@@ -0,0 +1,113 @@
+#ifndef BPS_PRESSURE_ESTIMATOR_HPP
+#define BPS_PRESSURE_ESTIMATOR_HPP
+
+#include <cstdint>
+#include <stdfloat>
+#include <algorithm>
+
+#include "common.hpp"
+
+namespace bps::sampler::pneumatic {
+
+// Kalman filter estimating the cuff pressure of one channel and its rate of change.
+//
+// The model is a constant rate driven by white noise acceleration, the sensor noise is
+// the measurement noise. The pump and the valve are known inputs: the controller steers
+// the rate by the change it expects from its new outputs, and widens the rate variance
+// by how much it trusts that expectation. The process noise is then left with the slow
+// changes of the leak, and is kept low enough for the pulse riding on the cuff pressure,
+// 0.7 Hz and faster, to sit above the bandwidth of the filter: the rate does not follow
+// the pulse, and the pressure keeps a fraction of it. With two states the filter is a
+// handful of multiplications per sample, and it depends on nothing but the standard
+// library, so pressure traces are replayed through it on a development host
+// (tests/estimator_test.cpp).
+class PressureEstimator {
+    public:
+        // Spectral density of the acceleration, in Pa^2/s^3. The filter bandwidth is then about
+        // 0.3 Hz at 6 to 10 ms samples, it takes about a second to follow a change of the leak.
+        static constexpr std::float32_t kAccelerationDensity = 100.0f;
+        // Variance of one reading, in Pa^2
+        static constexpr std::float32_t kMeasurementVariance = 900.0f;
+        // Variance of the rate on the first sample, in (Pa/s)^2, the pump moves at most about 20 kPa/s
+        static constexpr std::float32_t kInitialRateVariance = 4.0e8f;
+        // A longer gap between samples is propagated as this one, the filter catches up from there
+        static constexpr std::float32_t kMaxStepS = 0.1f;
+
+        // Forget the state, the next sample starts over from it
+        constexpr void reset() noexcept {
+            this->initialized = false;
+        }
+
+        // Correct the estimate with one reading taken at "timestamp", in us
+        constexpr void update(std::float32_t const& measured, std::uint64_t const& timestamp) noexcept {
+            if (!this->initialized) {
+                this->pressure = measured;
+                this->rate = 0.0f;
+                this->p00 = kMeasurementVariance;
+                this->p01 = 0.0f;
+                this->p11 = kInitialRateVariance;
+                this->last_timestamp = timestamp;
+                this->initialized = true;
+                return;
+            }
+            std::float32_t const dt_s = timestamp > this->last_timestamp ?
+                std::min(static_cast<std::float32_t>(timestamp - this->last_timestamp) / 1000000.0f, kMaxStepS) : 0.0f;
+            this->last_timestamp = timestamp;
+
+            // Predict, P = F P F' + Q with F = [1 dt; 0 1]
+            std::float32_t const q = kAccelerationDensity;
+            this->pressure += this->rate * dt_s;
+            this->p00 += dt_s * (2.0f * this->p01 + dt_s * this->p11) + q * dt_s * dt_s * dt_s / 3.0f;
+            this->p01 += dt_s * this->p11 + q * dt_s * dt_s / 2.0f;
+            this->p11 += q * dt_s;
+
+            // Correct with the pressure reading, H = [1 0]
+            std::float32_t const innovation = measured - this->pressure;
+            std::float32_t const s  = this->p00 + kMeasurementVariance;
+            std::float32_t const k0 = this->p00 / s;
+            std::float32_t const k1 = this->p01 / s;
+            this->pressure += k0 * innovation;
+            this->rate     += k1 * innovation;
+            this->p11 -= k1 * this->p01;
+            this->p00 -= k0 * this->p00;
+            this->p01 -= k0 * this->p01;
+        }
+
+        // Move the rate by "rate_change", in Pa/s, known to come from a change of the outputs, with
+        // a standard deviation of "rate_sd" Pa/s. A change of unknown size has no rate_change.
+        constexpr void steer(std::float32_t const& rate_change, std::float32_t const& rate_sd) noexcept {
+            if (!this->initialized) {
+                return;
+            }
+            this->rate += rate_change;
+            this->p11 += rate_sd * rate_sd;
+        }
+
+        constexpr std::float32_t getPressure() const noexcept {
+            return this->pressure;
+        }
+
+        // In Pa/s
+        constexpr std::float32_t getRate() const noexcept {
+            return this->rate;
+        }
+
+        // Pressure expected "horizon_s" after the last reading, if the rate holds
+        constexpr std::float32_t predict(std::float32_t const& horizon_s) const noexcept {
+            return this->pressure + this->rate * horizon_s;
+        }
+
+    private:
+        std::float32_t pressure = 0.0_pa;
+        std::float32_t rate = 0.0f;
+        // Covariance of the estimate
+        std::float32_t p00 = 0.0f;
+        std::float32_t p01 = 0.0f;
+        std::float32_t p11 = 0.0f;
+        std::uint64_t  last_timestamp = 0;
+        bool           initialized = false;
+};
+
+} // namespace bps::sampler::pneumatic
+
+#endif // BPS_PRESSURE_ESTIMATOR_HPP
\ No newline at end of file
@@ -32,69 +32,19 @@ PressureSensors::PressureSensors() noexcept {
 }
 
 std::expected<PulseValue, Error<int>> PressureSensors::readPressureSensorPipelinedSleeping() noexcept {
-    // Request (Write) the pressure data
-    for (std::size_t i = 0; i < kNumSensors; ++i) {
-        if (!selectMuxChannel(i)) {
-            return std::unexpected(Error<int>{ ErrorType::eFailedOperation, PICO_ERROR_GENERIC });
-        }
-        
-        if (writeToSensor(std::array{ kSensorRegCmd, kSensorCmdStartComb }, false) == PICO_ERROR_GENERIC) {
-            return std::unexpected(Error<int>{ ErrorType::eFailedOperation, PICO_ERROR_GENERIC });
-        }
+    if (auto triggered = triggerConversion(AcquisitionConfig::kAllChannels); !triggered) {
+        return std::unexpected(triggered.error());
     }
-
     sleep_ms(kSampleRateMs);
-
-    PulseValue value{};
-    // Fetch (Read) the pressure data
-    for (std::size_t i = 0; i < kNumSensors; ++i) {
-        if (!selectMuxChannel(i)) {
-            return std::unexpected(Error<int>{ ErrorType::eFailedOperation, PICO_ERROR_GENERIC });
-        }
-
-        std::array<uint8_t, 3> p_data_arr{};
-        if (writeToSensor(std::array{ kSensorRegPressMsb }, true) < 0) {
-            return std::unexpected(Error<int>{ ErrorType::eFailedOperation, PICO_ERROR_GENERIC });
-        }
-        if (readFromSensor(p_data_arr, false) != 3) {
-            return std::unexpected(Error<int>{ ErrorType::eFailedOperation, PICO_ERROR_GENERIC });
-        }
-        int32_t pressure_adc_raw = static_cast<int32_t>(
-            (static_cast<uint32_t>(p_data_arr[0]) << 16) |
-            (static_cast<uint32_t>(p_data_arr[1]) << 8)  |
-            (static_cast<uint32_t>(p_data_arr[2]))
-        );
-
-        std::float32_t pressure = 0.0_pa;
-        if (pressure_adc_raw & 0x800000) {
-            constexpr int32_t two_to_24 = 16777216L;
-            pressure = static_cast<std::float32_t>(pressure_adc_raw - two_to_24) / kKValue;
-        } else {
-            pressure = static_cast<std::float32_t>(pressure_adc_raw) / kKValue;
-        }
-
-        switch (i) {
-        case kCunSensorId:
-            value.cun = std::max(pressure - this->pressure_baseline.cun, 0.0_pa);
-            break;
-        case kGuanSensorId:
-            value.guan = std::max(pressure - this->pressure_baseline.guan, 0.0_pa);
-            break;
-        case kChiSensorId:
-            value.chi = std::max(pressure - this->pressure_baseline.chi, 0.0_pa);
-        default:
-            break;
-        }
-    }
-
-    value.timestamp = get_absolute_time();
-
-    return value;
+    return fetchConversion(AcquisitionConfig::kAllChannels);
 }
 
-std::expected<PulseValue, Error<int>> PressureSensors::readPressureSensorPipelinedBlocking() noexcept {
+std::expected<void, Error<int>> PressureSensors::triggerConversion(std::uint8_t const& channel_mask) noexcept {
     // Request (Write) the pressure data
     for (std::size_t i = 0; i < kNumSensors; ++i) {
+        if ((channel_mask & (1u << i)) == 0) {
+            continue;
+        }
         if (!selectMuxChannel(i)) {
             return std::unexpected(Error<int>{ ErrorType::eFailedOperation, PICO_ERROR_GENERIC });
         }
@@ -103,12 +53,16 @@ std::expected<PulseValue, Error<int>> PressureSensors::readPressureSensorPipelin
             return std::unexpected(Error<int>{ ErrorType::eFailedOperation, PICO_ERROR_GENERIC });
         }
     }
+    return {};
+}
 
-    vTaskDelay(pdMS_TO_TICKS(kSampleRateMs));
-
+std::expected<PulseValue, Error<int>> PressureSensors::fetchConversion(std::uint8_t const& channel_mask) noexcept {
     PulseValue value{};
     // Fetch (Read) the pressure data
     for (std::size_t i = 0; i < kNumSensors; ++i) {
+        if ((channel_mask & (1u << i)) == 0) {
+            continue;
+        }
         if (!selectMuxChannel(i)) {
             return std::unexpected(Error<int>{ ErrorType::eFailedOperation, PICO_ERROR_GENERIC });
         }
@@ -26,6 +26,7 @@ class PressureSensors {
         // on the total cycle time, which includes this delay, data processing,
         // and other overhead.
         static constexpr UBaseType_t kSampleRateMs = 6;
+        static_assert(kSampleRateMs == AcquisitionConfig::kMinConversionWaitMs);
 
         // Meyers' Singleton basic constructor settings
         static PressureSensors& getInstance() noexcept {
@@ -38,8 +39,11 @@ class PressureSensors {
         // Read the current pressure from three sensors, note that this will sleep the caller task for "kSampleRateMs" ms
         // This can be called without using FreeRTOS
         std::expected<PulseValue, Error<int>> readPressureSensorPipelinedSleeping() noexcept;
-        // Read the current pressure from three sensors, note that this will block the caller task for "kSampleRateMs" ms
-        std::expected<PulseValue, Error<int>> readPressureSensorPipelinedBlocking() noexcept;
+        // Pipelined read split in two, so the caller decides how to wait for the conversions
+        // (at least "kSampleRateMs" ms) in between. Channels outside "channel_mask" are not
+        // touched and read 0 Pa, both calls must use the same mask.
+        std::expected<void, Error<int>> triggerConversion(std::uint8_t const& channel_mask = AcquisitionConfig::kAllChannels) noexcept;
+        std::expected<PulseValue, Error<int>> fetchConversion(std::uint8_t const& channel_mask = AcquisitionConfig::kAllChannels) noexcept;
         // Set baseline value to specified value.
         void setBaseLine(std::float32_t const& cun_baseline, std::float32_t const& guan_baseline, std::float32_t const& chi_baseline) noexcept;
 
@@ -0,0 +1,160 @@
+#include "relay_tuner.hpp"
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+namespace bps::sampler::pneumatic {
+
+namespace {
+
+constexpr std::float32_t kUsPerS = 1000000.0f;
+// Floor of the identified dead time, below it the gains would only follow the sensor noise
+constexpr std::float32_t kMinDeadTimeS = 0.01f;
+constexpr std::uint16_t  kMinSettleMs = 50;
+constexpr std::uint16_t  kMaxSettleMs = 2000;
+// Switches before the first measured half cycle, the first rise starts from the initial pressure
+constexpr std::uint8_t   kFirstRiseSwitch = 4;
+constexpr std::uint8_t   kFirstFallSwitch = 5;
+
+} // anonymous namespace
+
+void RelayTuner::start(Settings const& tune_settings, ControlGains const& gains, std::uint64_t const& timestamp) noexcept {
+    this->settings        = tune_settings;
+    this->start_gains     = gains;
+    this->state           = State::eRunning;
+    this->start_timestamp = timestamp;
+    this->rising          = true;
+    this->extremum        = Extremum{ std::numeric_limits<std::float32_t>::max(), timestamp };
+    this->switches        = 0;
+    this->rise_count      = 0;
+    this->fall_count      = 0;
+    this->rise_rate_sum   = 0.0f;
+    this->fall_rate_sum   = 0.0f;
+    this->dead_time_sum   = 0.0f;
+}
+
+void RelayTuner::stop() noexcept {
+    this->state = State::eIdle;
+}
+
+std::float32_t RelayTuner::update(std::float32_t const& pressure, std::uint64_t const& timestamp) noexcept {
+    if (this->state != State::eRunning) {
+        return 0.0f;
+    }
+    if (timestamp - this->start_timestamp > kTimeoutUs) {
+        this->state = State::eFailed;
+        return 0.0f;
+    }
+
+    if (this->rising) {
+        if (pressure < this->extremum.pressure) {
+            this->extremum = Extremum{ pressure, timestamp };
+        }
+        if (pressure > this->settings.setpoint + this->settings.hysteresis) {
+            this->last_trough = this->extremum;
+            this->rising = false;
+            this->extremum = Extremum{ std::numeric_limits<std::float32_t>::lowest(), timestamp };
+            if (++this->switches >= kFirstFallSwitch && !measureFall()) {
+                this->state = State::eFailed;
+                return 0.0f;
+            }
+        }
+    } else {
+        if (pressure > this->extremum.pressure) {
+            this->extremum = Extremum{ pressure, timestamp };
+        }
+        if (pressure < this->settings.setpoint - this->settings.hysteresis) {
+            this->last_peak = this->extremum;
+            this->rising = true;
+            this->extremum = Extremum{ std::numeric_limits<std::float32_t>::max(), timestamp };
+            if (++this->switches >= kFirstRiseSwitch && !measureRise()) {
+                this->state = State::eFailed;
+                return 0.0f;
+            }
+        }
+    }
+
+    if (this->rise_count >= kCycles && this->fall_count >= kCycles) {
+        finish();
+        return 0.0f;
+    }
+    return this->rising ? this->settings.amplitude : -this->settings.amplitude;
+}
+
+RelayTuner::State RelayTuner::getState() const noexcept {
+    return this->state;
+}
+
+std::optional<RelayTuner::Result> RelayTuner::getResult() const noexcept {
+    if (this->state != State::eDone) {
+        return std::nullopt;
+    }
+    return this->result;
+}
+
+bool RelayTuner::measureRise() noexcept {
+    // From the trough to the peak the pump ran the whole time, the dead times cancel out
+    std::float32_t const duration_s =
+        static_cast<std::float32_t>(this->last_peak.timestamp - this->last_trough.timestamp) / kUsPerS;
+    std::float32_t const swing = this->last_peak.pressure - this->last_trough.pressure;
+    if (this->last_peak.timestamp <= this->last_trough.timestamp || swing <= 0.0_pa) {
+        return false;
+    }
+    std::float32_t const rate = swing / duration_s;
+    this->rise_rate_sum += rate;
+    // The pressure kept rising for the dead time after the switch
+    this->dead_time_sum += (this->last_peak.pressure - (this->settings.setpoint + this->settings.hysteresis)) / rate;
+    ++this->rise_count;
+    return true;
+}
+
+bool RelayTuner::measureFall() noexcept {
+    std::float32_t const duration_s =
+        static_cast<std::float32_t>(this->last_trough.timestamp - this->last_peak.timestamp) / kUsPerS;
+    std::float32_t const swing = this->last_peak.pressure - this->last_trough.pressure;
+    if (this->last_trough.timestamp <= this->last_peak.timestamp || swing <= 0.0_pa) {
+        return false;
+    }
+    std::float32_t const rate = swing / duration_s;
+    this->fall_rate_sum += rate;
+    this->dead_time_sum += ((this->settings.setpoint - this->settings.hysteresis) - this->last_trough.pressure) / rate;
+    ++this->fall_count;
+    return true;
+}
+
+void RelayTuner::finish() noexcept {
+    std::float32_t const pump_rate = this->rise_rate_sum / static_cast<std::float32_t>(this->rise_count) / this->settings.amplitude;
+    std::float32_t const vent_rate = this->fall_rate_sum / static_cast<std::float32_t>(this->fall_count) / this->settings.amplitude;
+    std::float32_t const dead_time_s = std::max(
+        this->dead_time_sum / static_cast<std::float32_t>(this->rise_count + this->fall_count),
+        kMinDeadTimeS
+    );
+
+    // SIMC rules for an integrating plant, with the closed loop time constant set to the dead time:
+    // kp = 1 / (K (tc + L)) and Ti = 4 (tc + L)
+    std::float32_t const horizon_s = 2.0f * dead_time_s;
+    std::float32_t const kp = 1.0f / (pump_rate * horizon_s);
+    std::float32_t const ki = kp / (4.0f * horizon_s);
+    // Scale the vent pulses so that venting answers an output as fast as pumping
+    std::float32_t const vent_us = static_cast<std::float32_t>(this->start_gains.vent_us_per_cycle) * pump_rate / vent_rate;
+
+    this->result = Result{
+        .gains = ControlGains{
+            .kp                = kp,
+            .ki                = ki,
+            .settle_band       = this->start_gains.settle_band,
+            .settle_ms         = static_cast<std::uint16_t>(std::clamp<std::float32_t>(
+                                     std::round(horizon_s * 2000.0f), kMinSettleMs, kMaxSettleMs)),
+            .vent_us_per_cycle = static_cast<std::uint16_t>(std::clamp<std::float32_t>(
+                                     std::round(vent_us), kMinVentUsPerCycle, kMaxVentUsPerCycle))
+        },
+        .pump_rate   = pump_rate,
+        .vent_rate   = vent_rate,
+        .dead_time_s = dead_time_s
+    };
+    this->state = State::eDone;
+}
+
+} // namespace bps::sampler::pneumatic
\ No newline at end of file
@@ -0,0 +1,101 @@
+#ifndef BPS_RELAY_TUNER_HPP
+#define BPS_RELAY_TUNER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <stdfloat>
+#include <optional>
+
+#include "common.hpp"
+
+namespace bps::sampler::pneumatic {
+
+// Relay feedback experiment identifying the pneumatic plant of one channel.
+//
+// The output switches between pumping and venting at "amplitude" whenever the pressure
+// leaves the hysteresis band around the setpoint, which makes the pressure oscillate.
+// A cuff fed by a pump behaves like an integrator with a dead time: between a trough
+// and the next peak the pressure rises at the pump rate, between a peak and the next
+// trough it falls at the vent rate, and it keeps going for the dead time after every
+// switch. Each half cycle gives one rate and one dead time, averaged over the cycles.
+class RelayTuner {
+    public:
+        // Measured cycles, after the first one which still carries the initial inflation
+        static constexpr std::uint8_t  kCycles = 4;
+        // Gives up without a result past this time
+        static constexpr std::uint64_t kTimeoutUs = 60'000'000;
+        // Bounds of the computed vent pulse scale, a pulse longer than the control cycle vents continuously
+        static constexpr std::uint16_t kMinVentUsPerCycle = 500;
+        static constexpr std::uint16_t kMaxVentUsPerCycle = 10000;
+
+        struct Settings {
+            std::float32_t setpoint;
+            // Relay output, from 0 to 1
+            std::float32_t amplitude;
+            // Half width of the band around the setpoint
+            std::float32_t hysteresis;
+        };
+
+        struct Result {
+            // "gains" of the experiment with the computed kp, ki, settle time and vent pulse scale
+            ControlGains   gains;
+            // Identified plant, the pressure rate at an output of 1 and -1, in Pa/s
+            std::float32_t pump_rate;
+            std::float32_t vent_rate;
+            std::float32_t dead_time_s;
+        };
+
+        enum class State : std::uint8_t {
+            eIdle,
+            eRunning,
+            eDone,
+            eFailed
+        };
+
+        // "gains" are the gains in use, the result keeps their settle band
+        void start(Settings const& settings, ControlGains const& gains, std::uint64_t const& timestamp) noexcept;
+        void stop() noexcept;
+        // Relay output for one filtered pressure sample, 0 once the experiment is over
+        std::float32_t update(std::float32_t const& pressure, std::uint64_t const& timestamp) noexcept;
+
+        State getState() const noexcept;
+        std::optional<Result> getResult() const noexcept;
+
+    private:
+        struct Extremum {
+            std::float32_t pressure = 0.0_pa;
+            std::uint64_t  timestamp = 0;
+        };
+
+        Settings      settings{};
+        ControlGains  start_gains = kDefaultControlGains;
+        State         state = State::eIdle;
+        std::uint64_t start_timestamp = 0;
+
+        // True while pumping
+        bool          rising = true;
+        // Trough of the current rising half, peak of the current falling half
+        Extremum      extremum{};
+        Extremum      last_trough{};
+        Extremum      last_peak{};
+        // Switches so far, the first two only lead into the oscillation
+        std::uint8_t  switches = 0;
+
+        // Sums over the measured half cycles
+        std::uint8_t  rise_count = 0;
+        std::uint8_t  fall_count = 0;
+        std::float32_t rise_rate_sum = 0.0f;
+        std::float32_t fall_rate_sum = 0.0f;
+        std::float32_t dead_time_sum = 0.0f;
+
+        Result result{};
+
+        // Close a half cycle on a switch, return false once it was not usable
+        bool measureRise() noexcept;
+        bool measureFall() noexcept;
+        void finish() noexcept;
+};
+
+} // namespace bps::sampler::pneumatic
+
+#endif // BPS_RELAY_TUNER_HPP
\ No newline at end of file
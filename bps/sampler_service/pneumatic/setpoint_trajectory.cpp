@@ -0,0 +1,85 @@
+#include "setpoint_trajectory.hpp"
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+namespace bps::sampler::pneumatic {
+
+namespace {
+
+constexpr std::float32_t kUsPerS = 1000000.0f;
+constexpr std::uint64_t  kUsPerMs = 1000;
+// An S-curve peaks at 1.5 times its mean slope
+constexpr std::float32_t kSCurveStretch = 1.5f;
+
+} // anonymous namespace
+
+void SetpointTrajectory::start(SetpointProfile const& setpoint_profile) noexcept {
+    this->profile  = setpoint_profile;
+    this->active   = setpoint_profile.count > 0;
+    this->anchored = false;
+    this->segment  = 0;
+}
+
+void SetpointTrajectory::stop() noexcept {
+    this->active = false;
+}
+
+bool SetpointTrajectory::isActive() const noexcept {
+    return this->active;
+}
+
+bool SetpointTrajectory::isMoving() const noexcept {
+    return this->active && this->moving;
+}
+
+std::float32_t SetpointTrajectory::sample(std::float32_t const& pressure, std::uint64_t const& timestamp) noexcept {
+    if (!this->active) {
+        return pressure;
+    }
+    if (!this->anchored) {
+        this->anchored = true;
+        this->from = pressure;
+        this->segment_start = timestamp;
+    }
+
+    // A sample may skip over whole segments, a step with no hold for instance
+    while (true) {
+        auto const& current = this->profile.segments[this->segment];
+        std::uint64_t const elapsed_us = timestamp - this->segment_start;
+        std::uint64_t const move_us = moveDurationUs(current);
+        this->moving = elapsed_us < move_us;
+        if (this->moving) {
+            std::float32_t share = static_cast<std::float32_t>(elapsed_us) / static_cast<std::float32_t>(move_us);
+            if (current.shape == ProfileShape::eSCurve) {
+                share = share * share * (3.0f - 2.0f * share);
+            }
+            return this->from + (current.pressure - this->from) * share;
+        }
+        std::uint64_t const segment_us = move_us + current.hold_ms * kUsPerMs;
+        if (elapsed_us < segment_us) {
+            return current.pressure;
+        }
+        if (this->segment + 1u >= this->profile.count) {
+            this->active = false;
+            return current.pressure;
+        }
+        this->from = current.pressure;
+        this->segment_start += segment_us;
+        ++this->segment;
+    }
+}
+
+std::uint64_t SetpointTrajectory::moveDurationUs(SetpointProfile::Segment const& current) const noexcept {
+    if (current.shape == ProfileShape::eStep || current.rate == 0) {
+        return 0;
+    }
+    std::float32_t duration_s = std::abs(current.pressure - this->from) / static_cast<std::float32_t>(current.rate);
+    if (current.shape == ProfileShape::eSCurve) {
+        duration_s *= kSCurveStretch;
+    }
+    return static_cast<std::uint64_t>(std::lround(duration_s * kUsPerS));
+}
+
+} // namespace bps::sampler::pneumatic
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef BPS_SETPOINT_TRAJECTORY_HPP
+#define BPS_SETPOINT_TRAJECTORY_HPP
+
+#include <cstdint>
+#include <stdfloat>
+
+#include "common.hpp"
+
+namespace bps::sampler::pneumatic {
+
+// Time-varying setpoint of one channel, following a SetpointProfile.
+//
+// The profile is anchored on the first sample after start(): the first segment moves
+// from the pressure measured then. A ramp moves at its rate; an S-curve follows a
+// smoothstep, which starts and ends at rest, lasting 1.5 times the ramp so its steepest
+// point moves at the rate. The controller follows the setpoint instead of a step, so the
+// pump and the valve run at the duty the slope needs instead of bursting at full power.
+class SetpointTrajectory {
+    public:
+        // Follow "profile" from the next sample, replacing the one in progress
+        void start(SetpointProfile const& profile) noexcept;
+        void stop() noexcept;
+        // True until the last segment has been held
+        bool isActive() const noexcept;
+        // True while the last sample was on a ramp or an S-curve, false on a hold
+        bool isMoving() const noexcept;
+
+        // Setpoint at "timestamp", in us, "pressure" anchors a profile just started
+        std::float32_t sample(std::float32_t const& pressure, std::uint64_t const& timestamp) noexcept;
+
+    private:
+        SetpointProfile profile{};
+        bool            active = false;
+        // The profile waits for its first sample
+        bool            anchored = false;
+        bool            moving = false;
+        std::uint8_t    segment = 0;
+        // Where the current segment starts from, and when
+        std::float32_t  from = 0.0_pa;
+        std::uint64_t   segment_start = 0;
+
+        // Time the segment takes to reach its pressure from "from"
+        std::uint64_t moveDurationUs(SetpointProfile::Segment const& current) const noexcept;
+};
+
+} // namespace bps::sampler::pneumatic
+
+#endif // BPS_SETPOINT_TRAJECTORY_HPP
\ No newline at end of file
@@ -1,13 +1,45 @@
 #include "sampler_service.hpp"
 
+#include <utility>
+#include <cmath>
+
+#include <pico/time.h>
+
 #include "pneumatic/psensors.hpp"
 #include "pneumatic/phandler.hpp"
+#include "recorder.hpp"
+#include "session_storage.hpp"
+#include "parameter_store.hpp"
+#include "diagnostics.hpp"
+#include "executor.hpp"
 #include "logger.hpp"
 
 namespace bps::sampler {
 
+namespace {
+
+std::float32_t pressureAt(PulseValue const& value, Position const& position) noexcept {
+    switch (position) {
+    case Position::eCun:
+        return value.cun;
+    case Position::eGuan:
+        return value.guan;
+    case Position::eChi:
+        return value.chi;
+    default:
+        return 0.0_pa;
+    }
+}
+
+} // anonymous namespace
+
 SamplerService::SamplerService():
-pneumatic_handler(pneumatic::PneumaticHandler::getInstance()) {}
+pneumatic_handler(pneumatic::PneumaticHandler::getInstance()) {
+    this->pulse_analyzer.setClock(time_us_32);
+    this->sample_interval.reset(std::uint32_t{this->acquisition_config.conversion_wait_ms} * 1000);
+    this->pulse_analyzer.configure(this->acquisition_config);
+    this->summary_statistics.configure(this->acquisition_config);
+}
 
 void SamplerService::initialize() noexcept {
     auto& sensors = pneumatic::PressureSensors::getInstance();
@@ -31,24 +63,18 @@ void SamplerService::initialize() noexcept {
     sensors.setBaseLine(cun_baseline, guan_baseline, chi_baseline);
 
     this->pneumatic_handler.initialize();
+    // Settings saved by an auto-tune or by the client, the defaults otherwise
+    if (auto const saved = storage::ParameterStore::getInstance().loadControlGains()) {
+        this->pneumatic_handler.setGains(Position::eCun, saved.value()[0])
+                               .setGains(Position::eGuan, saved.value()[1])
+                               .setGains(Position::eChi, saved.value()[2]);
+        BPS_LOG("Control gains loaded\n");
+    }
 }
 
-bool SamplerService::createTask(UBaseType_t const& priority) noexcept {
-    this->pneumatic_handler.createTask(priority);
-
-    static auto freertos_task = 
-        [](void* context) {
-            SamplerService* service = static_cast<SamplerService*>(context);
-            service->taskLoop();
-        };
-    return xTaskCreate(
-        freertos_task,
-        "Pneumatic Service",
-        4096,
-        this,
-        priority,
-        &this->task_handle
-    ) == pdPASS;
+bool SamplerService::spawn() noexcept {
+    return this->pneumatic_handler.spawn() &&
+           coro::Executor::getInstance().spawn(run());
 }
 
 // Get the input queue (like setters reference)
@@ -61,16 +87,34 @@ void SamplerService::registerPulseValueQueue(QueueReference<PulseValue> const& q
     this->output_pulse_value_queue_ref = queue;
 }
 
+void SamplerService::registerPreviewQueue(QueueReference<PulseValue> const& queue) noexcept {
+    this->output_preview_queue_ref = queue;
+}
+
+void SamplerService::registerSummaryQueue(QueueReference<PulseSummary> const& queue) noexcept {
+    this->output_summary_queue_ref = queue;
+}
+
+void SamplerService::registerAnalysisReportQueue(QueueReference<AnalysisReport> const& queue) noexcept {
+    this->output_analysis_report_queue_ref = queue;
+}
+
 void SamplerService::registerMachineStatusQueue(QueueReference<MachineStatus> const& queue) noexcept {
     this->output_machine_status_queue_ref = queue;
 }
 
-void SamplerService::taskLoop() noexcept {
+void SamplerService::emergencyStop() noexcept {
+    this->pneumatic_handler.emergencyStop();
+}
+
+coro::Task SamplerService::run() noexcept {
+    auto& executor = coro::Executor::getInstance();
     while (true) {
         updateCurrentStatus();
-        processCurrentStatus();
+        // The controllers run while the sampler waits for the conversions
+        co_await executor.sleepFor(processCurrentStatus());
+        finishAcquisition();
     }
-    /* Optional: Error handling */
 }
 
 void SamplerService::updateCurrentStatus() noexcept {
@@ -80,6 +124,11 @@ void SamplerService::updateCurrentStatus() noexcept {
             if (this->current_status == MachineStatus::eSampling) {
                 this->current_status = MachineStatus::eIdle;
                 BPS_LOG("Set BPS status to: Idle\n");
+            } else if (this->current_status == MachineStatus::eSweeping ||
+                       this->current_status == MachineStatus::eOscillometry ||
+                       this->current_status == MachineStatus::eAutoTuning) {
+                startReleasingPressure();
+                BPS_LOG("Sweep, oscillometry or auto-tune aborted, set BPS status to: SettingPressure\n");
             }
             break;
         case CommandType::eStartSampling:
@@ -89,52 +138,192 @@ void SamplerService::updateCurrentStatus() noexcept {
             }
             break;
         case CommandType::eSetPressure:
-            if (this->current_status != MachineStatus::eSampling) {
+            if (this->current_status != MachineStatus::eSampling &&
+                this->current_status != MachineStatus::eSweeping &&
+                this->current_status != MachineStatus::eOscillometry &&
+                this->current_status != MachineStatus::eAutoTuning) {
                 this->current_status = MachineStatus::eSettingPressure;
                 this->need_to_set_pressure = true;
+                this->profile_pending = false;
                 BPS_LOG("Set BPS status to: SettingPressure\n");
             }
             break;
-        case CommandType::eReset:
-            this->received_command = Command{
-                .command_type = CommandType::eSetPressure,
-                .content = {
-                    .pressure_settings = {
-                        .cun = 0.0_pa,
-                        .guan = 0.0_pa,
-                        .chi = 0.0_pa
-                    }
+        case CommandType::eSetProfile:
+            if (this->current_status != MachineStatus::eSampling &&
+                this->current_status != MachineStatus::eSweeping &&
+                this->current_status != MachineStatus::eOscillometry &&
+                this->current_status != MachineStatus::eAutoTuning) {
+                auto const& settings = this->received_command.content.profile_settings;
+                if (!isValidProfile(settings)) {
+                    BPS_LOG("Setpoint profile rejected\n");
+                    break;
                 }
-            };
-            this->current_status = MachineStatus::eSettingPressure;
+                this->profile_settings = settings;
+                this->current_status = MachineStatus::eSettingPressure;
+                this->need_to_set_pressure = true;
+                this->profile_pending = true;
+                BPS_LOG("Set BPS status to: SettingPressure along a profile\n");
+            }
+            break;
+        case CommandType::eSweep:
+            if (this->current_status == MachineStatus::eIdle) {
+                this->sweep = Sweep{
+                    .settings = this->received_command.content.sweep_settings,
+                    // Start before the first level, so levels without dwell time are skipped
+                    .level = kSweepSegments.size()
+                };
+                if (nextSweepLevel()) {
+                    this->current_status = MachineStatus::eSweeping;
+                    BPS_LOG("Set BPS status to: Sweeping\n");
+                }
+            }
+            break;
+        case CommandType::eOscillometry:
+            if (this->current_status == MachineStatus::eIdle) {
+                auto const& settings = this->received_command.content.oscillometry_settings;
+                if (settings.position == Position::eNull ||
+                    !std::isfinite(settings.inflate_pressure) || !std::isfinite(settings.end_pressure) ||
+                    !std::isfinite(settings.deflate_rate) ||
+                    settings.inflate_pressure > kMaxOscillometryPressure ||
+                    settings.end_pressure < 0.0_pa ||
+                    settings.end_pressure >= settings.inflate_pressure ||
+                    settings.deflate_rate < kMinDeflateRate ||
+                    settings.deflate_rate > kMaxDeflateRate) {
+                    BPS_LOG("Oscillometry settings rejected\n");
+                    break;
+                }
+                this->oscillometry = Oscillometry{ .settings = settings };
+                this->current_status = MachineStatus::eOscillometry;
+                this->need_to_set_pressure = true;
+                BPS_LOG("Set BPS status to: Oscillometry\n");
+            }
+            break;
+        case CommandType::eSetControlGains: {
+            // Accepted in any status, the controller uses them from its next cycle
+            auto const& settings = this->received_command.content.control_settings;
+            auto const& gains = settings.gains;
+            if (settings.position == Position::eNull ||
+                !std::isfinite(gains.kp) || gains.kp < 0.0f ||
+                !std::isfinite(gains.ki) || gains.ki < 0.0f ||
+                !std::isfinite(gains.settle_band) || gains.settle_band <= 0.0_pa ||
+                gains.vent_us_per_cycle < pneumatic::RelayTuner::kMinVentUsPerCycle ||
+                gains.vent_us_per_cycle > pneumatic::RelayTuner::kMaxVentUsPerCycle) {
+                BPS_LOG("Control gains rejected\n");
+                break;
+            }
+            this->pneumatic_handler.setGains(settings.position, gains);
+            this->control_gains_changed = true;
+            this->save_attempts = 0;
+            BPS_LOG("Control gains of position %u set\n", static_cast<unsigned>(std::to_underlying(settings.position)));
+            break;
+        }
+        case CommandType::eAutoTune:
+            if (this->current_status == MachineStatus::eIdle) {
+                auto const& settings = this->received_command.content.auto_tune_settings;
+                if (settings.position == Position::eNull ||
+                    !std::isfinite(settings.setpoint) ||
+                    settings.setpoint <= 0.0_pa || settings.setpoint > kMaxTuningPressure ||
+                    !std::isfinite(settings.amplitude) ||
+                    settings.amplitude < kMinRelayAmplitude || settings.amplitude > 1.0f ||
+                    !std::isfinite(settings.hysteresis) ||
+                    settings.hysteresis < kMinTuningHysteresis || settings.hysteresis > kMaxTuningHysteresis) {
+                    BPS_LOG("Auto-tune settings rejected\n");
+                    break;
+                }
+                this->auto_tune_settings = settings;
+                this->current_status = MachineStatus::eAutoTuning;
+                this->need_to_set_pressure = true;
+                BPS_LOG("Set BPS status to: AutoTuning\n");
+            }
+            break;
+        case CommandType::eConfigure:
+            // Validated by the GATT server, it takes effect from the next streamed sample
+            releaseHeldSamples(this->last_window_passed);
+            this->acquisition_config = this->received_command.content.acquisition_config;
+            // Measured again, the cycle changes with the conversion wait and the channels
+            this->sample_interval.reset(std::uint32_t{this->acquisition_config.conversion_wait_ms} * 1000);
+            this->filter_bank.configure(this->acquisition_config);
+            this->pulse_analyzer.configure(this->acquisition_config);
+            this->summary_statistics.configure(this->acquisition_config);
+            this->preview_count = 0;
+            BPS_LOG("Acquisition: %u ms, channels 0x%02x, batch %u, filters %u/%u/%u, template %u, quality %u\n",
+                static_cast<unsigned>(this->acquisition_config.conversion_wait_ms),
+                static_cast<unsigned>(this->acquisition_config.channel_mask),
+                static_cast<unsigned>(this->acquisition_config.batch_size),
+                static_cast<unsigned>(this->acquisition_config.filter_sections[0]),
+                static_cast<unsigned>(this->acquisition_config.filter_sections[1]),
+                static_cast<unsigned>(this->acquisition_config.filter_sections[2]),
+                static_cast<unsigned>(this->acquisition_config.template_beats),
+                static_cast<unsigned>(this->acquisition_config.quality_threshold));
+            break;
+        case CommandType::eReset:
+            if (this->current_status == MachineStatus::eSampling ||
+                this->current_status == MachineStatus::eSweeping) {
+                // Close the session before the forced status report below
+                storage::SessionStorage::getInstance().endSession();
+            }
+            startReleasingPressure();
             this->prev_status = MachineStatus::eNull;
-            this->need_to_set_pressure = true;
             BPS_LOG("Set BPS status to: SettingPressure (for Reset)\n");
             break;
         default:
             break;
         }
     }
+    // Checked after the command, so a stop always wins
+    if (std::uint32_t const stops = this->pneumatic_handler.getEmergencyStopCount(); stops != this->handled_emergency_stops) {
+        this->handled_emergency_stops = stops;
+        startReleasingPressure();
+        BPS_LOG("Emergency stop, set BPS status to: SettingPressure\n");
+    }
     if (this->current_status != this->prev_status) {
+        // Sampling sessions, sweeps included, are persisted to flash by the storage task
+        auto const is_recording = [](MachineStatus const& status) {
+            return status == MachineStatus::eSampling || status == MachineStatus::eSweeping;
+        };
+        // A window cut short by the status change is never scored
+        releaseHeldSamples(this->last_window_passed);
+        if (is_recording(this->current_status)) {
+            storage::SessionStorage::getInstance().beginSession();
+            // Each session settles the filters on its own first sample
+            this->filter_bank.reset();
+            this->pulse_analyzer.reset();
+            this->last_window_passed = true;
+            this->preview_count = 0;
+            this->summary_statistics.reset();
+        } else if (is_recording(this->prev_status)) {
+            storage::SessionStorage::getInstance().endSession();
+        }
+        // Before anything is acquired in the new status, flash erases stop both cores
+        storage::SessionStorage::getInstance().setAcquisitionIdle(this->current_status == MachineStatus::eIdle);
         this->output_machine_status_queue_ref.send(this->current_status, pdTICKS_TO_MS(1));
         this->prev_status = this->current_status;
     }
 }
 
-void SamplerService::processCurrentStatus() noexcept {
-    std::expected<bps::PulseValue, bps::Error<int>> value{};
+TickType_t SamplerService::processCurrentStatus() noexcept {
     switch (this->current_status) {
         case MachineStatus::eIdle:
-            vTaskDelay(10);
-            break;
-        case MachineStatus::eSampling:
-            value = pneumatic::PressureSensors::getInstance().readPressureSensorPipelinedBlocking();
-            if (value) {
-                this->output_pulse_value_queue_ref.send(value.value(), 0);
+            if (this->control_gains_changed) {
+                saveControlGains();
             }
-            break;
+            return 10;
+        case MachineStatus::eSampling:
+            return startStreamAcquisition(PressureType::eNull);
+        case MachineStatus::eSweeping:
+            return processSweep();
+        case MachineStatus::eOscillometry:
+            return processOscillometry();
+        case MachineStatus::eAutoTuning:
+            return processAutoTune();
         case MachineStatus::eSettingPressure:
-            if (this->need_to_set_pressure) {
+            if (this->need_to_set_pressure && this->profile_pending) {
+                // The other channels keep their targets
+                this->pneumatic_handler.setProfile(this->profile_settings.position, this->profile_settings.profile);
+                this->need_to_set_pressure = false;
+                this->profile_pending = false;
+                BPS_LOG("Set BPS status to received profile\n");
+            } else if (this->need_to_set_pressure) {
                 this->pneumatic_handler.setCunPressure(this->received_command.content.pressure_settings.cun)
                                        .setGuanPressure(this->received_command.content.pressure_settings.guan)
                                        .setChiPressure(this->received_command.content.pressure_settings.chi);
@@ -144,16 +333,388 @@ void SamplerService::processCurrentStatus() noexcept {
                 this->current_status = MachineStatus::eIdle;
                 BPS_LOG("Set machine status to: Idle\n");
             } else {
-                value = pneumatic::PressureSensors::getInstance().readPressureSensorPipelinedBlocking();
-                if (value) {
-                    this->pneumatic_handler.trigger(value.value());
-                }
+                return startControlAcquisition();
             }
-            break;
+            return 0;
         default:
-            vTaskDelay(10);
-            break;
+            return 10;
+    }
+}
+
+TickType_t SamplerService::processSweep() noexcept {
+    auto const& level = this->sweep.settings.levels[this->sweep.level];
+
+    if (this->need_to_set_pressure) {
+        this->pneumatic_handler.setCunPressure(level.cun)
+                               .setGuanPressure(level.guan)
+                               .setChiPressure(level.chi);
+        this->need_to_set_pressure = false;
+        this->sweep.dwelling = false;
+        BPS_LOG("Sweep level %u: set to received target\n", static_cast<unsigned>(this->sweep.level));
+    } else if (!this->sweep.dwelling) {
+        if (this->pneumatic_handler.isStable()) {
+            this->sweep.dwelling = true;
+            this->sweep.dwell_start = xTaskGetTickCount();
+            // The cuff pressure stepped since the last streamed sample
+            releaseHeldSamples(this->last_window_passed);
+            this->pulse_analyzer.reset();
+            BPS_LOG("Sweep level %u: stable, dwelling\n", static_cast<unsigned>(this->sweep.level));
+        } else {
+            return startControlAcquisition();
+        }
+    } else if (xTaskGetTickCount() - this->sweep.dwell_start >= pdMS_TO_TICKS(this->sweep.settings.dwell_ms[this->sweep.level])) {
+        if (!nextSweepLevel()) {
+            startReleasingPressure();
+            BPS_LOG("Sweep done, set BPS status to: SettingPressure\n");
+        }
+    } else {
+        return startStreamAcquisition(kSweepSegments[this->sweep.level]);
+    }
+    return 0;
+}
+
+TickType_t SamplerService::processOscillometry() noexcept {
+    auto const& settings = this->oscillometry.settings;
+
+    if (this->need_to_set_pressure) {
+        // Only the measured channel is inflated
+        auto const inflate = [&settings](Position const& position) {
+            return (position == settings.position) ? settings.inflate_pressure : 0.0_pa;
+        };
+        this->pneumatic_handler.setCunPressure(inflate(Position::eCun))
+                               .setGuanPressure(inflate(Position::eGuan))
+                               .setChiPressure(inflate(Position::eChi));
+        this->need_to_set_pressure = false;
+        this->oscillometry.deflating = false;
+        this->oscillometry.control_interval.reset(pneumatic::PressureSensors::kSampleRateMs * 1000);
+        BPS_LOG("Oscillometry: inflating\n");
+    } else if (!this->oscillometry.deflating) {
+        if (this->pneumatic_handler.isStable()) {
+            this->oscillometry.deflating = true;
+            this->oscillometry.deflate_start = xTaskGetTickCount();
+            // The controller moves the target down the ramp on every control cycle
+            SetpointProfile deflation{};
+            deflation.segments[0] = SetpointProfile::Segment{
+                .pressure = settings.end_pressure,
+                .rate     = settings.deflate_rate,
+                .hold_ms  = 0,
+                .shape    = ProfileShape::eRamp
+            };
+            deflation.count = 1;
+            this->pneumatic_handler.setProfile(settings.position, deflation);
+            this->oscillometric_envelope.start(
+                this->oscillometry.control_interval.getIntervalUs(),
+                settings.inflate_pressure,
+                settings.end_pressure
+            );
+            BPS_LOG("Oscillometry: deflating, control samples every %u us\n",
+                static_cast<unsigned>(this->oscillometry.control_interval.getIntervalUs()));
+        }
+        return startControlAcquisition();
+    } else {
+        TickType_t const now = xTaskGetTickCount();
+        std::float32_t const elapsed_s = static_cast<std::float32_t>(pdTICKS_TO_MS(now - this->oscillometry.deflate_start)) / 1000.0f;
+        std::float32_t const target = settings.inflate_pressure - static_cast<std::float32_t>(settings.deflate_rate) * elapsed_s;
+        if (target <= settings.end_pressure) {
+            // One compact result replaces the deflation samples
+            this->oscillometric_envelope.finish();
+            while (auto const chunk = this->oscillometric_envelope.nextChunk()) {
+                this->output_analysis_report_queue_ref.send(AnalysisReport{
+                    .type     = AnalysisReport::Type::eEnvelope,
+                    .position = settings.position,
+                    .content  = { .envelope = chunk.value() }
+                }, 0);
+            }
+            startReleasingPressure();
+            BPS_LOG("Oscillometry done, set BPS status to: SettingPressure\n");
+            return 0;
+        }
+        return startControlAcquisition();
+    }
+    return 0;
+}
+
+TickType_t SamplerService::processAutoTune() noexcept {
+    auto const& settings = this->auto_tune_settings;
+
+    if (this->need_to_set_pressure) {
+        this->pneumatic_handler.setCunPressure(0.0_pa)
+                               .setGuanPressure(0.0_pa)
+                               .setChiPressure(0.0_pa)
+                               .startTuning(settings.position, pneumatic::RelayTuner::Settings{
+                                   .setpoint   = settings.setpoint,
+                                   .amplitude  = settings.amplitude,
+                                   .hysteresis = settings.hysteresis
+                               });
+        this->need_to_set_pressure = false;
+        return 0;
+    }
+    if (this->pneumatic_handler.getTuningState(settings.position) == pneumatic::RelayTuner::State::eRunning) {
+        return startControlAcquisition();
+    }
+
+    AnalysisReport report{
+        .type     = AnalysisReport::Type::eTuning,
+        .position = settings.position,
+        .content  = { .tuning = {} }
+    };
+    if (auto const result = this->pneumatic_handler.getTuningResult(settings.position)) {
+        auto const& gains = result.value().gains;
+        this->pneumatic_handler.setGains(settings.position, gains);
+        this->control_gains_changed = true;
+        this->save_attempts = 0;
+        report.content.tuning = AnalysisReport::Content::Tuning{
+            .succeeded         = 1,
+            .pump_rate         = result.value().pump_rate,
+            .vent_rate         = result.value().vent_rate,
+            .dead_time_ms      = static_cast<std::uint16_t>(std::lround(result.value().dead_time_s * 1000.0f)),
+            .kp                = gains.kp,
+            .ki                = gains.ki,
+            .settle_ms         = gains.settle_ms,
+            .vent_us_per_cycle = gains.vent_us_per_cycle
+        };
+        BPS_LOG("Auto-tune done: pump %d Pa/s, vent %d Pa/s, dead time %u ms\n",
+            static_cast<int>(result.value().pump_rate),
+            static_cast<int>(result.value().vent_rate),
+            static_cast<unsigned>(report.content.tuning.dead_time_ms));
+    } else {
+        BPS_LOG("Auto-tune failed\n");
+    }
+    this->output_analysis_report_queue_ref.send(report, 0);
+    startReleasingPressure();
+    return 0;
+}
+
+TickType_t SamplerService::startControlAcquisition() noexcept {
+    if (!pneumatic::PressureSensors::getInstance().triggerConversion(AcquisitionConfig::kAllChannels)) {
+        return 0;
+    }
+    this->acquisition = Acquisition{
+        .purpose      = Acquisition::Purpose::eControl,
+        .channel_mask = AcquisitionConfig::kAllChannels
+    };
+    return pdMS_TO_TICKS(pneumatic::PressureSensors::kSampleRateMs);
+}
+
+TickType_t SamplerService::startStreamAcquisition(PressureType const& segment) noexcept {
+    // Only streaming follows the channel mask, the controllers always read every channel
+    std::uint8_t const channel_mask = this->acquisition_config.channel_mask;
+    if (!pneumatic::PressureSensors::getInstance().triggerConversion(channel_mask)) {
+        // A failed read still takes its sequence, so the gap is visible to the client
+        ++this->next_sequence;
+        auto& counters = diagnostics::Diagnostics::getInstance();
+        counters.countSequenced();
+        counters.countDrop(diagnostics::Stage::eAcquisition);
+        return 0;
+    }
+    this->acquisition = Acquisition{
+        .purpose      = Acquisition::Purpose::eStream,
+        .channel_mask = channel_mask,
+        .segment      = segment
+    };
+    return pdMS_TO_TICKS(this->acquisition_config.conversion_wait_ms);
+}
+
+void SamplerService::finishAcquisition() noexcept {
+    Acquisition const pending = std::exchange(this->acquisition, Acquisition{});
+    if (pending.purpose == Acquisition::Purpose::eNone) {
+        return;
+    }
+
+    auto value = pneumatic::PressureSensors::getInstance().fetchConversion(pending.channel_mask);
+    if (pending.purpose == Acquisition::Purpose::eControl) {
+        std::uint32_t const control_count = this->oscillometry.control_count++;
+        if (value && this->current_status == MachineStatus::eOscillometry) {
+            this->oscillometry.control_interval.update(value.value().timestamp, control_count);
+        }
+        if (value) {
+            this->pneumatic_handler.trigger(value.value());
+            if (this->current_status == MachineStatus::eOscillometry && this->oscillometry.deflating) {
+                this->oscillometric_envelope.process(pressureAt(value.value(), this->oscillometry.settings.position), value.value().timestamp);
+            }
+        }
+        return;
+    }
+
+    auto& counters = diagnostics::Diagnostics::getInstance();
+    // A failed read still takes its sequence, so the gap is visible to the client
+    std::uint32_t const sequence = this->next_sequence++;
+    counters.countSequenced();
+    if (!value) {
+        counters.countDrop(diagnostics::Stage::eAcquisition);
+        return;
+    }
+
+    value.value().segment  = pending.segment;
+    value.value().sequence = sequence;
+    if (this->sample_interval.update(value.value().timestamp, sequence)) {
+        std::uint32_t const interval_us = this->sample_interval.getIntervalUs();
+        this->filter_bank.setSampleInterval(interval_us);
+        this->pulse_analyzer.setSampleInterval(interval_us);
+        BPS_LOG("Sample interval: %u us\n", static_cast<unsigned>(interval_us));
+    }
+    // A channel holding its pressure keeps its loop running on the stream, as long as
+    // every channel is read: a disabled one reads 0 Pa
+    if (pending.channel_mask == AcquisitionConfig::kAllChannels) {
+        this->pneumatic_handler.trigger(value.value());
+    }
+    // Record first, so the sample survives even if the link drops it
+    recorder::SampleRecorder::getInstance().record(value.value());
+    // Analysed raw, the client filters only shape what it sees
+    analysis::PulseAnalyzer::Reports reports{};
+    std::size_t const report_count = this->pulse_analyzer.process(value.value(), reports);
+    for (std::size_t i = 0; i < report_count; ++i) {
+        // A few reports per second, never worth blocking the sampler for
+        this->output_analysis_report_queue_ref.send(reports[i], 0);
+    }
+    if (this->acquisition_config.template_beats > 0) {
+        // Template mode, the averaged beats replace the sample stream
+        counters.countWithheld();
+        return;
+    }
+    this->filter_bank.process(value.value());
+    accumulatePreview(value.value());
+    if (auto const summary = this->summary_statistics.process(value.value())) {
+        // One per window, a full queue only means the link is busy
+        this->output_summary_queue_ref.send(summary.value(), 0);
+    }
+    if (this->acquisition_config.quality_threshold > 0) {
+        // The window closed by this sample decides for the samples held so far
+        if (auto const quality = this->pulse_analyzer.getClosedWindowQuality()) {
+            this->last_window_passed = quality.value() >= this->acquisition_config.quality_threshold;
+            releaseHeldSamples(this->last_window_passed);
+        }
+        if (this->held_count == this->held_samples.size()) {
+            releaseHeldSamples(this->last_window_passed);
+        }
+        if (this->held_count == 0) {
+            this->held_timestamp = value.value().timestamp;
+        }
+        this->held_samples[this->held_count++] = HeldSample{
+            .offset_us = static_cast<std::uint32_t>(value.value().timestamp - this->held_timestamp),
+            .sequence  = value.value().sequence,
+            .pressures = { value.value().cun, value.value().guan, value.value().chi },
+            .segment   = value.value().segment
+        };
+        return;
+    }
+    if (!this->output_pulse_value_queue_ref.send(value.value(), 0)) {
+        counters.countDrop(diagnostics::Stage::eSamplerQueue);
+    }
+}
+
+void SamplerService::releaseHeldSamples(bool const& stream) noexcept {
+    auto& counters = diagnostics::Diagnostics::getInstance();
+    if (!stream) {
+        counters.countWithheld(static_cast<std::uint32_t>(this->held_count));
+        this->held_count = 0;
+        return;
+    }
+    for (std::size_t i = 0; i < this->held_count; ++i) {
+        HeldSample const& held = this->held_samples[i];
+        PulseValue const value{
+            .timestamp = this->held_timestamp + held.offset_us,
+            .cun       = held.pressures[0],
+            .guan      = held.pressures[1],
+            .chi       = held.pressures[2],
+            .segment   = held.segment,
+            .sequence  = held.sequence
+        };
+        if (!this->output_pulse_value_queue_ref.send(value, 0)) {
+            counters.countDrop(diagnostics::Stage::eSamplerQueue);
+        }
+    }
+    this->held_count = 0;
+}
+
+void SamplerService::accumulatePreview(PulseValue const& value) noexcept {
+    if (this->acquisition_config.preview_decimation == 0) {
+        return;
+    }
+    if (this->preview_count == 0) {
+        this->preview_sum = PulseValue{};
+    }
+    this->preview_sum.cun  += value.cun;
+    this->preview_sum.guan += value.guan;
+    this->preview_sum.chi  += value.chi;
+    if (++this->preview_count < this->acquisition_config.preview_decimation) {
+        return;
+    }
+    // The point carries the timing of its last sample
+    std::float32_t const count = static_cast<std::float32_t>(this->preview_count);
+    PulseValue const point{
+        .timestamp = value.timestamp,
+        .cun       = this->preview_sum.cun / count,
+        .guan      = this->preview_sum.guan / count,
+        .chi       = this->preview_sum.chi / count,
+        .segment   = value.segment,
+        .sequence  = value.sequence
+    };
+    this->preview_count = 0;
+    // A full queue means the link is busy, the next point is fresher anyway
+    this->output_preview_queue_ref.send(point, 0);
+}
+
+void SamplerService::saveControlGains() noexcept {
+    storage::ParameterStore::ChannelGains const gains{
+        this->pneumatic_handler.getGains(Position::eCun),
+        this->pneumatic_handler.getGains(Position::eGuan),
+        this->pneumatic_handler.getGains(Position::eChi)
+    };
+    if (storage::ParameterStore::getInstance().saveControlGains(gains)) {
+        this->control_gains_changed = false;
+        BPS_LOG("Control gains saved\n");
+    } else if (++this->save_attempts >= kMaxSaveAttempts) {
+        this->control_gains_changed = false;
+        BPS_LOG("Control gains could not be saved\n");
+    }
+}
+
+void SamplerService::startReleasingPressure() noexcept {
+    this->received_command = Command{
+        .command_type = CommandType::eSetPressure,
+        .content = {
+            .pressure_settings = {
+                .cun = 0.0_pa,
+                .guan = 0.0_pa,
+                .chi = 0.0_pa
+            }
+        }
+    };
+    this->current_status = MachineStatus::eSettingPressure;
+    this->need_to_set_pressure = true;
+}
+
+bool SamplerService::nextSweepLevel() noexcept {
+    auto const& dwell_ms = this->sweep.settings.dwell_ms;
+    do {
+        this->sweep.level = (this->sweep.level >= dwell_ms.size()) ? 0 : (this->sweep.level + 1);
+    } while (this->sweep.level < dwell_ms.size() && dwell_ms[this->sweep.level] == 0);
+
+    if (this->sweep.level >= dwell_ms.size()) {
+        return false;
+    }
+    this->sweep.dwelling = false;
+    this->need_to_set_pressure = true;
+    return true;
+}
+
+bool SamplerService::isValidProfile(Command::Content::ProfileSettings const& settings) noexcept {
+    if (settings.position == Position::eNull ||
+        settings.profile.count == 0 || settings.profile.count > SetpointProfile::kMaxSegments) {
+        return false;
+    }
+    for (std::size_t i = 0; i < settings.profile.count; ++i) {
+        auto const& segment = settings.profile.segments[i];
+        if (!std::isfinite(segment.pressure) || segment.pressure < 0.0_pa || segment.pressure > kMaxProfilePressure) {
+            return false;
+        }
+        if (segment.shape != ProfileShape::eStep &&
+            (segment.rate < kMinProfileRate || segment.rate > kMaxProfileRate)) {
+            return false;
+        }
     }
+    return true;
 }
 
 } // namespace bps::sampler
\ No newline at end of file
@@ -8,9 +8,17 @@
 #include <hardware/i2c.h>
 
 #include <cstdint>
+#include <cstddef>
+#include <array>
 
 #include "common.hpp"
 #include "queue.hpp"
+#include "executor.hpp"
+#include "filter_bank.hpp"
+#include "sample_interval.hpp"
+#include "pulse_analyzer.hpp"
+#include "summary_statistics.hpp"
+#include "oscillometric_envelope.hpp"
 #include "pneumatic/phandler.hpp"
 
 namespace bps::sampler {
@@ -28,7 +36,12 @@ class SamplerService {
         SamplerService& operator=(SamplerService const&) = delete;
         
         void initialize() noexcept;
-        bool createTask(UBaseType_t const& priority) noexcept;
+        // Spawn the sampler and the pressure control coroutines on the executor
+        bool spawn() noexcept;
+
+        // Cut every pneumatic output right away, safe from any task or core.
+        // The state machine releases the pressure on its next pass.
+        void emergencyStop() noexcept;
 
         // Get the input queue (like setters reference)
         QueueReference<Command> getCommandQueueRef() const noexcept;
@@ -36,6 +49,9 @@ class SamplerService {
         // Register command and pressure base value queue
         void registerMachineStatusQueue(QueueReference<MachineStatus> const& queue) noexcept;
         void registerPulseValueQueue(QueueReference<PulseValue> const& queue) noexcept;
+        void registerPreviewQueue(QueueReference<PulseValue> const& queue) noexcept;
+        void registerSummaryQueue(QueueReference<PulseSummary> const& queue) noexcept;
+        void registerAnalysisReportQueue(QueueReference<AnalysisReport> const& queue) noexcept;
 
     private:
         SamplerService();
@@ -43,21 +59,139 @@ class SamplerService {
         StaticQueue<Command, 3> command_queue{};
         QueueReference<MachineStatus> output_machine_status_queue_ref{};
         QueueReference<PulseValue> output_pulse_value_queue_ref{};
+        QueueReference<PulseValue> output_preview_queue_ref{};
+        QueueReference<PulseSummary> output_summary_queue_ref{};
+        QueueReference<AnalysisReport> output_analysis_report_queue_ref{};
 
         pneumatic::PneumaticHandler& pneumatic_handler;
 
-        // FreeRTOS task
-        TaskHandle_t task_handle{nullptr};
-        void taskLoop() noexcept;
+        // Sampler coroutine
+        coro::Task run() noexcept;
 
         void updateCurrentStatus() noexcept;
-        void processCurrentStatus() noexcept;
+        // Both return the ticks to wait before finishAcquisition()
+        TickType_t processCurrentStatus() noexcept;
+        TickType_t processSweep() noexcept;
+        TickType_t processOscillometry() noexcept;
+        TickType_t processAutoTune() noexcept;
+        // Trigger the conversions of a sample for the controllers, or of a streamed sample
+        TickType_t startControlAcquisition() noexcept;
+        TickType_t startStreamAcquisition(PressureType const& segment) noexcept;
+        // Fetch the triggered sample, then hand it to the controllers, or sequence,
+        // record, analyse and queue it to the BLE service
+        void finishAcquisition() noexcept;
+        // Stream or withhold the samples held for quality gating
+        void releaseHeldSamples(bool const& stream) noexcept;
+        // Average the filtered sample into the preview point, queued once complete
+        void accumulatePreview(PulseValue const& value) noexcept;
+        // Release every channel to zero, then go back to Idle
+        void startReleasingPressure() noexcept;
+        // Move to the next sweep level with a dwell time, return false after the last one
+        bool nextSweepLevel() noexcept;
+        static bool isValidProfile(Command::Content::ProfileSettings const& settings) noexcept;
+        // Persist the controller settings of every channel, from Idle only
+        void saveControlGains() noexcept;
 
         // State machine related
         Command received_command{};
         MachineStatus current_status = MachineStatus::eIdle;
         MachineStatus prev_status = MachineStatus::eNull;
         bool need_to_set_pressure = false;
+        // Sequence of the next streamed sample
+        std::uint32_t next_sequence = 0;
+        // Emergency stops already handled by the state machine
+        std::uint32_t handled_emergency_stops = 0;
+        // Streaming acquisition settings, set by the client through eConfigure
+        AcquisitionConfig acquisition_config = kDefaultAcquisitionConfig;
+        // Measured on the streamed samples, the filters and the analysis are designed for it
+        dsp::SampleInterval sample_interval{};
+        // Filters the streamed samples, the recorder keeps them raw
+        dsp::FilterBank filter_bank{};
+        // Analyses the raw streamed samples
+        analysis::PulseAnalyzer pulse_analyzer{};
+        // Filtered samples of the open quality window, held until the window is scored.
+        // Samples released without a score follow the decision of the last scored window.
+        // Timestamps are kept from the first held sample, 24 bytes a sample instead of 32.
+        struct HeldSample {
+            std::uint32_t  offset_us;
+            std::uint32_t  sequence;
+            std::array<std::float32_t, 3> pressures;
+            PressureType   segment;
+        };
+        std::array<HeldSample, analysis::PulseAnalyzer::kQualityWindowMs / AcquisitionConfig::kMinConversionWaitMs + 1> held_samples{};
+        std::size_t   held_count = 0;
+        std::uint64_t held_timestamp = 0;
+        bool last_window_passed = true;
+        // Preview point being averaged, ahead of the quality gating
+        PulseValue   preview_sum{};
+        std::uint8_t preview_count = 0;
+        // Summary statistics of the filtered samples, ahead of the quality gating
+        analysis::SummaryStatistics summary_statistics{};
+
+        // Conversions triggered but not fetched yet
+        struct Acquisition {
+            enum class Purpose : std::uint8_t {
+                eNone,
+                eControl,
+                eStream
+            };
+            Purpose      purpose = Purpose::eNone;
+            std::uint8_t channel_mask = 0;
+            PressureType segment = PressureType::eNull;
+        } acquisition{};
+
+        // Sweep related, the levels run in the float, middle, deep order
+        struct Sweep {
+            Command::Content::SweepSettings settings{};
+            std::size_t level = 0;
+            // False while the level pressure is being reached, true while sampling it
+            bool        dwelling = false;
+            TickType_t  dwell_start = 0;
+        } sweep{};
+        static constexpr std::array<PressureType, 3> kSweepSegments{
+            PressureType::eFloat,
+            PressureType::eMiddle,
+            PressureType::eDeep
+        };
+
+        // Set profile related, kept from the command until the controllers take it
+        Command::Content::ProfileSettings profile_settings{};
+        bool profile_pending = false;
+        // Accepted segments, the pump moves at most about 12 kPa/s
+        static constexpr std::float32_t kMaxProfilePressure = 40000.0_pa;
+        static constexpr std::uint16_t  kMinProfileRate = 50;
+        static constexpr std::uint16_t  kMaxProfileRate = 20000;
+
+        // Oscillometry related, one channel is inflated then deflated along a ramp
+        struct Oscillometry {
+            Command::Content::OscillometrySettings settings{};
+            // False while the inflation pressure is being reached
+            bool       deflating = false;
+            TickType_t deflate_start = 0;
+            // Interval between the control samples, measured while inflating. The control
+            // acquisitions are counted, read or not, so a failed read does not stretch it.
+            dsp::SampleInterval control_interval{};
+            std::uint32_t       control_count = 0;
+        } oscillometry{};
+        analysis::OscillometricEnvelope oscillometric_envelope{};
+        // Accepted settings, about 300 mmHg at most and 0.75 to 15 mmHg/s
+        static constexpr std::float32_t kMaxOscillometryPressure = 40000.0_pa;
+        static constexpr std::uint16_t  kMinDeflateRate = 100;
+        static constexpr std::uint16_t  kMaxDeflateRate = 2000;
+
+        // Auto-tune related, one channel runs a relay experiment while the other two are released
+        Command::Content::AutoTuneSettings auto_tune_settings{};
+        // Accepted settings
+        static constexpr std::float32_t kMaxTuningPressure  = 40000.0_pa;
+        static constexpr std::float32_t kMinRelayAmplitude  = 0.1f;
+        static constexpr std::float32_t kMinTuningHysteresis = 50.0_pa;
+        static constexpr std::float32_t kMaxTuningHysteresis = 2000.0_pa;
+
+        // The controller settings changed since they were last persisted. Saving waits for Idle,
+        // where the flash erase cannot hold the control loop, and gives up after a few failures.
+        bool         control_gains_changed = false;
+        std::uint8_t save_attempts = 0;
+        static constexpr std::uint8_t kMaxSaveAttempts = 3;
 };
 
 } // namespace bps::sampler
@@ -0,0 +1,136 @@
+#ifndef BPS_FILE_FLASH_HPP
+#define BPS_FILE_FLASH_HPP
+
+// Host only stand-in for the on-board flash, it is not part of the firmware build.
+// It keeps NOR semantics (erase to 0xFF, program only clears bits) so a LogStore
+// can be exercised on Linux, and it can cut the power in the middle of a program
+// to check crash recovery.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <array>
+#include <limits>
+#include <algorithm>
+
+namespace bps::storage {
+
+template<std::size_t PageSize = 256, std::size_t SectorSize = 4096>
+class FileFlash {
+    public:
+        static constexpr std::size_t kPageSize   = PageSize;
+        static constexpr std::size_t kSectorSize = SectorSize;
+
+        // Open (or create) "path" as a device of "device_size" bytes, a new file is fully erased
+        FileFlash(char const* path, std::uint32_t const& size_bytes) noexcept:
+            device_size(size_bytes)
+        {
+            this->file = std::fopen(path, "r+b");
+            if (this->file == nullptr) {
+                this->file = std::fopen(path, "w+b");
+                if (this->file != nullptr) {
+                    erase(0, size_bytes);
+                }
+            }
+        }
+
+        ~FileFlash() noexcept {
+            if (this->file != nullptr) {
+                std::fclose(this->file);
+            }
+        }
+
+        FileFlash(FileFlash const&) = delete;
+        FileFlash& operator=(FileFlash const&) = delete;
+
+        bool isValid() const noexcept {
+            return this->file != nullptr;
+        }
+
+        std::uint32_t size() const noexcept {
+            return this->device_size;
+        }
+
+        bool read(std::uint32_t const& address, std::byte* dest, std::size_t const& size) const noexcept {
+            if (!inRange(address, size) || std::fseek(this->file, address, SEEK_SET) != 0) {
+                return false;
+            }
+            return std::fread(dest, 1, size, this->file) == size;
+        }
+
+        bool program(std::uint32_t const& address, std::byte const* src, std::size_t const& size) noexcept {
+            if (!inRange(address, size) || (address % kPageSize) != 0 || (size % kPageSize) != 0) {
+                return false;
+            }
+            std::array<std::byte, kPageSize> page{};
+            for (std::size_t offset = 0; offset < size; offset += kPageSize) {
+                if (!read(address + offset, page.data(), kPageSize)) {
+                    return false;
+                }
+                // Programming can only clear bits
+                std::size_t const length = std::min(kPageSize, this->power_cut_after);
+                for (std::size_t i = 0; i < length; ++i) {
+                    page[i] &= src[offset + i];
+                }
+                if (!write(address + offset, page.data(), kPageSize)) {
+                    return false;
+                }
+                if (length < kPageSize) {
+                    // The power was cut, nothing more reaches the device
+                    this->power_cut_after = 0;
+                    return false;
+                }
+                this->power_cut_after -= (this->power_cut_after == kUnlimited) ? 0 : length;
+            }
+            ++this->program_count;
+            return true;
+        }
+
+        bool erase(std::uint32_t const& address, std::size_t const& size) noexcept {
+            if (!inRange(address, size) || (address % kSectorSize) != 0 || (size % kSectorSize) != 0) {
+                return false;
+            }
+            std::array<std::byte, kSectorSize> erased{};
+            erased.fill(std::byte{0xFF});
+            for (std::size_t offset = 0; offset < size; offset += kSectorSize) {
+                if (!write(address + offset, erased.data(), kSectorSize)) {
+                    return false;
+                }
+            }
+            ++this->erase_count;
+            return true;
+        }
+
+        // Simulate a power cut after "bytes" more bytes have been programmed
+        void cutPowerAfter(std::size_t const& bytes) noexcept {
+            this->power_cut_after = bytes;
+        }
+
+        std::size_t getProgramCount() const noexcept { return this->program_count; }
+        std::size_t getEraseCount() const noexcept { return this->erase_count; }
+
+    private:
+        static constexpr std::size_t kUnlimited = std::numeric_limits<std::size_t>::max();
+
+        std::FILE*    file = nullptr;
+        std::uint32_t device_size = 0;
+        std::size_t   power_cut_after = kUnlimited;
+        std::size_t   program_count = 0;
+        std::size_t   erase_count = 0;
+
+        bool inRange(std::uint32_t const& address, std::size_t const& size) const noexcept {
+            return this->file != nullptr && address <= this->device_size && size <= this->device_size - address;
+        }
+
+        bool write(std::uint32_t const& address, std::byte const* src, std::size_t const& size) noexcept {
+            if (std::fseek(this->file, address, SEEK_SET) != 0 ||
+                std::fwrite(src, 1, size, this->file) != size) {
+                return false;
+            }
+            return std::fflush(this->file) == 0;
+        }
+};
+
+} // namespace bps::storage
+
+#endif // BPS_FILE_FLASH_HPP
\ No newline at end of file
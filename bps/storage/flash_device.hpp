@@ -0,0 +1,31 @@
+#ifndef BPS_FLASH_DEVICE_HPP
+#define BPS_FLASH_DEVICE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <concepts>
+
+namespace bps::storage {
+
+// A NOR flash like device, addresses are relative to the start of the device.
+// Erasing sets whole sectors to 0xFF, programming can only clear bits of whole pages.
+template<typename F>
+concept FlashDevice = requires(
+    F flash,
+    F const const_flash,
+    std::uint32_t address,
+    std::byte* dest,
+    std::byte const* src,
+    std::size_t size
+) {
+    { F::kPageSize } -> std::convertible_to<std::size_t>;
+    { F::kSectorSize } -> std::convertible_to<std::size_t>;
+    { const_flash.size() } noexcept -> std::same_as<std::uint32_t>;
+    { const_flash.read(address, dest, size) } noexcept -> std::same_as<bool>;
+    { flash.program(address, src, size) } noexcept -> std::same_as<bool>;
+    { flash.erase(address, size) } noexcept -> std::same_as<bool>;
+};
+
+} // namespace bps::storage
+
+#endif // BPS_FLASH_DEVICE_HPP
\ No newline at end of file
@@ -0,0 +1,489 @@
+#ifndef BPS_LOG_STORE_HPP
+#define BPS_LOG_STORE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <span>
+#include <optional>
+#include <algorithm>
+
+#include "flash_device.hpp"
+#include "utils.hpp"
+
+namespace bps::storage {
+
+// Lock which does nothing, for single threaded users
+struct NullLock {
+    void lock() noexcept {}
+    void unlock() noexcept {}
+};
+
+// Append-only, log-structured store of fixed-size payloads grouped into sessions.
+//
+// Every flash page holds one payload behind a 16-byte header (little endian):
+//   0  u32  magic
+//   4  u16  session id
+//   6  u16  reserved, 0xFFFF
+//   8  u32  log page number, increases monotonically over the whole device life
+//   12 u32  CRC-32 of header bytes [0, 12) and the payload
+//
+// Pages are written in log order around the device as a ring. Appends never erase,
+// they only fill sectors erased ahead of time by eraseAhead(), which keeps a reserve of
+// erased sectors past the one being filled and is called by the owner whenever an erase
+// cannot hurt. Once the erased sectors are used up, appends are refused until the next
+// eraseAhead(). The state is rebuilt by scanning the page headers on mount, pages with a
+// bad CRC (torn by a power loss) are skipped.
+//
+// Payloads must start with a little endian u32 key which increases within a session,
+// it is used to seek inside a session with a binary search.
+//
+// Flash operations run outside of "Lock", which only guards the in-RAM state. Only one
+// writer is allowed, readers may run concurrently.
+template<FlashDevice Flash, typename Lock = NullLock>
+class LogStore {
+    public:
+        static constexpr std::size_t   kPageSize       = Flash::kPageSize;
+        static constexpr std::size_t   kPageHeaderSize = 16;
+        static constexpr std::size_t   kPayloadSize    = kPageSize - kPageHeaderSize;
+        static constexpr std::size_t   kPagesPerSector = Flash::kSectorSize / kPageSize;
+        static constexpr std::size_t   kMaxSessions    = 16;
+        static constexpr std::uint32_t kMagic          = 0x4C535042; // "BPSL"
+
+        using Payload = std::array<std::byte, kPayloadSize>;
+
+        struct Session {
+            std::uint16_t id = 0;
+            // Log page numbers of the first and the last page, inclusive
+            std::uint32_t first_page = 0;
+            std::uint32_t last_page  = 0;
+        };
+
+        // "erase_ahead_sectors" erased sectors are kept past the sector being filled, at
+        // least one and at most all but the sector being filled and one sector of data
+        LogStore(Flash& device, Lock& state_lock, std::uint32_t const& erase_ahead_sectors = 1) noexcept:
+            flash(device),
+            lock(state_lock),
+            total_pages(device.size() / kPageSize),
+            reserve_pages(std::clamp<std::uint32_t>(
+                erase_ahead_sectors,
+                1,
+                std::max<std::uint32_t>(device.size() / Flash::kSectorSize, 3) - 2
+            ) * kPagesPerSector)
+        {}
+
+        LogStore(LogStore const&) = delete;
+        LogStore& operator=(LogStore const&) = delete;
+
+        // Rebuild the state from the device, must be called once before any other method
+        bool mount() noexcept;
+
+        // Start a new session, following appends belong to it. Return the session id.
+        std::uint16_t beginSession() noexcept;
+        void endSession() noexcept;
+        bool isSessionOpen() const noexcept;
+
+        // Append payloads to the open session. Payloads are programmed in batches of
+        // consecutive pages, into erased sectors only. Return the number of appended payloads.
+        std::size_t append(std::span<Payload const> payloads) noexcept;
+
+        // True while fewer sectors than the reserve are erased past the one being filled
+        bool needsErase() const noexcept;
+        // Erase the next sector past the erased ones, recycling the oldest pages.
+        // This is the only place a sector is erased after mount().
+        bool eraseAhead() noexcept;
+        // Pages appends can still fill without an erase
+        std::uint32_t getErasedPages() const noexcept;
+
+        // Copy the index, oldest session first, return the number of copied sessions
+        std::size_t getSessions(std::span<Session> dest) const noexcept;
+
+        // Copy the payload of the session which holds "key", or the first payload after
+        // it when the key is older than the session. Return the log page number.
+        std::optional<std::uint32_t> seek(std::uint16_t const& session_id, std::uint32_t const& key, Payload& dest) const noexcept;
+
+        // Copy the payload of a session at the given log page number.
+        bool read(std::uint16_t const& session_id, std::uint32_t const& page, Payload& dest) const noexcept;
+
+        // Number of pages which are always kept, older pages are recycled
+        std::uint32_t getCapacityPages() const noexcept {
+            return this->total_pages - this->reserve_pages - kPagesPerSector;
+        }
+
+    private:
+        using PageBuffer = std::array<std::byte, kPageSize>;
+
+        Flash& flash;
+        Lock&  lock;
+        std::uint32_t const total_pages;
+        std::uint32_t const reserve_pages;
+
+        // Log page number of the next page to be written
+        std::uint32_t head_page = 0;
+        // Pages from the head up to this log page number, exclusive, are erased.
+        // It is always at a sector boundary.
+        std::uint32_t erased_until = 0;
+        // Sessions, oldest first
+        std::array<Session, kMaxSessions> sessions{};
+        std::size_t   session_count = 0;
+        std::uint16_t last_session_id = 0;
+        bool          session_open = false;
+
+        struct Header {
+            std::uint16_t session_id;
+            std::uint32_t page;
+        };
+
+        // Everything one ring before the end of the erased sectors has been recycled
+        std::uint32_t oldestPage() const noexcept {
+            return (this->erased_until > this->total_pages) ? (this->erased_until - this->total_pages) : 0;
+        }
+        static std::uint32_t sectorStart(std::uint32_t const& page) noexcept {
+            return page - (page % kPagesPerSector);
+        }
+        std::uint32_t addressOf(std::uint32_t const& page) const noexcept {
+            return (page % this->total_pages) * kPageSize;
+        }
+
+        std::optional<Header> readPage(std::uint32_t const& address, PageBuffer& buffer) const noexcept;
+        bool isErased(std::uint32_t const& address) const noexcept;
+        void dropPagesBefore(std::uint32_t const& page) noexcept;
+        static std::uint32_t crc32(std::byte const* data, std::size_t const& size, std::uint32_t crc = 0xFFFFFFFF) noexcept;
+        static std::uint32_t keyOf(PageBuffer const& buffer) noexcept;
+};
+
+// ================================================================================================
+// == Implementation                                                                             ==
+// ================================================================================================
+
+template<FlashDevice Flash, typename Lock>
+bool LogStore<Flash, Lock>::mount() noexcept {
+    if (this->total_pages < 2 * kPagesPerSector) {
+        return false;
+    }
+
+    // Find the newest valid page
+    PageBuffer buffer{};
+    std::optional<std::uint32_t> newest{};
+    for (std::uint32_t index = 0; index < this->total_pages; ++index) {
+        auto header = readPage(index * kPageSize, buffer);
+        if (header && (!newest || header.value().page > newest.value())) {
+            newest = header.value().page;
+        }
+    }
+
+    std::uint32_t head = newest ? (newest.value() + 1) : 0;
+    // A torn page may sit at the head, restart from a clean sector in that case
+    if (!isErased(addressOf(head))) {
+        head = sectorStart(head) + kPagesPerSector;
+        if (!this->flash.erase(addressOf(head), Flash::kSectorSize)) {
+            return false;
+        }
+    }
+    // The sector after the head may hold a torn erase, erase it again
+    std::uint32_t erased_end = sectorStart(head) + kPagesPerSector;
+    if (!this->flash.erase(addressOf(erased_end), Flash::kSectorSize)) {
+        return false;
+    }
+    erased_end += kPagesPerSector;
+    // Sectors erased ahead before the reset are kept, the rest of the reserve is left to eraseAhead()
+    while (erased_end < sectorStart(head) + kPagesPerSector + this->reserve_pages) {
+        bool erased = true;
+        for (std::uint32_t page = erased_end; erased && page < erased_end + kPagesPerSector; ++page) {
+            erased = isErased(addressOf(page));
+        }
+        if (!erased) {
+            break;
+        }
+        erased_end += kPagesPerSector;
+    }
+
+    this->lock.lock();
+    this->head_page = head;
+    this->erased_until = erased_end;
+    this->session_count = 0;
+    this->session_open = false;
+    this->last_session_id = 0;
+    this->lock.unlock();
+
+    // Rebuild the session index from the pages still held by the ring
+    for (std::uint32_t page = oldestPage(); page < head; ++page) {
+        auto header = readPage(addressOf(page), buffer);
+        if (!header || header.value().page != page) {
+            continue;
+        }
+        this->lock.lock();
+        Session* last = (this->session_count > 0) ? &this->sessions[this->session_count - 1] : nullptr;
+        if (last && last->id == header.value().session_id) {
+            last->last_page = page;
+        } else {
+            if (this->session_count == kMaxSessions) {
+                std::shift_left(this->sessions.begin(), this->sessions.end(), 1);
+                --this->session_count;
+            }
+            this->sessions[this->session_count++] = Session{ header.value().session_id, page, page };
+            this->last_session_id = header.value().session_id;
+        }
+        this->lock.unlock();
+    }
+    return true;
+}
+
+template<FlashDevice Flash, typename Lock>
+std::uint16_t LogStore<Flash, Lock>::beginSession() noexcept {
+    this->lock.lock();
+    // Session ids 0 and 0xFFFF are never used, they look like invalid and erased values
+    std::uint16_t id = this->last_session_id + 1;
+    if (id == 0xFFFF || id == 0) {
+        id = 1;
+    }
+    this->last_session_id = id;
+    this->session_open = true;
+    this->lock.unlock();
+    return id;
+}
+
+template<FlashDevice Flash, typename Lock>
+void LogStore<Flash, Lock>::endSession() noexcept {
+    this->lock.lock();
+    this->session_open = false;
+    this->lock.unlock();
+}
+
+template<FlashDevice Flash, typename Lock>
+bool LogStore<Flash, Lock>::isSessionOpen() const noexcept {
+    this->lock.lock();
+    bool const open = this->session_open;
+    this->lock.unlock();
+    return open;
+}
+
+template<FlashDevice Flash, typename Lock>
+std::size_t LogStore<Flash, Lock>::append(std::span<Payload const> payloads) noexcept {
+    if (!this->session_open) {
+        return 0;
+    }
+
+    // Up to one sector is programmed at once
+    static std::array<std::byte, Flash::kSectorSize> batch{};
+    std::size_t appended = 0;
+    while (appended < payloads.size() && this->head_page < this->erased_until) {
+        std::uint32_t const first_page = this->head_page;
+        std::size_t const count = std::min<std::size_t>(
+            payloads.size() - appended,
+            kPagesPerSector - (first_page % kPagesPerSector)
+        );
+
+        for (std::size_t i = 0; i < count; ++i) {
+            std::byte* page = &batch[i * kPageSize];
+            writeAsLittleEndian(kMagic, &page[0]);
+            writeAsLittleEndian(this->last_session_id, &page[4]);
+            writeAsLittleEndian(std::uint16_t{0xFFFF}, &page[6]);
+            writeAsLittleEndian(static_cast<std::uint32_t>(first_page + i), &page[8]);
+            std::copy(payloads[appended + i].begin(), payloads[appended + i].end(), &page[kPageHeaderSize]);
+            std::uint32_t crc = crc32(&page[0], 12);
+            crc = crc32(&page[kPageHeaderSize], kPayloadSize, crc);
+            writeAsLittleEndian(crc, &page[12]);
+        }
+        if (!this->flash.program(addressOf(first_page), batch.data(), count * kPageSize)) {
+            // Leave the possibly torn pages behind, the next append starts from a fresh sector
+            this->lock.lock();
+            this->head_page = sectorStart(first_page) + kPagesPerSector;
+            this->lock.unlock();
+            return appended;
+        }
+
+        this->lock.lock();
+        Session* last = (this->session_count > 0) ? &this->sessions[this->session_count - 1] : nullptr;
+        if (last && last->id == this->last_session_id) {
+            last->last_page = first_page + count - 1;
+        } else {
+            if (this->session_count == kMaxSessions) {
+                std::shift_left(this->sessions.begin(), this->sessions.end(), 1);
+                --this->session_count;
+            }
+            this->sessions[this->session_count++] = Session{ this->last_session_id, first_page, static_cast<std::uint32_t>(first_page + count - 1) };
+        }
+        this->head_page = first_page + count;
+        this->lock.unlock();
+        appended += count;
+    }
+    return appended;
+}
+
+template<FlashDevice Flash, typename Lock>
+bool LogStore<Flash, Lock>::needsErase() const noexcept {
+    this->lock.lock();
+    bool const needed = this->erased_until < sectorStart(this->head_page) + kPagesPerSector + this->reserve_pages;
+    this->lock.unlock();
+    return needed;
+}
+
+template<FlashDevice Flash, typename Lock>
+bool LogStore<Flash, Lock>::eraseAhead() noexcept {
+    this->lock.lock();
+    std::uint32_t const sector = this->erased_until;
+    std::uint32_t const erased_end = sector + kPagesPerSector;
+    // The sector is about to be erased, forget its pages first
+    dropPagesBefore((erased_end > this->total_pages) ? (erased_end - this->total_pages) : 0);
+    this->lock.unlock();
+
+    if (!this->flash.erase(addressOf(sector), Flash::kSectorSize)) {
+        return false;
+    }
+    this->lock.lock();
+    this->erased_until = erased_end;
+    this->lock.unlock();
+    return true;
+}
+
+template<FlashDevice Flash, typename Lock>
+std::uint32_t LogStore<Flash, Lock>::getErasedPages() const noexcept {
+    this->lock.lock();
+    std::uint32_t const pages = this->erased_until - this->head_page;
+    this->lock.unlock();
+    return pages;
+}
+
+template<FlashDevice Flash, typename Lock>
+std::size_t LogStore<Flash, Lock>::getSessions(std::span<Session> dest) const noexcept {
+    this->lock.lock();
+    std::size_t const count = std::min(dest.size(), this->session_count);
+    std::copy_n(this->sessions.begin() + (this->session_count - count), count, dest.begin());
+    this->lock.unlock();
+    return count;
+}
+
+template<FlashDevice Flash, typename Lock>
+std::optional<std::uint32_t> LogStore<Flash, Lock>::seek(
+    std::uint16_t const& session_id,
+    std::uint32_t const& key,
+    Payload& dest
+) const noexcept {
+    this->lock.lock();
+    auto const session = std::find_if(
+        this->sessions.begin(),
+        this->sessions.begin() + this->session_count,
+        [&session_id](Session const& entry) { return entry.id == session_id; }
+    );
+    bool const found = session != this->sessions.begin() + this->session_count;
+    Session const entry = found ? *session : Session{};
+    this->lock.unlock();
+    if (!found) {
+        return std::nullopt;
+    }
+
+    // Binary search the last page whose key is not greater than "key"
+    PageBuffer buffer{};
+    std::uint32_t low  = entry.first_page;
+    std::uint32_t high = entry.last_page;
+    while (low < high) {
+        std::uint32_t const middle = low + (high - low + 1) / 2;
+        auto header = readPage(addressOf(middle), buffer);
+        if (header && header.value().page == middle && keyOf(buffer) <= key) {
+            low = middle;
+        } else if (header && header.value().page == middle) {
+            high = middle - 1;
+        } else {
+            // Torn or recycled page, fall back to the pages before it
+            high = middle - 1;
+        }
+    }
+    for (std::uint32_t page = low; page <= entry.last_page; ++page) {
+        if (read(session_id, page, dest)) {
+            return page;
+        }
+    }
+    return std::nullopt;
+}
+
+template<FlashDevice Flash, typename Lock>
+bool LogStore<Flash, Lock>::read(
+    std::uint16_t const& session_id,
+    std::uint32_t const& page,
+    Payload& dest
+) const noexcept {
+    PageBuffer buffer{};
+    auto header = readPage(addressOf(page), buffer);
+    if (!header || header.value().page != page || header.value().session_id != session_id) {
+        return false;
+    }
+    std::copy_n(&buffer[kPageHeaderSize], kPayloadSize, dest.begin());
+    return true;
+}
+
+template<FlashDevice Flash, typename Lock>
+std::optional<typename LogStore<Flash, Lock>::Header> LogStore<Flash, Lock>::readPage(
+    std::uint32_t const& address,
+    PageBuffer& buffer
+) const noexcept {
+    if (!this->flash.read(address, buffer.data(), kPageSize)) {
+        return std::nullopt;
+    }
+    std::uint32_t magic = 0;
+    std::uint32_t crc = 0;
+    Header header{};
+    readAsNativeEndian(&buffer[0], magic);
+    readAsNativeEndian(&buffer[4], header.session_id);
+    readAsNativeEndian(&buffer[8], header.page);
+    readAsNativeEndian(&buffer[12], crc);
+    if (magic != kMagic || crc != crc32(&buffer[kPageHeaderSize], kPayloadSize, crc32(&buffer[0], 12))) {
+        return std::nullopt;
+    }
+    return header;
+}
+
+template<FlashDevice Flash, typename Lock>
+bool LogStore<Flash, Lock>::isErased(std::uint32_t const& address) const noexcept {
+    PageBuffer buffer{};
+    if (!this->flash.read(address, buffer.data(), kPageSize)) {
+        return false;
+    }
+    return std::ranges::all_of(buffer, [](std::byte const& value) { return value == std::byte{0xFF}; });
+}
+
+template<FlashDevice Flash, typename Lock>
+void LogStore<Flash, Lock>::dropPagesBefore(std::uint32_t const& page) noexcept {
+    std::size_t dropped = 0;
+    for (std::size_t i = 0; i < this->session_count; ++i) {
+        Session& session = this->sessions[i];
+        if (session.last_page < page) {
+            ++dropped;
+        } else {
+            session.first_page = std::max(session.first_page, page);
+        }
+    }
+    std::shift_left(this->sessions.begin(), this->sessions.begin() + this->session_count, dropped);
+    this->session_count -= dropped;
+}
+
+template<FlashDevice Flash, typename Lock>
+std::uint32_t LogStore<Flash, Lock>::crc32(std::byte const* data, std::size_t const& size, std::uint32_t crc) noexcept {
+    // Reflected CRC-32 (IEEE 802.3), final xor is left to the caller chain
+    static constexpr auto kTable = [] {
+        std::array<std::uint32_t, 256> table{};
+        for (std::uint32_t i = 0; i < table.size(); ++i) {
+            std::uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? (0xEDB88320 ^ (value >> 1)) : (value >> 1);
+            }
+            table[i] = value;
+        }
+        return table;
+    }();
+    for (std::size_t i = 0; i < size; ++i) {
+        crc = kTable[(crc ^ static_cast<std::uint32_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+template<FlashDevice Flash, typename Lock>
+std::uint32_t LogStore<Flash, Lock>::keyOf(PageBuffer const& buffer) noexcept {
+    std::uint32_t key = 0;
+    readAsNativeEndian(&buffer[kPageHeaderSize], key);
+    return key;
+}
+
+} // namespace bps::storage
+
+#endif // BPS_LOG_STORE_HPP
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "parameter_store.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <span>
+#include <optional>
+
+#include "utils.hpp"
+#include "logger.hpp"
+
+namespace bps::storage {
+
+ParameterStore::ParameterStore() noexcept {}
+
+bool ParameterStore::initialize() noexcept {
+    this->mounted = this->store.mount();
+    if (!this->mounted) {
+        BPS_LOG("Parameter storage mount failed\n");
+        return false;
+    }
+    if (auto const newest = findNewest()) {
+        this->save_counter = newest.value().save_counter + 1;
+    }
+    return true;
+}
+
+std::optional<ParameterStore::ChannelGains> ParameterStore::loadControlGains() const noexcept {
+    if (!this->mounted) {
+        return std::nullopt;
+    }
+    if (auto const newest = findNewest()) {
+        return newest.value().gains;
+    }
+    return std::nullopt;
+}
+
+std::optional<ParameterStore::Record> ParameterStore::findNewest() const noexcept {
+    // Every save is a session of one page
+    std::array<Store::Session, Store::kMaxSessions> sessions{};
+    std::size_t const count = this->store.getSessions(sessions);
+    Store::Payload payload{};
+    std::optional<Record> newest{};
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!this->store.read(sessions[i].id, sessions[i].last_page, payload)) {
+            continue;
+        }
+        std::uint32_t counter = 0;
+        std::uint16_t version = 0;
+        std::uint16_t channels = 0;
+        readAsNativeEndian(&payload[0], counter);
+        readAsNativeEndian(&payload[4], version);
+        readAsNativeEndian(&payload[6], channels);
+        if (version != kVersion || channels != kNumChannels) {
+            continue;
+        }
+        // Compared across the wrap of the counter
+        if (newest && static_cast<std::int32_t>(counter - newest.value().save_counter) <= 0) {
+            continue;
+        }
+        Record record{ .save_counter = counter, .gains = {} };
+        std::size_t offset = 8;
+        for (auto& channel : record.gains) {
+            readAsNativeEndian(&payload[offset + 0], channel.kp);
+            readAsNativeEndian(&payload[offset + 4], channel.ki);
+            readAsNativeEndian(&payload[offset + 8], channel.settle_band);
+            readAsNativeEndian(&payload[offset + 12], channel.settle_ms);
+            readAsNativeEndian(&payload[offset + 14], channel.vent_us_per_cycle);
+            offset += kChannelSize;
+        }
+        newest = record;
+    }
+    return newest;
+}
+
+bool ParameterStore::saveControlGains(ChannelGains const& gains) noexcept {
+    if (!this->mounted) {
+        return false;
+    }
+    Store::Payload payload{};
+    payload.fill(std::byte{0xFF});
+    writeAsLittleEndian(this->save_counter++, &payload[0]);
+    writeAsLittleEndian(kVersion, &payload[4]);
+    writeAsLittleEndian(static_cast<std::uint16_t>(kNumChannels), &payload[6]);
+    std::size_t offset = 8;
+    for (auto const& channel : gains) {
+        writeAsLittleEndian(channel.kp, &payload[offset + 0]);
+        writeAsLittleEndian(channel.ki, &payload[offset + 4]);
+        writeAsLittleEndian(channel.settle_band, &payload[offset + 8]);
+        writeAsLittleEndian(channel.settle_ms, &payload[offset + 12]);
+        writeAsLittleEndian(channel.vent_us_per_cycle, &payload[offset + 14]);
+        offset += kChannelSize;
+    }
+
+    this->store.beginSession();
+    bool const saved = this->store.append(std::span<Store::Payload const>(&payload, 1)) == 1;
+    this->store.endSession();
+    // Saves only happen while the sampler is idle, the next sector is erased right away
+    if (this->store.needsErase()) {
+        this->store.eraseAhead();
+    }
+    return saved;
+}
+
+} // namespace bps::storage
\ No newline at end of file
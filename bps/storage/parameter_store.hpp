@@ -0,0 +1,86 @@
+#ifndef BPS_PARAMETER_STORE_HPP
+#define BPS_PARAMETER_STORE_HPP
+
+// Pico SDK
+#include <hardware/flash.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <optional>
+
+#include "common.hpp"
+#include "log_store.hpp"
+#include "pico_flash.hpp"
+#include "session_storage.hpp"
+
+namespace bps::storage {
+
+// Meyers' Singleton Implementation
+//
+// Persists the controller settings of the three channels across reboots. Each save is
+// one page in a small LogStore of its own, so a save torn by a power loss is skipped by
+// its CRC and the previous one is loaded instead. The newest record is the one with the
+// highest save counter, which carries on from it after a reboot.
+//
+// Record payload (little endian):
+//   0  u32  save counter
+//   4  u16  record version
+//   6  u16  number of channels
+//   8  16 bytes per channel, in the Cun, Guan, Chi order:
+//        f32 kp, f32 ki, f32 settle band, u16 settle time, u16 vent pulse scale
+class ParameterStore {
+    public:
+        // Only the sampler coroutine saves and loads
+        using Store = LogStore<PicoFlash>;
+
+        static constexpr std::size_t kNumChannels = 3;
+        using ChannelGains = std::array<ControlGains, kNumChannels>;
+
+        // Flash region, right below the session log. The smallest LogStore keeping pages.
+        static constexpr std::uint32_t kRegionSize   = 3 * FLASH_SECTOR_SIZE;
+        static constexpr std::uint32_t kRegionOffset = SessionStorage::kRegionOffset - kRegionSize;
+
+        // Meyers' Singleton basic constructor settings
+        static ParameterStore& getInstance() noexcept {
+            static ParameterStore storage;
+            return storage;
+        }
+
+        ParameterStore(ParameterStore const&) = delete;
+        ParameterStore& operator=(ParameterStore const&) = delete;
+
+        // Mount the store
+        // ! This must be done once before running !
+        bool initialize() noexcept;
+
+        // The newest saved settings, std::nullopt when none was saved yet
+        std::optional<ChannelGains> loadControlGains() const noexcept;
+        // Program one page, and erase a sector every 16 saves. The caller waits for both.
+        bool saveControlGains(ChannelGains const& gains) noexcept;
+
+    private:
+        ParameterStore() noexcept;
+
+        static constexpr std::uint16_t kVersion = 1;
+        static constexpr std::size_t   kChannelSize = 16;
+
+        struct Record {
+            std::uint32_t save_counter;
+            ChannelGains  gains;
+        };
+
+        PicoFlash flash{kRegionOffset, kRegionSize};
+        NullLock  lock{};
+        Store     store{flash, lock};
+        bool      mounted = false;
+        // Counter of the next save
+        std::uint32_t save_counter = 0;
+
+        // Readable record with the highest save counter
+        std::optional<Record> findNewest() const noexcept;
+};
+
+} // namespace bps::storage
+
+#endif // BPS_PARAMETER_STORE_HPP
\ No newline at end of file
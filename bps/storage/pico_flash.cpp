@@ -0,0 +1,98 @@
+#include "pico_flash.hpp"
+
+// Pico SDK
+#include <pico/flash.h>
+#include <hardware/flash.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+
+namespace bps::storage {
+
+namespace {
+
+struct FlashOperation {
+    std::uint32_t              offset;
+    std::uint8_t const*        src;
+    std::size_t                size;
+    std::atomic<bool> const*   gate;
+    bool                       done;
+};
+
+} // anonymous namespace
+
+PicoFlash::PicoFlash(std::uint32_t const& offset, std::uint32_t const& size) noexcept:
+    region_offset(offset),
+    region_size(size)
+{}
+
+std::uint32_t PicoFlash::size() const noexcept {
+    return this->region_size;
+}
+
+bool PicoFlash::read(std::uint32_t const& address, std::byte* dest, std::size_t const& size) const noexcept {
+    if (!inRange(address, size)) {
+        return false;
+    }
+    // The SDK flushes the XIP cache after every program and erase, so reads are never stale
+    std::memcpy(dest, reinterpret_cast<void const*>(XIP_BASE + this->region_offset + address), size);
+    return true;
+}
+
+bool PicoFlash::program(std::uint32_t const& address, std::byte const* src, std::size_t const& size) noexcept {
+    if (!inRange(address, size) || (address % kPageSize) != 0 || (size % kPageSize) != 0) {
+        return false;
+    }
+    static auto program_callback = [](void* context) {
+        FlashOperation const* pending = static_cast<FlashOperation const*>(context);
+        flash_range_program(pending->offset, pending->src, pending->size);
+    };
+    // One page at a time, the other core runs again between the pages
+    for (std::size_t offset = 0; offset < size; offset += kPageSize) {
+        FlashOperation operation{
+            .offset = static_cast<std::uint32_t>(this->region_offset + address + offset),
+            .src    = reinterpret_cast<std::uint8_t const*>(src + offset),
+            .size   = kPageSize,
+            .gate   = nullptr,
+            .done   = true
+        };
+        if (flash_safe_execute(program_callback, &operation, kSafeExecuteTimeoutMs) != PICO_OK) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PicoFlash::erase(std::uint32_t const& address, std::size_t const& size) noexcept {
+    if (!inRange(address, size) || (address % kSectorSize) != 0 || (size % kSectorSize) != 0) {
+        return false;
+    }
+    FlashOperation operation{
+        .offset = this->region_offset + address,
+        .src    = nullptr,
+        .size   = size,
+        .gate   = this->erase_gate,
+        .done   = false
+    };
+    static auto erase_callback = [](void* context) {
+        FlashOperation* pending = static_cast<FlashOperation*>(context);
+        if (pending->gate != nullptr && !pending->gate->load()) {
+            return;
+        }
+        flash_range_erase(pending->offset, pending->size);
+        pending->done = true;
+    };
+    return flash_safe_execute(erase_callback, &operation, kSafeExecuteTimeoutMs) == PICO_OK && operation.done;
+}
+
+void PicoFlash::setEraseGate(std::atomic<bool> const& gate) noexcept {
+    this->erase_gate = &gate;
+}
+
+bool PicoFlash::inRange(std::uint32_t const& address, std::size_t const& size) const noexcept {
+    return address <= this->region_size && size <= this->region_size - address;
+}
+
+} // namespace bps::storage
\ No newline at end of file
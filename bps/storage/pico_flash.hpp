@@ -0,0 +1,52 @@
+#ifndef BPS_PICO_FLASH_HPP
+#define BPS_PICO_FLASH_HPP
+
+// Pico SDK
+#include <hardware/flash.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+
+namespace bps::storage {
+
+// FlashDevice over a region of the on-board QSPI flash.
+// Reads go through the XIP window, program and erase run through flash_safe_execute,
+// which keeps the other core out of flash while the operation runs. Both cores stop for
+// that long: one page program per call, 0.4 ms typical and 3 ms worst case on W25Q parts,
+// and one sector erase, 45 ms typical and 400 ms worst case, which the owner has to keep
+// away from acquisition.
+class PicoFlash {
+    public:
+        static constexpr std::size_t kPageSize   = FLASH_PAGE_SIZE;
+        static constexpr std::size_t kSectorSize = FLASH_SECTOR_SIZE;
+
+        // "offset" and "size" are relative to the start of the flash and must be sector aligned
+        PicoFlash(std::uint32_t const& offset, std::uint32_t const& size) noexcept;
+
+        PicoFlash(PicoFlash const&) = delete;
+        PicoFlash& operator=(PicoFlash const&) = delete;
+
+        std::uint32_t size() const noexcept;
+        bool read(std::uint32_t const& address, std::byte* dest, std::size_t const& size) const noexcept;
+        bool program(std::uint32_t const& address, std::byte const* src, std::size_t const& size) noexcept;
+        bool erase(std::uint32_t const& address, std::size_t const& size) noexcept;
+
+        // Erases are refused while "gate" is cleared. It is checked with the other core
+        // already locked out, so no erase starts after the owner of the gate cleared it.
+        void setEraseGate(std::atomic<bool> const& gate) noexcept;
+
+    private:
+        // Longest time to wait for the other core to get out of flash
+        static constexpr std::uint32_t kSafeExecuteTimeoutMs = 100;
+
+        std::uint32_t const region_offset;
+        std::uint32_t const region_size;
+        std::atomic<bool> const* erase_gate = nullptr;
+
+        bool inRange(std::uint32_t const& address, std::size_t const& size) const noexcept;
+};
+
+} // namespace bps::storage
+
+#endif // BPS_PICO_FLASH_HPP
\ No newline at end of file
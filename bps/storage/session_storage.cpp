@@ -0,0 +1,161 @@
+#include "session_storage.hpp"
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <span>
+#include <optional>
+#include <algorithm>
+
+#include "recorder.hpp"
+#include "logger.hpp"
+
+namespace bps::storage {
+
+SessionStorage::SessionStorage() noexcept {
+    this->flash.setEraseGate(this->acquisition_idle);
+}
+
+bool SessionStorage::initialize() noexcept {
+    this->mounted = this->store.mount();
+    if (!this->mounted) {
+        BPS_LOG("Session storage mount failed\n");
+    }
+    return this->mounted;
+}
+
+bool SessionStorage::createTask(UBaseType_t const& priority) noexcept {
+    static auto freertos_task =
+        [](void* context) {
+            SessionStorage* storage = static_cast<SessionStorage*>(context);
+            storage->taskLoop();
+        };
+    return xTaskCreate(
+        freertos_task,
+        "Session Storage",
+        1024,
+        this,
+        priority,
+        &this->task_handle
+    ) == pdPASS;
+}
+
+void SessionStorage::beginSession() noexcept {
+    std::uint32_t const ordinal = recorder::SampleRecorder::getInstance().sealBlock();
+    if (!this->event_queue.send(SessionEvent{ .begin = true, .ordinal = ordinal }, 0)) {
+        BPS_LOG("Session storage event dropped\n");
+    }
+}
+
+void SessionStorage::endSession() noexcept {
+    std::uint32_t const ordinal = recorder::SampleRecorder::getInstance().sealBlock();
+    if (!this->event_queue.send(SessionEvent{ .begin = false, .ordinal = ordinal }, 0)) {
+        BPS_LOG("Session storage event dropped\n");
+    }
+}
+
+void SessionStorage::setAcquisitionIdle(bool const& idle) noexcept {
+    this->acquisition_idle.store(idle);
+}
+
+std::size_t SessionStorage::getSessions(std::span<SessionInfo> dest) const noexcept {
+    using recorder::SampleRecorder;
+    std::array<Store::Session, kMaxSessions> sessions{};
+    std::size_t const count = this->store.getSessions(std::span(sessions).first(std::min(dest.size(), kMaxSessions)));
+
+    std::size_t copied = 0;
+    Store::Payload block{};
+    for (std::size_t i = 0; i < count; ++i) {
+        SessionInfo info{ .id = sessions[i].id };
+        if (!this->store.read(info.id, sessions[i].first_page, block)) {
+            continue;
+        }
+        info.first_sequence = SampleRecorder::getFirstSequence(block);
+        if (!this->store.read(info.id, sessions[i].last_page, block)) {
+            continue;
+        }
+        info.last_sequence = SampleRecorder::getFirstSequence(block) + SampleRecorder::getSampleCount(block) - 1;
+        dest[copied++] = info;
+    }
+    return copied;
+}
+
+std::optional<std::uint32_t> SessionStorage::readBlock(
+    std::uint16_t const& session_id,
+    std::uint32_t const& sequence,
+    recorder::SampleRecorder::Block& dest
+) const noexcept {
+    if (!this->mounted) {
+        return std::nullopt;
+    }
+    // A recorder block starts with the sequence of its first sample, which is the store key
+    return this->store.seek(session_id, sequence, dest);
+}
+
+void SessionStorage::persistBlocksBefore(std::uint32_t const& end_ordinal) noexcept {
+    auto& recorder = recorder::SampleRecorder::getInstance();
+    while (this->next_ordinal < end_ordinal) {
+        std::size_t count = 0;
+        while (count < kBatchSize && this->next_ordinal + count < end_ordinal &&
+               recorder.readBlockByOrdinal(this->next_ordinal + count, this->batch[count])) {
+            ++count;
+        }
+        if (count == 0) {
+            // The ring has overwritten the block before it could be stored
+            ++this->dropped_blocks;
+            ++this->next_ordinal;
+            continue;
+        }
+
+        std::size_t const appended = this->store.append(std::span<Store::Payload const>(this->batch.data(), count));
+        if (appended < count) {
+            this->dropped_blocks += count - appended;
+            if (this->store.getErasedPages() == 0) {
+                BPS_LOG("Session storage out of erased sectors\n");
+            } else {
+                BPS_LOG("Session storage program failed\n");
+            }
+        }
+        this->next_ordinal += count;
+    }
+}
+
+void SessionStorage::taskLoop() noexcept {
+    while (true) {
+        static SessionEvent event{};
+        if (!this->mounted) {
+            // Keep the queue drained, nothing can be stored
+            this->event_queue.receive(event, portMAX_DELAY);
+            continue;
+        }
+
+        // One sector per pass, so a new session is noticed between the erases
+        bool const erase_pending = this->acquisition_idle.load() && !this->store.isSessionOpen() && this->store.needsErase();
+        if (this->event_queue.receive(event, erase_pending ? 0 : kPollTicks)) {
+            if (this->store.isSessionOpen()) {
+                // An end event, or a begin event whose end was lost, closes the current session
+                persistBlocksBefore(event.ordinal);
+                this->store.endSession();
+            }
+            if (event.begin) {
+                this->store.beginSession();
+                this->next_ordinal = event.ordinal;
+                this->dropped_blocks = 0;
+            } else if (this->dropped_blocks != 0) {
+                BPS_LOG("Session storage dropped %u blocks\n", static_cast<unsigned>(this->dropped_blocks));
+            }
+        } else if (this->store.isSessionOpen()) {
+            persistBlocksBefore(recorder::SampleRecorder::getInstance().getOpenOrdinal());
+        } else if (erase_pending && !this->store.eraseAhead()) {
+            // Refused because the sampler left idle, or failed, try again next poll
+            vTaskDelay(kPollTicks);
+        }
+    }
+
+    /* Optional: Error Handling */
+}
+
+} // namespace bps::storage
\ No newline at end of file
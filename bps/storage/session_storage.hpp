@@ -0,0 +1,149 @@
+#ifndef BPS_SESSION_STORAGE_HPP
+#define BPS_SESSION_STORAGE_HPP
+
+// FreeRTOS
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+// Pico SDK
+#include <hardware/flash.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <span>
+#include <optional>
+#include <atomic>
+
+#include "queue.hpp"
+#include "recorder.hpp"
+#include "log_store.hpp"
+#include "pico_flash.hpp"
+
+namespace bps::storage {
+
+// Lock over a statically allocated FreeRTOS mutex
+class MutexLock {
+    public:
+        MutexLock() noexcept {
+            this->mutex_handle = xSemaphoreCreateMutexStatic(&this->static_mutex_cb);
+            configASSERT(this->mutex_handle != nullptr);
+        }
+
+        MutexLock(MutexLock const&) = delete;
+        MutexLock& operator=(MutexLock const&) = delete;
+
+        void lock() noexcept {
+            xSemaphoreTake(this->mutex_handle, portMAX_DELAY);
+        }
+
+        void unlock() noexcept {
+            xSemaphoreGive(this->mutex_handle);
+        }
+
+    private:
+        StaticSemaphore_t static_mutex_cb{};
+        SemaphoreHandle_t mutex_handle{nullptr};
+};
+
+// Meyers' Singleton Implementation
+//
+// Persists sampling sessions to flash. The recorder ring is the write buffer: a low
+// priority task copies its complete blocks into a LogStore, one recorder block per
+// flash page, so the sampler never waits on a program or an erase. A program stops
+// both cores for one page at most; sectors are only erased while the sampler is idle,
+// ahead of the next sessions.
+class SessionStorage {
+    public:
+        using Store = LogStore<PicoFlash, MutexLock>;
+
+        // Flash region, right below the BTstack pairing database in the last two sectors
+        static constexpr std::uint32_t kRegionSize   = 2 * 1024 * 1024;
+        static constexpr std::uint32_t kRegionOffset = PICO_FLASH_SIZE_BYTES - 2 * FLASH_SECTOR_SIZE - kRegionSize;
+        static constexpr std::size_t   kMaxSessions  = Store::kMaxSessions;
+        // Half of the region is kept erased, about 14 minutes of samples at the default rate
+        static constexpr std::uint32_t kEraseAheadSectors = kRegionSize / FLASH_SECTOR_SIZE / 2;
+
+        static_assert(Store::kPayloadSize == recorder::SampleRecorder::kBlockSize,
+                      "A recorder block must fill a flash page payload");
+
+        struct SessionInfo {
+            std::uint16_t id = 0;
+            std::uint32_t first_sequence = 0;
+            std::uint32_t last_sequence  = 0;
+        };
+
+        // Meyers' Singleton basic constructor settings
+        static SessionStorage& getInstance() noexcept {
+            static SessionStorage storage;
+            return storage;
+        }
+
+        SessionStorage(SessionStorage const&) = delete;
+        SessionStorage& operator=(SessionStorage const&) = delete;
+
+        // Mount the store, a damaged region is recovered by the mount scan
+        // ! This must be done once before running !
+        bool initialize() noexcept;
+
+        // Create a freertos task
+        // ! This must be done once before running !
+        bool createTask(UBaseType_t const& priority) noexcept;
+
+        // Mark the beginning and the end of a session, samples recorded in between are persisted.
+        // These never block, they only seal the open recorder block and post an event.
+        void beginSession() noexcept;
+        void endSession() noexcept;
+
+        // The sampler reports whether it is idle on every status change. Sectors are only
+        // erased while it is, an erase stops both cores for tens of milliseconds.
+        void setAcquisitionIdle(bool const& idle) noexcept;
+
+        // Copy the stored sessions, oldest first, return the number of copied sessions
+        std::size_t getSessions(std::span<SessionInfo> dest) const noexcept;
+
+        // Copy the stored block of a session which contains "sequence", or the first block
+        // after it. Return the log page number of the copied block.
+        std::optional<std::uint32_t> readBlock(
+            std::uint16_t const& session_id,
+            std::uint32_t const& sequence,
+            recorder::SampleRecorder::Block& dest
+        ) const noexcept;
+
+    private:
+        SessionStorage() noexcept;
+
+        // Blocks are appended by batch of up to one sector
+        static constexpr std::size_t kBatchSize = Store::kPagesPerSector;
+        // Complete blocks are collected for this long, about five blocks while sampling
+        static constexpr TickType_t  kPollTicks = pdMS_TO_TICKS(1000);
+
+        struct SessionEvent {
+            bool          begin;
+            // First recorder block ordinal of the session, or the ordinal after its last one
+            std::uint32_t ordinal;
+        };
+
+        PicoFlash flash{kRegionOffset, kRegionSize};
+        MutexLock lock{};
+        Store store{flash, lock, kEraseAheadSectors};
+        bool mounted = false;
+        std::atomic<bool> acquisition_idle{true};
+
+        StaticQueue<SessionEvent, 4> event_queue{};
+
+        // Storage task state
+        std::uint32_t next_ordinal = 0;
+        std::uint32_t dropped_blocks = 0;
+        std::array<Store::Payload, kBatchSize> batch{};
+
+        void persistBlocksBefore(std::uint32_t const& end_ordinal) noexcept;
+
+        // FreeRTOS task
+        TaskHandle_t task_handle{nullptr};
+        void taskLoop() noexcept;
+};
+
+} // namespace bps::storage
+
+#endif // BPS_SESSION_STORAGE_HPP
\ No newline at end of file
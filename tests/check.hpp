@@ -0,0 +1,34 @@
+#ifndef BPS_TEST_CHECK_HPP
+#define BPS_TEST_CHECK_HPP
+
+#include <cstdio>
+
+namespace bps::test {
+
+inline int& failures() noexcept {
+    static int count = 0;
+    return count;
+}
+
+// Print the result, return the exit code of the test
+inline int report(char const* name) noexcept {
+    if (failures() != 0) {
+        std::printf("%s: %d checks failed\n", name, failures());
+        return 1;
+    }
+    std::printf("%s: passed\n", name);
+    return 0;
+}
+
+} // namespace bps::test
+
+// Count and print a failed check, the test goes on
+#define BPS_CHECK(condition)                                                        \
+    do {                                                                            \
+        if (!(condition)) {                                                         \
+            ++bps::test::failures();                                                \
+            std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        }                                                                           \
+    } while (false)
+
+#endif // BPS_TEST_CHECK_HPP
\ No newline at end of file
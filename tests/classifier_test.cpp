@@ -0,0 +1,169 @@
+// Host check of the pulse classifier: the tree ensemble on reference feature vectors,
+// one per class and on both sides of every threshold, and the features extracted from
+// a synthetic beat.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <optional>
+#include <utility>
+
+#include "common.hpp"
+#include "pulse_classifier.hpp"
+#include "check.hpp"
+
+namespace {
+
+using bps::analysis::PulseClassifier;
+using bps::analysis::pulse_model::Feature;
+using bps::analysis::pulse_model::PulseClass;
+
+using Features = PulseClassifier::Features;
+using Beat     = PulseClassifier::Beat;
+
+// 72 bpm, regular, 800 Pa, 120 ms upstroke
+constexpr Features kModerate{ 720, 30, 12800, 120 };
+
+Features with(Feature const& feature, std::int32_t const& value) {
+    Features features = kModerate;
+    features[std::to_underlying(feature)] = value;
+    return features;
+}
+
+bool classifies(Features const& features, PulseClass const& label, std::uint8_t const& confidence) {
+    auto const result = PulseClassifier::infer(features);
+    if (result.label != label || result.confidence != confidence) {
+        std::printf("{%d, %d, %d, %d}: class %u at %u %%, expected class %u at %u %%\n",
+            static_cast<int>(features[0]), static_cast<int>(features[1]), static_cast<int>(features[2]),
+            static_cast<int>(features[3]), static_cast<unsigned>(result.label), static_cast<unsigned>(result.confidence),
+            static_cast<unsigned>(label), static_cast<unsigned>(confidence));
+        return false;
+    }
+    return true;
+}
+
+void checkClasses() {
+    // Every tree votes moderate
+    BPS_CHECK(classifies(kModerate, PulseClass::eModerate, 100));
+    // The rate and the regular rate trees agree, 384 of 512
+    BPS_CHECK(classifies(with(Feature::eHeartRate, 450),  PulseClass::eSlow, 75));
+    BPS_CHECK(classifies(with(Feature::eHeartRate, 1100), PulseClass::eRapid, 75));
+    // Both rhythm trees, 447 of 607
+    BPS_CHECK(classifies(with(Feature::eIrregularity, 200), PulseClass::eIrregular, 73));
+    // One abnormal side outweighs the moderate votes of the others, 224 of 384
+    BPS_CHECK(classifies(with(Feature::eAmplitude, 1600),  PulseClass::eWeak, 58));
+    // A large amplitude with a sharp upstroke, two trees agree
+    BPS_CHECK(classifies(Features{ 720, 30, 40000, 60 }, PulseClass::eForceful, 76));
+    // A small amplitude with a slow upstroke, two trees agree
+    BPS_CHECK(classifies(Features{ 720, 30, 1600, 250 }, PulseClass::eWeak, 75));
+}
+
+void checkThresholds() {
+    // A split sends a feature equal to its threshold below
+    BPS_CHECK(classifies(with(Feature::eHeartRate, 600), PulseClass::eSlow, 58));
+    BPS_CHECK(classifies(with(Feature::eHeartRate, 601), PulseClass::eModerate, 100));
+    BPS_CHECK(classifies(with(Feature::eHeartRate, 900), PulseClass::eModerate, 100));
+    BPS_CHECK(classifies(with(Feature::eHeartRate, 901), PulseClass::eRapid, 58));
+
+    // A slightly uneven rhythm is not enough on its own, a clearly irregular one is
+    BPS_CHECK(classifies(with(Feature::eIrregularity, 80),  PulseClass::eModerate, 100));
+    BPS_CHECK(classifies(with(Feature::eIrregularity, 81),  PulseClass::eModerate, 54));
+    BPS_CHECK(classifies(with(Feature::eIrregularity, 150), PulseClass::eModerate, 54));
+    BPS_CHECK(classifies(with(Feature::eIrregularity, 151), PulseClass::eIrregular, 73));
+
+    BPS_CHECK(classifies(with(Feature::eAmplitude, 3200),  PulseClass::eWeak, 58));
+    BPS_CHECK(classifies(with(Feature::eAmplitude, 3201),  PulseClass::eModerate, 100));
+    BPS_CHECK(classifies(with(Feature::eAmplitude, 32000), PulseClass::eModerate, 100));
+    BPS_CHECK(classifies(with(Feature::eAmplitude, 32001), PulseClass::eForceful, 58));
+
+    // The upstroke alone never outweighs the other sides
+    BPS_CHECK(classifies(with(Feature::eRiseTime, 200), PulseClass::eModerate, 100));
+    BPS_CHECK(classifies(with(Feature::eRiseTime, 201), PulseClass::eModerate, 54));
+    // A sharp upstroke on a large amplitude ties forceful with moderate, the tie goes to
+    // the lower label
+    BPS_CHECK(classifies(Features{ 720, 30, 16001, 80 }, PulseClass::eModerate, 50));
+    BPS_CHECK(classifies(Features{ 720, 30, 16001, 81 }, PulseClass::eModerate, 100));
+}
+
+Beat makeBeat(std::uint64_t const& timestamp, std::uint16_t const& interval_ms, std::uint8_t const& interval_count) {
+    return Beat{
+        .timestamp        = timestamp,
+        .sequence         = 0,
+        .interval_ms      = interval_ms,
+        .heart_rate       = static_cast<std::uint16_t>(interval_ms > 0 ? 600000 / interval_ms : 0),
+        .mean_interval_ms = 790,
+        .rmssd_ms         = 45,
+        .interval_count   = interval_count
+    };
+}
+
+// One beat from "onset" us: a foot at 1000 Pa, a peak of "amplitude" 120 ms later, then a
+// decay, 8 ms samples from the onset over "period_ms"
+void feedBeat(PulseClassifier& classifier, std::uint64_t const& onset, std::float32_t const& amplitude,
+              std::uint32_t const& period_ms) {
+    for (std::uint32_t t_ms = 0; t_ms < period_ms; t_ms += 8) {
+        std::float32_t const pressure = t_ms <= 120 ?
+            1000.0_pa + amplitude * static_cast<std::float32_t>(t_ms) / 120.0f :
+            1000.0_pa + amplitude * (1.0f - 0.8f * static_cast<std::float32_t>(t_ms - 120) / static_cast<std::float32_t>(period_ms));
+        classifier.process(pressure, onset + t_ms * 1000);
+    }
+}
+
+void checkFeatures() {
+    PulseClassifier classifier{};
+    std::uint64_t onset = 1000000;
+
+    // The first beat after a gap starts the first whole beat, there is nothing to classify yet
+    BPS_CHECK(!classifier.onBeat(makeBeat(onset, 0, 0)).has_value());
+    feedBeat(classifier, onset, 800.3f, 800);
+    onset += 800000;
+
+    // A rhythm of one interval is not judged, the beat still starts the next one
+    BPS_CHECK(!classifier.onBeat(makeBeat(onset, 800, 1)).has_value());
+    feedBeat(classifier, onset, 800.3f, 800);
+    onset += 800000;
+
+    auto const features = classifier.onBeat(makeBeat(onset, 800, 2));
+    BPS_CHECK(features.has_value());
+    if (features) {
+        auto const& f = features.value();
+        BPS_CHECK(f[std::to_underlying(Feature::eHeartRate)] == 750);
+        // 45 ms over 790 ms, in 1/1000 and truncated
+        BPS_CHECK(f[std::to_underlying(Feature::eIrregularity)] == 56);
+        // 800.3 Pa in 1/16 Pa, rounded
+        BPS_CHECK(f[std::to_underlying(Feature::eAmplitude)] == 12805);
+        // From the onset of the beat to its highest sample
+        BPS_CHECK(f[std::to_underlying(Feature::eRiseTime)] == 120);
+        BPS_CHECK(PulseClassifier::infer(f).label == PulseClass::eModerate);
+    }
+
+    // A weak beat, the range of each beat is its own
+    feedBeat(classifier, onset, 150.0f, 800);
+    onset += 800000;
+    auto const weak = classifier.onBeat(makeBeat(onset, 800, 3));
+    BPS_CHECK(weak.has_value() && weak.value()[std::to_underlying(Feature::eAmplitude)] == 2400);
+    BPS_CHECK(weak.has_value() && PulseClassifier::infer(weak.value()).label == PulseClass::eWeak);
+
+    // A gap forgets the beat in progress
+    feedBeat(classifier, onset, 800.0f, 800);
+    onset += 5000000;
+    BPS_CHECK(!classifier.onBeat(makeBeat(onset, 0, 0)).has_value());
+    feedBeat(classifier, onset, 800.0f, 800);
+    onset += 800000;
+    BPS_CHECK(classifier.onBeat(makeBeat(onset, 800, 2)).has_value());
+
+    // After a reset the next beat only starts one
+    classifier.reset();
+    feedBeat(classifier, onset, 800.0f, 800);
+    onset += 800000;
+    BPS_CHECK(!classifier.onBeat(makeBeat(onset, 800, 2)).has_value());
+}
+
+} // anonymous namespace
+
+int main() {
+    checkClasses();
+    checkThresholds();
+    checkFeatures();
+    return bps::test::report("classifier_test");
+}
\ No newline at end of file
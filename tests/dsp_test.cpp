@@ -0,0 +1,201 @@
+// Host check of the streamed sample filters: the Q2.30 biquad kernel against a
+// 128-bit reference with the Cortex-M33 SSAT semantics, and the filter design
+// following the measured sample interval.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cmath>
+#include <array>
+#include <random>
+
+#include "common.hpp"
+#include "biquad.hpp"
+#include "filter_bank.hpp"
+#include "sample_interval.hpp"
+#include "check.hpp"
+
+namespace {
+
+using bps::dsp::Biquad;
+using bps::dsp::BiquadCoefficients;
+using bps::dsp::BiquadType;
+using bps::dsp::FilterBank;
+using bps::dsp::SampleInterval;
+using bps::AcquisitionConfig;
+using bps::PulseValue;
+
+// What SSAT #28 does with the low 32 bits of the shifted accumulator
+std::int32_t ssat28(std::int32_t const value) {
+    return std::clamp(value, bps::dsp::kSampleMin, bps::dsp::kSampleMax);
+}
+
+// The kernel of biquad.hpp, written again on 128 bits
+class ReferenceBiquad {
+    public:
+        std::int32_t process(BiquadCoefficients const& c, std::int32_t const sample) {
+            __int128 accumulator = this->error;
+            accumulator += static_cast<__int128>(c.b0) * sample;
+            accumulator += static_cast<__int128>(c.b1) * this->x1;
+            accumulator += static_cast<__int128>(c.b2) * this->x2;
+            accumulator -= static_cast<__int128>(c.a1) * this->y1;
+            accumulator -= static_cast<__int128>(c.a2) * this->y2;
+            __int128 const shifted = accumulator >> bps::dsp::kCoefficientFractionBits;
+            this->error = static_cast<std::int64_t>(accumulator - (shifted << bps::dsp::kCoefficientFractionBits));
+            // The headroom the kernels rely on: the shifted value fits the 32-bit SSAT input
+            BPS_CHECK(shifted >= INT32_MIN && shifted <= INT32_MAX);
+            std::int32_t const output = ssat28(static_cast<std::int32_t>(shifted));
+            this->x2 = this->x1;
+            this->x1 = sample;
+            this->y2 = this->y1;
+            this->y1 = output;
+            return output;
+        }
+
+    private:
+        std::int64_t x1 = 0;
+        std::int64_t x2 = 0;
+        std::int64_t y1 = 0;
+        std::int64_t y2 = 0;
+        std::int64_t error = 0;
+};
+
+// Every section the filter bank can design, from 2 to 20 ms
+template<typename Check>
+void forEachDesign(Check const& check) {
+    for (std::uint32_t interval_us = 2000; interval_us <= 20000; interval_us += 500) {
+        double const rate_hz = 1.0e6 / interval_us;
+        check(bps::dsp::designBiquad(BiquadType::eLowPass, FilterBank::kLowPassHz, FilterBank::kButterworthQ, rate_hz));
+        check(bps::dsp::designBiquad(BiquadType::eNotch, 50.0, FilterBank::kNotchQ, rate_hz));
+        check(bps::dsp::designBiquad(BiquadType::eNotch, 60.0, FilterBank::kNotchQ, rate_hz));
+        check(bps::dsp::designBiquad(BiquadType::eHighPass, FilterBank::kHighPassHz, FilterBank::kButterworthQ, rate_hz));
+    }
+}
+
+void checkBitExact() {
+    std::mt19937 generator{2024};
+    std::uniform_int_distribution<std::int32_t> full_scale{bps::dsp::kSampleMin, bps::dsp::kSampleMax};
+    std::size_t mismatches = 0;
+    forEachDesign([&](BiquadCoefficients const& coefficients) {
+        Biquad biquad{};
+        ReferenceBiquad reference{};
+        for (std::size_t i = 0; i < 4000; ++i) {
+            std::int32_t sample = 0;
+            if (i < 1000) {
+                // Full scale square wave, the worst case for the accumulator
+                sample = ((i / 3) % 2 == 0) ? bps::dsp::kSampleMax : bps::dsp::kSampleMin;
+            } else if (i < 2000) {
+                sample = full_scale(generator);
+            } else {
+                // A step, then the fraction saving settles at DC
+                sample = 64 * 12000 + 17;
+            }
+            if (biquad.process(coefficients, sample) != reference.process(coefficients, sample)) {
+                ++mismatches;
+            }
+        }
+    });
+    BPS_CHECK(mismatches == 0);
+
+    // The portable saturation is SSAT over the whole 32-bit input range
+    for (std::int64_t value : {std::int64_t{INT32_MIN}, std::int64_t{-(1 << 27) - 1}, std::int64_t{-(1 << 27)},
+                               std::int64_t{0}, std::int64_t{(1 << 27) - 1}, std::int64_t{1 << 27}, std::int64_t{INT32_MAX}}) {
+        BPS_CHECK(Biquad::saturate(value) == ssat28(static_cast<std::int32_t>(value)));
+    }
+}
+
+void checkDcGain() {
+    forEachDesign([](BiquadCoefficients const& c) {
+        // The fraction saving keeps the mean output on the DC gain of the quantised
+        // coefficients, within one LSB, once the slowest pole has settled
+        std::int32_t const sample = 64 * 8000 + 5;
+        Biquad biquad{};
+        biquad.prime(c, sample);
+        std::int64_t sum = 0;
+        for (std::size_t i = 0; i < 6000; ++i) {
+            std::int32_t const output = biquad.process(c, sample);
+            sum += (i >= 4000) ? output : 0;
+        }
+        double const one = static_cast<double>(std::int64_t{1} << bps::dsp::kCoefficientFractionBits);
+        double const gain = (static_cast<double>(c.b0) + c.b1 + c.b2) / (one + c.a1 + c.a2);
+        BPS_CHECK(std::fabs(static_cast<double>(sum) / 2000.0 - gain * sample) <= 1.0);
+    });
+}
+
+// Peak output of a 50 Hz mains tone through the notch, after it settled
+double mainsGain(std::uint32_t const& designed_us, std::uint32_t const& sampled_us) {
+    AcquisitionConfig config = bps::kDefaultAcquisitionConfig;
+    config.filter_sections = { FilterBank::kMainsNotch, 0, 0 };
+    FilterBank bank{};
+    bank.configure(config);
+    bank.setSampleInterval(designed_us);
+
+    constexpr double kAmplitudePa = 200.0;
+    double peak = 0.0;
+    for (std::size_t i = 0; i < 2000; ++i) {
+        double const t = i * sampled_us / 1.0e6;
+        PulseValue value{ .timestamp = 0, .cun = static_cast<std::float32_t>(kAmplitudePa * std::sin(2.0 * bps::dsp::kPi * 50.0 * t)) };
+        bank.process(value);
+        if (i >= 1000) {
+            peak = std::max(peak, std::fabs(static_cast<double>(value.cun)));
+        }
+    }
+    return peak / kAmplitudePa;
+}
+
+void checkDesignFollowsInterval() {
+    // Designed for the 6 ms conversion wait, sampled every 9 ms: the notch misses the mains
+    double const nominal  = mainsGain(6000, 9000);
+    // Designed for the measured 9 ms
+    double const measured = mainsGain(9000, 9000);
+    BPS_CHECK(nominal > 0.9);
+    BPS_CHECK(measured < 0.05);
+    std::printf("mains gain at 9 ms: %.3f designed for 6 ms, %.4f designed for 9 ms\n", nominal, measured);
+}
+
+void checkSampleInterval() {
+    SampleInterval interval{};
+    interval.reset(6000);
+    BPS_CHECK(interval.getIntervalUs() == 6000 && !interval.isMeasured());
+
+    // 9 ms cycles, with the timestamps on a 1 ms tick and a few failed reads
+    std::mt19937 generator{7};
+    std::uniform_int_distribution<int> jitter{-1, 1};
+    std::uint64_t timestamp = 1000000;
+    std::uint32_t sequence = 0;
+    std::size_t reports = 0;
+    for (std::size_t i = 0; i < 1000; ++i) {
+        timestamp += 9000;
+        ++sequence;
+        if (i % 97 == 0) {
+            // Taken by a failed read
+            continue;
+        }
+        if (interval.update(timestamp + 1000 * jitter(generator), sequence)) {
+            ++reports;
+        }
+    }
+    BPS_CHECK(interval.isMeasured());
+    BPS_CHECK(reports >= 1 && reports <= 2);
+    BPS_CHECK(interval.getIntervalUs() >= 8910 && interval.getIntervalUs() <= 9090);
+
+    // A pause between sessions is not an interval
+    timestamp += 5000000;
+    bool moved = false;
+    for (std::size_t i = 0; i < 200; ++i) {
+        timestamp += 9000;
+        moved = interval.update(timestamp, ++sequence) || moved;
+    }
+    BPS_CHECK(!moved);
+    BPS_CHECK(interval.getIntervalUs() >= 8910 && interval.getIntervalUs() <= 9090);
+}
+
+} // anonymous namespace
+
+int main() {
+    checkBitExact();
+    checkDcGain();
+    checkDesignFollowsInterval();
+    checkSampleInterval();
+    return bps::test::report("dsp_test");
+}
\ No newline at end of file
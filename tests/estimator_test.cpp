@@ -0,0 +1,178 @@
+// Host replay of cuff pressure traces through the pressure estimator: a held pressure
+// with the pulse riding on it, a pump switching on, and a leak changing, each at the
+// shortest, a typical and the longest measured sample interval.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <random>
+#include <utility>
+
+#include "common.hpp"
+#include "pressure_estimator.hpp"
+#include "check.hpp"
+
+namespace {
+
+using bps::sampler::pneumatic::PressureEstimator;
+
+constexpr std::uint32_t kIntervalsUs[] = { 6000, 8000, 10000 };
+constexpr double        kHeartRateHz   = 1.2;
+constexpr double        kPulsePa       = 500.0;
+constexpr double        kNoisePa       = 30.0;
+
+// One beat, a systolic peak and a dicrotic wave, from 0 to 1 over the period
+double beatShape(double const& phase) {
+    return std::exp(-std::pow((phase - 0.15) / 0.06, 2.0)) + 0.4 * std::exp(-std::pow((phase - 0.45) / 0.08, 2.0));
+}
+
+// Pulse of kPulsePa peak to peak at "t_s", from 0
+double pulse(double const& t_s) {
+    static auto const range = [] {
+        std::pair<double, double> value{1.0, 0.0};
+        for (std::size_t i = 0; i < 1000; ++i) {
+            value.first  = std::min(value.first, beatShape(i / 1000.0));
+            value.second = std::max(value.second, beatShape(i / 1000.0));
+        }
+        return value;
+    }();
+    double const phase = t_s * kHeartRateHz - std::floor(t_s * kHeartRateHz);
+    return kPulsePa * (beatShape(phase) - range.first) / (range.second - range.first);
+}
+
+// Samples "interval_us" apart on average, time stamped on the 1 ms tick of the acquisition
+class Trace {
+    public:
+        explicit Trace(std::uint32_t const& sample_interval_us, std::uint32_t const& seed) noexcept:
+            interval_us(sample_interval_us), generator(seed) {}
+
+        // Time of the next sample, in s
+        double next() {
+            ++this->index;
+            this->offset_ms = jitter(this->generator);
+            return static_cast<double>(getTimestamp()) / 1.0e6;
+        }
+
+        std::uint64_t getTimestamp() const noexcept {
+            return 1000000 + this->index * this->interval_us + 1000 * this->offset_ms;
+        }
+
+        std::float32_t read(double const& pressure) {
+            return static_cast<std::float32_t>(pressure + noise(this->generator));
+        }
+
+    private:
+        std::uint64_t interval_us;
+        std::uint64_t index = 0;
+        int offset_ms = 0;
+        std::mt19937 generator;
+        std::uniform_int_distribution<int> jitter{0, 1};
+        std::normal_distribution<double> noise{0.0, kNoisePa};
+};
+
+// The cuff held at 12 kPa with the pump off: neither the pressure nor its rate follows the pulse
+void checkHold(std::uint32_t const& interval_us) {
+    PressureEstimator estimator{};
+    Trace trace{interval_us, 1};
+    std::float32_t low = 1.0e9f, high = -1.0e9f, predicted_low = 1.0e9f, predicted_high = -1.0e9f, rate = 0.0f;
+    for (double t_s = 0.0; t_s < 30.0; ) {
+        t_s = trace.next();
+        std::float32_t const measured = trace.read(12000.0 + pulse(t_s));
+        estimator.update(measured, trace.getTimestamp());
+        if (t_s < 20.0) {
+            continue;
+        }
+        std::float32_t const predicted = estimator.predict(static_cast<std::float32_t>(interval_us) / 1.0e6f);
+        low  = std::min(low, estimator.getPressure());
+        high = std::max(high, estimator.getPressure());
+        predicted_low  = std::min(predicted_low, predicted);
+        predicted_high = std::max(predicted_high, predicted);
+        rate = std::max(rate, std::abs(estimator.getRate()));
+    }
+    BPS_CHECK(high - low < 0.5f * kPulsePa);
+    BPS_CHECK(predicted_high - predicted_low < 0.5f * kPulsePa);
+    BPS_CHECK(rate < 250.0f);
+    std::printf("hold at %u us: pressure swings %.0f Pa, prediction %.0f Pa, rate up to %.0f Pa/s for a %.0f Pa pulse\n",
+        static_cast<unsigned>(interval_us), high - low, predicted_high - predicted_low, rate, kPulsePa);
+}
+
+// The pump switches on at full duty, steered with the default pump rate while the cuff pumps
+// "pump_share" of it: the rate locks within kMaxLockS either way
+void checkPumpStep(std::uint32_t const& interval_us, double const& pump_share) {
+    constexpr double         kPumpRate = 12000.0;
+    constexpr double         kSwitchS  = 2.0;
+    constexpr std::float32_t kMaxLockS = 0.5f;
+    double const true_rate = kPumpRate * pump_share;
+
+    PressureEstimator estimator{};
+    Trace trace{interval_us, 2};
+    bool steered = false;
+    double locked_s = -1.0;
+    for (double t_s = 0.0; t_s < kSwitchS + 1.0; ) {
+        t_s = trace.next();
+        double const pressure = 1000.0 + (t_s > kSwitchS ? true_rate * (t_s - kSwitchS) : 0.0);
+        estimator.update(trace.read(pressure + pulse(t_s)), trace.getTimestamp());
+        if (t_s < kSwitchS) {
+            continue;
+        }
+        if (!steered) {
+            // What the controller does once it has set the new duty
+            estimator.steer(static_cast<std::float32_t>(kPumpRate), static_cast<std::float32_t>(0.3 * kPumpRate));
+            steered = true;
+            continue;
+        }
+        bool const locked = std::abs(estimator.getRate() - true_rate) < 0.1 * true_rate;
+        if (!locked) {
+            locked_s = -1.0;
+        } else if (locked_s < 0.0) {
+            locked_s = t_s - kSwitchS;
+        }
+    }
+    BPS_CHECK(locked_s >= 0.0 && locked_s < kMaxLockS);
+    std::printf("pump step at %u us, %.0f%% of the expected rate: locked after %.3f s\n",
+        static_cast<unsigned>(interval_us), 100.0 * pump_share, locked_s);
+}
+
+// A leak change is not steered: the filter follows it on its own within a couple of seconds
+void checkLeakChange(std::uint32_t const& interval_us) {
+    constexpr double kLeakRate = -500.0;
+    constexpr double kChangeS  = 20.0;
+
+    PressureEstimator estimator{};
+    Trace trace{interval_us, 3};
+    double locked_s = -1.0;
+    double worst = 0.0;
+    for (double t_s = 0.0; t_s < kChangeS + 5.0; ) {
+        t_s = trace.next();
+        double const pressure = 12000.0 + (t_s > kChangeS ? kLeakRate * (t_s - kChangeS) : 0.0);
+        estimator.update(trace.read(pressure), trace.getTimestamp());
+        if (t_s < kChangeS) {
+            continue;
+        }
+        worst = std::max(worst, std::abs(estimator.getPressure() - pressure));
+        bool const locked = std::abs(estimator.getRate() - kLeakRate) < 100.0;
+        if (!locked) {
+            locked_s = -1.0;
+        } else if (locked_s < 0.0) {
+            locked_s = t_s - kChangeS;
+        }
+    }
+    BPS_CHECK(locked_s >= 0.0 && locked_s < 2.0);
+    BPS_CHECK(worst < 200.0);
+    std::printf("leak change at %u us: locked after %.2f s, %.0f Pa behind at most\n",
+        static_cast<unsigned>(interval_us), locked_s, worst);
+}
+
+} // anonymous namespace
+
+int main() {
+    for (std::uint32_t const interval_us : kIntervalsUs) {
+        checkHold(interval_us);
+        checkPumpStep(interval_us, 0.7);
+        checkPumpStep(interval_us, 1.3);
+        checkLeakChange(interval_us);
+    }
+    return bps::test::report("estimator_test");
+}
\ No newline at end of file
@@ -0,0 +1,201 @@
+// Host check of the session log: mount, append, power cut recovery and wrap around,
+// on a FileFlash stand-in.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <array>
+#include <chrono>
+#include <span>
+
+#include "file_flash.hpp"
+#include "log_store.hpp"
+#include "check.hpp"
+
+namespace {
+
+using bps::storage::FileFlash;
+using bps::storage::LogStore;
+
+using Flash = FileFlash<>;
+using Store = LogStore<Flash>;
+
+// 16 sectors of 16 pages
+constexpr std::uint32_t kDeviceSize  = 16 * Flash::kSectorSize;
+constexpr std::uint32_t kEraseAhead  = 4;
+constexpr char const*   kPath        = "storage_test.bin";
+
+Store::Payload makePayload(std::uint32_t const& key) {
+    Store::Payload payload{};
+    payload.fill(std::byte{0x5A});
+    bps::writeAsLittleEndian(key, payload.data());
+    return payload;
+}
+
+std::uint32_t keyOf(Store::Payload const& payload) {
+    std::uint32_t key = 0;
+    bps::readAsNativeEndian(payload.data(), key);
+    return key;
+}
+
+// Erase ahead as the idle storage task does
+void eraseWhileIdle(Store& store) {
+    while (store.needsErase()) {
+        BPS_CHECK(store.eraseAhead());
+    }
+}
+
+// Append "count" payloads with keys from "first_key" to a session of their own
+std::uint16_t writeSession(Store& store, std::uint32_t const& first_key, std::size_t const& count) {
+    std::uint16_t const id = store.beginSession();
+    for (std::size_t i = 0; i < count; ++i) {
+        auto const payload = makePayload(first_key + static_cast<std::uint32_t>(i));
+        BPS_CHECK(store.append(std::span<Store::Payload const>(&payload, 1)) == 1);
+    }
+    store.endSession();
+    return id;
+}
+
+void checkMountAndSeek() {
+    std::remove(kPath);
+    Flash flash{kPath, kDeviceSize};
+    BPS_CHECK(flash.isValid());
+    bps::storage::NullLock lock{};
+    {
+        Store store{flash, lock, kEraseAhead};
+        BPS_CHECK(store.mount());
+        eraseWhileIdle(store);
+        writeSession(store, 100, 20);
+        writeSession(store, 1000, 5);
+    }
+    // Everything is rebuilt from the page headers
+    Store store{flash, lock, kEraseAhead};
+    BPS_CHECK(store.mount());
+    std::array<Store::Session, Store::kMaxSessions> sessions{};
+    BPS_CHECK(store.getSessions(sessions) == 2);
+    BPS_CHECK(sessions[0].last_page - sessions[0].first_page == 19);
+    BPS_CHECK(sessions[1].last_page - sessions[1].first_page == 4);
+
+    Store::Payload payload{};
+    auto const page = store.seek(sessions[0].id, 107, payload);
+    BPS_CHECK(page.has_value() && keyOf(payload) == 107);
+    // A key older than the session gives its first payload
+    BPS_CHECK(store.seek(sessions[1].id, 0, payload).has_value() && keyOf(payload) == 1000);
+}
+
+void checkAppendNeverErases() {
+    std::remove(kPath);
+    Flash flash{kPath, kDeviceSize};
+    bps::storage::NullLock lock{};
+    Store store{flash, lock, kEraseAhead};
+    BPS_CHECK(store.mount());
+    eraseWhileIdle(store);
+
+    std::size_t const erases = flash.getEraseCount();
+    std::uint32_t const erased_pages = store.getErasedPages();
+    store.beginSession();
+    std::size_t appended = 0;
+    for (std::uint32_t key = 0; key < 2 * erased_pages; ++key) {
+        auto const payload = makePayload(key);
+        appended += store.append(std::span<Store::Payload const>(&payload, 1));
+    }
+    store.endSession();
+    // Appends stop at the end of the erased sectors instead of erasing
+    BPS_CHECK(flash.getEraseCount() == erases);
+    BPS_CHECK(appended == erased_pages);
+    BPS_CHECK(store.getErasedPages() == 0);
+}
+
+void checkPowerCut() {
+    std::remove(kPath);
+    bps::storage::NullLock lock{};
+    {
+        Flash flash{kPath, kDeviceSize};
+        Store store{flash, lock, kEraseAhead};
+        BPS_CHECK(store.mount());
+        eraseWhileIdle(store);
+        writeSession(store, 0, 10);
+        // The power goes in the middle of the third page of a batch
+        std::array<Store::Payload, 4> batch{makePayload(50), makePayload(51), makePayload(52), makePayload(53)};
+        store.beginSession();
+        flash.cutPowerAfter(2 * Flash::kPageSize + 100);
+        BPS_CHECK(store.append(batch) == 0);
+    }
+    // The power comes back
+    Flash flash{kPath, kDeviceSize};
+    Store store{flash, lock, kEraseAhead};
+    BPS_CHECK(store.mount());
+    std::array<Store::Session, Store::kMaxSessions> sessions{};
+    BPS_CHECK(store.getSessions(sessions) == 2);
+    // The pages programmed before the cut survive, the torn one is skipped
+    BPS_CHECK(sessions[1].last_page - sessions[1].first_page == 1);
+    Store::Payload payload{};
+    BPS_CHECK(!store.read(sessions[1].id, sessions[1].last_page + 1, payload));
+
+    // Writing goes on from a clean sector
+    eraseWhileIdle(store);
+    std::uint16_t const id = writeSession(store, 500, 3);
+    BPS_CHECK(store.getSessions(sessions) == 3);
+    BPS_CHECK(sessions[2].id == id);
+    BPS_CHECK(sessions[2].first_page % Store::kPagesPerSector == 0);
+    BPS_CHECK(store.read(id, sessions[2].first_page, payload) && keyOf(payload) == 500);
+}
+
+void checkWrap() {
+    std::remove(kPath);
+    Flash flash{kPath, kDeviceSize};
+    bps::storage::NullLock lock{};
+    Store store{flash, lock, kEraseAhead};
+    BPS_CHECK(store.mount());
+
+    // Three times around the ring, in sessions of 40 pages
+    std::uint32_t const total_pages = kDeviceSize / Flash::kPageSize;
+    std::uint16_t last_id = 0;
+    std::uint32_t key = 0;
+    auto const start = std::chrono::steady_clock::now();
+    for (std::uint32_t written = 0; written < 3 * total_pages; written += 40) {
+        eraseWhileIdle(store);
+        last_id = writeSession(store, key, 40);
+        key += 40;
+    }
+    double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    eraseWhileIdle(store);
+
+    std::array<Store::Session, Store::kMaxSessions> sessions{};
+    std::size_t const count = store.getSessions(sessions);
+    BPS_CHECK(count > 0 && sessions[count - 1].id == last_id);
+    // The recycled pages are gone from the index, the kept ones are all readable
+    std::uint32_t kept = 0;
+    Store::Payload payload{};
+    for (std::size_t i = 0; i < count; ++i) {
+        for (std::uint32_t page = sessions[i].first_page; page <= sessions[i].last_page; ++page) {
+            BPS_CHECK(store.read(sessions[i].id, page, payload));
+            ++kept;
+        }
+    }
+    BPS_CHECK(kept >= store.getCapacityPages() - Store::kPagesPerSector);
+    BPS_CHECK(kept + store.getErasedPages() <= total_pages);
+    BPS_CHECK(store.getErasedPages() >= kEraseAhead * Store::kPagesPerSector);
+
+    // A remount finds the same sessions
+    Store remounted{flash, lock, kEraseAhead};
+    BPS_CHECK(remounted.mount());
+    std::array<Store::Session, Store::kMaxSessions> found{};
+    BPS_CHECK(remounted.getSessions(found) == count);
+    BPS_CHECK(found[count - 1].id == last_id && found[count - 1].last_page == sessions[count - 1].last_page);
+
+    std::printf("wrap: %u pages in %.3f s, %u programs, %u erases\n",
+        static_cast<unsigned>(key), seconds,
+        static_cast<unsigned>(flash.getProgramCount()), static_cast<unsigned>(flash.getEraseCount()));
+}
+
+} // anonymous namespace
+
+int main() {
+    checkMountAndSeek();
+    checkAppendNeverErases();
+    checkPowerCut();
+    checkWrap();
+    std::remove(kPath);
+    return bps::test::report("storage_test");
+}
\ No newline at end of file